@@ -0,0 +1,823 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A headless benchmark of the client's hot paths over generated fixtures of
+ * 1k, 10k and 100k torrents (or --sizes): a full list poll round trip to a
+ * mock daemon (trg-mock-daemon.c) on a loopback port, validating and
+ * parsing a response, the torrent model update in each mode, refiltering,
+ * resorting, the state selector, the files and peers models and .torrent
+ * parsing. Apart from the round trip, the fixtures are generated here and
+ * carry every field the list poll asks for, with values, trackers, files
+ * and peers varied per torrent and values also per round.
+ *
+ * Each stage's call count and total, min, max and mean durations (in
+ * microseconds) per fixture size are written as JSON to --output, or
+ * stdout. Run through "meson test --benchmark", which uses GDK's broadway
+ * backend so no display is needed. Without any usable display this exits
+ * with 77, which meson counts as skipped.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+
+#include "json.h"
+#include "protocol-constants.h"
+#include "requests.h"
+#include "session-get.h"
+#include "torrent.h"
+#include "trg-client.h"
+#include "trg-file-parser.h"
+#include "trg-files-model.h"
+#include "trg-mock-daemon.h"
+#include "trg-peers-model.h"
+#include "trg-sortable-filtered-model.h"
+#include "trg-state-selector.h"
+#include "trg-torrent-filter.h"
+#include "trg-torrent-model.h"
+#include "trg-tree-view.h"
+
+typedef enum {
+    BENCH_RPC_ROUND_TRIP,
+    BENCH_RPC_PARSE,
+    BENCH_MODEL_FIRST,
+    BENCH_MODEL_UPDATE,
+    BENCH_MODEL_ACTIVE,
+    BENCH_STATE_SELECTOR,
+    BENCH_REFILTER_NAME,
+    BENCH_REFILTER_QUERY,
+    BENCH_SORT,
+    BENCH_FILES_FIRST,
+    BENCH_FILES_UPDATE,
+    BENCH_DETAIL_FILES,
+    BENCH_DETAIL_PEERS,
+    BENCH_TORRENT_FILE,
+    BENCH_COUNT
+} trg_bench_stage;
+
+static const gchar *const trg_bench_names[BENCH_COUNT] = {
+    "rpc-round-trip",      "rpc-parse",           "model-update-first",  "model-update",
+    "model-update-active", "state-selector",      "refilter-name",       "refilter-query",
+    "sort",                "files-model-first",   "files-model-update",  "detail-files-model",
+    "detail-peers-model",  "torrent-file",
+};
+
+typedef struct {
+    guint64 count;
+    gint64 total;
+    gint64 min;
+    gint64 max;
+} trg_bench_times;
+
+static const gchar *const trg_bench_trackers[] = {
+    "http://tracker.example.org:6969/announce",
+    "udp://open.example.net:1337/announce",
+    "https://Tracker.Example.COM/announce",
+    "http://bt.example.info/announce.php",
+};
+
+/* The share of torrents in an active-only update. */
+#define BENCH_ACTIVE_DIVISOR 10
+
+/* How many torrents, spread over the list, have their details (files and
+ * peers) loaded as if selected. */
+#define BENCH_DETAIL_TORRENTS 100
+
+/* Per torrent counts, so torrents differ in shape and not only in values. */
+#define bench_file_count(id)    (1 + ((id) * 37) % 64)
+#define bench_peer_count(id)    (((id) * 7) % 120)
+#define bench_tracker_count(id) (1 + ((id) * 5) % 4)
+
+static gint bench_iterations = 5;
+static gchar *bench_sizes = NULL;
+static gchar *bench_output = NULL;
+
+static GOptionEntry bench_entries[] = {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &bench_iterations, "Runs of each stage", "N" },
+    { "sizes", 's', 0, G_OPTION_ARG_STRING, &bench_sizes,
+      "Comma separated torrent counts (1000,10000,100000)", "LIST" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &bench_output, "Write the results here", "FILE" },
+    { NULL },
+};
+
+static void bench_add(trg_bench_times *times, gint64 start)
+{
+    gint64 usec = g_get_monotonic_time() - start;
+
+    if (times->count == 0 || usec < times->min)
+        times->min = usec;
+    if (usec > times->max)
+        times->max = usec;
+    times->total += usec;
+    times->count++;
+}
+
+static JsonObject *bench_tracker_new(gint64 id, guint i)
+{
+    JsonObject *tracker = json_object_new();
+    const gchar *announce
+        = trg_bench_trackers[(id + i) % G_N_ELEMENTS(trg_bench_trackers)];
+
+    json_object_set_int_member(tracker, FIELD_ID, i);
+    json_object_set_int_member(tracker, FIELD_TIER, i);
+    json_object_set_string_member(tracker, FIELD_ANNOUNCE, announce);
+    json_object_set_string_member(tracker, FIELD_SCRAPE, announce);
+    json_object_set_string_member(tracker, FIELD_HOST, announce);
+    json_object_set_string_member(tracker, FIELD_LAST_ANNOUNCE_RESULT, "Success");
+    json_object_set_int_member(tracker, FIELD_LAST_ANNOUNCE_PEER_COUNT, id % 50);
+    json_object_set_int_member(tracker, FIELD_LAST_ANNOUNCE_TIME, 1700000000 + id);
+    json_object_set_int_member(tracker, FIELD_LAST_SCRAPE_TIME, 1700000000 + id);
+    json_object_set_int_member(tracker, FIELD_SEEDERCOUNT, (id * 7) % 1000);
+    json_object_set_int_member(tracker, FIELD_LEECHERCOUNT, (id * 3) % 500);
+    json_object_set_int_member(tracker, FIELD_DOWNLOADCOUNT, (id * 11) % 5000);
+
+    return tracker;
+}
+
+static JsonArray *bench_files_new(gint64 id, gint64 n, guint round)
+{
+    JsonArray *files = json_array_new();
+    gint64 i;
+
+    for (i = 0; i < n; i++) {
+        JsonObject *file = json_object_new();
+        g_autofree gchar *name = g_strdup_printf("Torrent %" G_GINT64_FORMAT "/dir%d/sub%d/file%"
+                                                 G_GINT64_FORMAT ".bin",
+                                                 id, (gint)(i % 64), (gint)(i % 7), i);
+
+        json_object_set_string_member(file, TFILE_NAME, name);
+        json_object_set_int_member(file, TFILE_LENGTH, 65536 + i);
+        json_object_set_int_member(file, TFILE_BYTES_COMPLETED, (65536 + i) * ((i + round) % 2));
+        json_array_add_object_element(files, file);
+    }
+
+    return files;
+}
+
+/* Peers come and go between rounds, as they do. */
+static JsonArray *bench_peers_new(gint64 id, gint64 n, guint round)
+{
+    JsonArray *peers = json_array_new();
+    gint64 i;
+
+    for (i = 0; i < n; i++) {
+        JsonObject *peer = json_object_new();
+        gint64 p = i + (round % 3) * (n / 4);
+        g_autofree gchar *address
+            = g_strdup_printf("10.%d.%d.%d", (gint)(id % 256), (gint)(p / 256 % 256),
+                              (gint)(p % 256));
+
+        json_object_set_string_member(peer, TPEER_ADDRESS, address);
+        json_object_set_string_member(peer, TPEER_CLIENT_NAME, "Transmission 4.0.0");
+        json_object_set_string_member(peer, TPEER_FLAGSTR, p % 2 ? "TDEI" : "UEH");
+        json_object_set_double_member(peer, TPEER_PROGRESS, (gdouble)(p % 101) / 100.0);
+        json_object_set_int_member(peer, TPEER_RATE_TO_CLIENT, (p * 97 + round) % 100000);
+        json_object_set_int_member(peer, TPEER_RATE_TO_PEER, (p * 53 + round) % 50000);
+        json_object_set_boolean_member(peer, TPEER_IS_ENCRYPTED, p % 3 == 0);
+        json_object_set_boolean_member(peer, TPEER_IS_DOWNLOADING_FROM, p % 2);
+        json_object_set_boolean_member(peer, TPEER_IS_UPLOADING_TO, p % 5 == 0);
+        json_array_add_object_element(peers, peer);
+    }
+
+    return peers;
+}
+
+/* A plausible value for one torrent-get field, varied by torrent and by
+ * round so successive updates change most rows. */
+static void bench_set_field(JsonObject *t, const gchar *field, gint64 id, guint round)
+{
+    gint64 size = 1048576 * (1 + id % 4096);
+    gint64 status = (id + round) % 7;
+
+    if (!strcmp(field, FIELD_ID)) {
+        json_object_set_int_member(t, field, id);
+    } else if (!strcmp(field, FIELD_NAME)) {
+        g_autofree gchar *name = g_strdup_printf("Benchmark torrent %" G_GINT64_FORMAT
+                                                 " ubuntu-%02d.iso",
+                                                 id, (gint)(id % 100));
+        json_object_set_string_member(t, field, name);
+    } else if (!strcmp(field, FIELD_DOWNLOAD_DIR)) {
+        g_autofree gchar *dir = g_strdup_printf("/downloads/dir%d", (gint)(id % 20));
+        json_object_set_string_member(t, field, dir);
+    } else if (!strcmp(field, FIELD_HASH_STRING) || !strcmp(field, FIELD_MAGNETLINK)) {
+        g_autofree gchar *hash = g_strdup_printf("%040" G_GINT64_MODIFIER "x", id);
+        json_object_set_string_member(t, field, hash);
+    } else if (!strcmp(field, FIELD_ANNOUNCE_URL)) {
+        json_object_set_string_member(t, field, trg_bench_trackers[0]);
+    } else if (!strcmp(field, FIELD_COMMENT) || !strcmp(field, FIELD_CREATOR)
+               || !strcmp(field, FIELD_ERROR_STRING)) {
+        json_object_set_string_member(t, field, "");
+    } else if (!strcmp(field, FIELD_ISFINISHED) || !strcmp(field, FIELD_ISPRIVATE)
+               || !strcmp(field, FIELD_UPLOAD_LIMITED) || !strcmp(field, FIELD_DOWNLOAD_LIMITED)
+               || !strcmp(field, FIELD_HONORS_SESSION_LIMITS)) {
+        json_object_set_boolean_member(t, field, id % 3 == 0);
+    } else if (!strcmp(field, FIELD_PERCENTDONE)
+               || !strcmp(field, FIELD_METADATAPERCENTCOMPLETE)) {
+        json_object_set_double_member(t, field, (gdouble)((id + round) % 101) / 100.0);
+    } else if (!strcmp(field, FIELD_SEED_RATIO_LIMIT) || !strcmp(field, FIELD_RECHECK_PROGRESS)) {
+        json_object_set_double_member(t, field, 2.0);
+    } else if (!strcmp(field, FIELD_STATUS)) {
+        json_object_set_int_member(t, field, status);
+    } else if (!strcmp(field, FIELD_ERROR)) {
+        json_object_set_int_member(t, field, id % 50 == 0 ? 2 : 0);
+    } else if (!strcmp(field, FIELD_RATEDOWNLOAD)) {
+        json_object_set_int_member(
+            t, field, status == TR_STATUS_DOWNLOAD ? (id * 37 + round * 101) % 500000 : 0);
+    } else if (!strcmp(field, FIELD_RATEUPLOAD)) {
+        json_object_set_int_member(
+            t, field, status >= TR_STATUS_DOWNLOAD ? (id * 53 + round * 97) % 200000 : 0);
+    } else if (!strcmp(field, FIELD_TOTAL_SIZE) || !strcmp(field, FIELD_SIZEWHENDONE)) {
+        json_object_set_int_member(t, field, size);
+    } else if (!strcmp(field, FIELD_LEFT_UNTIL_DONE)) {
+        json_object_set_int_member(t, field, id % 3 == 0 ? 0 : size / (1 + round % 4));
+    } else if (!strcmp(field, FIELD_FILE_COUNT)) {
+        json_object_set_int_member(t, field, bench_file_count(id));
+    } else if (!strcmp(field, FIELD_FILES)) {
+        json_object_set_array_member(t, field, bench_files_new(id, bench_file_count(id), round));
+    } else if (!strcmp(field, FIELD_PEERS)) {
+        json_object_set_array_member(t, field, bench_peers_new(id, bench_peer_count(id), round));
+    } else if (!strcmp(field, FIELD_TRACKER_STATS)) {
+        JsonArray *trackers = json_array_new();
+        guint i;
+        for (i = 0; i < bench_tracker_count(id); i++)
+            json_array_add_object_element(trackers, bench_tracker_new(id, i));
+        json_object_set_array_member(t, field, trackers);
+    } else if (!strcmp(field, FIELD_PEERSFROM)) {
+        JsonObject *from = json_object_new();
+        json_object_set_int_member(from, TPEERFROM_FROMPEX, id % 5);
+        json_object_set_int_member(from, TPEERFROM_FROMDHT, id % 7);
+        json_object_set_int_member(from, TPEERFROM_FROMTRACKERS, id % 11);
+        json_object_set_int_member(from, TPEERFROM_FROMLTEP, 0);
+        json_object_set_int_member(from, TPEERFROM_FROMRESUME, id % 3);
+        json_object_set_int_member(from, TPEERFROM_FROMINCOMING, id % 2);
+        json_object_set_int_member(from, TPEERFROM_FROMLPD, 0);
+        json_object_set_object_member(t, field, from);
+    } else {
+        json_object_set_int_member(t, field, (id * 131 + round) % 100000);
+    }
+}
+
+/* A torrent-get response for torrents [0, n) with the given fields. */
+static JsonObject *bench_response_new(GPtrArray *fields, gint64 n, guint round, gboolean active)
+{
+    JsonObject *response = json_object_new();
+    JsonObject *args = json_object_new();
+    JsonArray *torrents = json_array_new();
+    gint64 id;
+    guint i;
+
+    for (id = 0; id < n; id++) {
+        JsonObject *t = json_object_new();
+        for (i = 0; i < fields->len; i++)
+            bench_set_field(t, g_ptr_array_index(fields, i), id, round);
+        json_array_add_object_element(torrents, t);
+    }
+
+    json_object_set_array_member(args, FIELD_TORRENTS, torrents);
+    if (active)
+        json_object_set_array_member(args, FIELD_REMOVED, json_array_new());
+
+    json_object_set_object_member(response, PARAM_ARGUMENTS, args);
+    json_object_set_string_member(response, FIELD_RESULT, FIELD_SUCCESS);
+
+    return response;
+}
+
+/* The fields of a full list poll, as the main window would send it. */
+static GPtrArray *bench_fields_new(TrgTorrentModel *model, gint64 rpcv)
+{
+    JsonNode *req = torrent_get(TORRENT_GET_TAG_MODE_FULL, rpcv);
+    JsonArray *array;
+    GPtrArray *fields = g_ptr_array_new_with_free_func(g_free);
+    guint i;
+
+    trg_torrent_model_add_derived_fields(model, req);
+    array = json_object_get_array_member(node_get_arguments(req), PARAM_FIELDS);
+
+    for (i = 0; i < json_array_get_length(array); i++)
+        g_ptr_array_add(fields, g_strdup(json_array_get_string_element(array, i)));
+
+    json_node_unref(req);
+
+    return fields;
+}
+
+/* What a selected torrent's details would hold: n files and some peers. */
+static JsonObject *bench_detail_torrent_new(gint64 id, gint64 nFiles, gint64 nPeers, guint round)
+{
+    JsonObject *t = json_object_new();
+    JsonArray *priorities = json_array_new();
+    JsonArray *wanted = json_array_new();
+    gint64 i;
+
+    for (i = 0; i < nFiles; i++) {
+        json_array_add_int_element(priorities, (gint64)((i + round) % 3) - 1);
+        json_array_add_int_element(wanted, (i + round) % 5 != 0);
+    }
+
+    json_object_set_int_member(t, FIELD_ID, id);
+    json_object_set_array_member(t, FIELD_FILES, bench_files_new(id, nFiles, round));
+    json_object_set_array_member(t, FIELD_PRIORITIES, priorities);
+    json_object_set_array_member(t, FIELD_WANTED, wanted);
+    json_object_set_array_member(t, FIELD_PEERS, bench_peers_new(id, nPeers, round));
+
+    return t;
+}
+
+/* A multi-file .torrent with n files, written to a temporary file. */
+static gchar *bench_torrent_file_new(gint64 n)
+{
+    GString *data = g_string_new("d4:infod5:filesl");
+    gchar *filename = NULL;
+    GError *error = NULL;
+    gint64 i;
+    gint fd;
+
+    for (i = 0; i < n; i++) {
+        g_autofree gchar *dir = g_strdup_printf("dir%d", (gint)(i % 64));
+        g_autofree gchar *file = g_strdup_printf("file%" G_GINT64_FORMAT ".bin", i);
+
+        g_string_append_printf(data, "d6:lengthi%" G_GINT64_FORMAT "e4:pathl%zu:%s%zu:%see",
+                               65536 + i, strlen(dir), dir, strlen(file), file);
+    }
+
+    g_string_append(data, "e4:name9:Benchmark12:piece lengthi262144eee");
+
+    fd = g_file_open_tmp("trg-benchmark-XXXXXX.torrent", &filename, &error);
+    if (fd < 0 || !g_file_set_contents(filename, data->str, data->len, &error)) {
+        g_printerr("trg-benchmark: %s\n", error->message);
+        exit(EXIT_FAILURE);
+    }
+
+    g_close(fd, NULL);
+    g_string_free(data, TRUE);
+
+    return filename;
+}
+
+static gchar *bench_serialize(JsonObject *obj, gsize *len)
+{
+    g_autoptr(JsonNode) node = json_node_init_object(json_node_alloc(), obj);
+    g_autoptr(JsonGenerator) generator = trg_json_serializer(node, FALSE);
+
+    return json_generator_to_data(generator, len);
+}
+
+typedef struct {
+    GBytes *bytes;
+    GError *error;
+    gboolean done;
+} bench_rpc_call;
+
+static void bench_rpc_done(GObject *source, GAsyncResult *result, gpointer data)
+{
+    bench_rpc_call *call = data;
+
+    call->bytes = soup_session_send_and_read_finish(SOUP_SESSION(source), result, &call->error);
+    call->done = TRUE;
+}
+
+/* POST a request to the mock daemon, running the main loop (and so the mock)
+ * until the response is in. Like the client, take the session id from a 409
+ * and send the request again. */
+static GBytes *bench_rpc(SoupSession *session, const gchar *url, GBytes *body, gchar **sessionId)
+{
+    gint attempt;
+
+    for (attempt = 0; attempt < 2; attempt++) {
+        g_autoptr(SoupMessage) msg = soup_message_new(SOUP_METHOD_POST, url);
+        bench_rpc_call call = { NULL, NULL, FALSE };
+        guint status;
+
+        if (*sessionId)
+            soup_message_headers_replace(soup_message_get_request_headers(msg),
+                                         TRANSMISSION_SESSION_ID_HEADER, *sessionId);
+        soup_message_set_request_body_from_bytes(msg, "application/json", body);
+        soup_session_send_and_read_async(session, msg, G_PRIORITY_DEFAULT, NULL, bench_rpc_done,
+                                         &call);
+
+        while (!call.done)
+            g_main_context_iteration(NULL, TRUE);
+
+        if (call.error) {
+            g_printerr("trg-benchmark: mock daemon request failed: %s\n", call.error->message);
+            exit(EXIT_FAILURE);
+        }
+
+        status = soup_message_get_status(msg);
+        if (status == SOUP_STATUS_OK)
+            return call.bytes;
+
+        g_bytes_unref(call.bytes);
+
+        if (status != SOUP_STATUS_CONFLICT)
+            break;
+
+        g_free(*sessionId);
+        *sessionId = g_strdup(soup_message_headers_get_one(soup_message_get_response_headers(msg),
+                                                           TRANSMISSION_SESSION_ID_HEADER));
+    }
+
+    g_printerr("trg-benchmark: the mock daemon didn't answer a request\n");
+    exit(EXIT_FAILURE);
+}
+
+/* The list poll as the client sends it, to a mock daemon of n torrents,
+ * through to the parsed response. */
+static void bench_rpc_round_trip(gint64 n, trg_bench_times *times)
+{
+    g_autoptr(SoupSession) session = trg_client_session_new(NULL);
+    g_autoptr(GBytes) body
+        = request_to_bytes(torrent_get(TORRENT_GET_TAG_MODE_FULL, FILE_COUNT_RPC_VERSION));
+    g_autoptr(GError) error = NULL;
+    g_autofree gchar *sessionId = NULL;
+    g_autofree gchar *url = NULL;
+    trg_mock_options options = { 0 };
+    trg_mock_daemon *daemon;
+    guint port;
+    gint i;
+
+    options.torrents = n;
+    options.churn = 0.1;
+    options.seed = 1;
+    daemon = trg_mock_daemon_new(&options);
+
+    port = trg_mock_daemon_listen(daemon, "127.0.0.1", 0, &error);
+    if (!port) {
+        g_printerr("trg-benchmark: unable to start the mock daemon: %s\n", error->message);
+        exit(EXIT_FAILURE);
+    }
+
+    url = g_strdup_printf("http://127.0.0.1:%u%s", port, TRG_MOCK_DEFAULT_PATH);
+
+    /* A connected client already has a session id and a connection. */
+    g_bytes_unref(bench_rpc(session, url, body, &sessionId));
+
+    for (i = 0; i < bench_iterations; i++) {
+        g_autoptr(JsonParser) parser = json_parser_new();
+        g_autoptr(GBytes) bytes = NULL;
+        const gchar *data;
+        gint64 start;
+        gsize len;
+
+        start = g_get_monotonic_time();
+        bytes = bench_rpc(session, url, body, &sessionId);
+        data = g_bytes_get_data(bytes, &len);
+
+        if (!g_utf8_validate(data, len, NULL)
+            || !json_parser_load_from_data(parser, data, len, NULL)) {
+            g_printerr("trg-benchmark: unable to parse the mock daemon's response\n");
+            exit(EXIT_FAILURE);
+        }
+
+        bench_add(&times[BENCH_RPC_ROUND_TRIP], start);
+    }
+
+    trg_mock_daemon_free(daemon);
+}
+
+static gboolean bench_visible_func(GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
+{
+    trg_torrent_filter_row *filterRow;
+    guint flags;
+
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_FLAGS, &flags, TORRENT_COLUMN_FILTER_ROW,
+                       &filterRow, -1);
+
+    return trg_torrent_filter_match((trg_torrent_filter *)data, flags, filterRow);
+}
+
+static void bench_torrent_model(TrgClient *tc, gint64 n, trg_bench_times *times)
+{
+    TrgTorrentModel *model = trg_torrent_model_new();
+    GtkTreeModel *sorted, *filtered;
+    TrgStateSelector *selector;
+    trg_torrent_filter filter = { 0 };
+    g_autoptr(GPtrArray) fields = NULL;
+    g_autofree gchar *data = NULL;
+    JsonObject *response;
+    gsize len;
+    gint i;
+
+    trg_torrent_model_set_derived(model, TORRENT_DERIVED_ALL);
+    fields = bench_fields_new(model, trg_client_get_rpc_version(tc));
+
+    sorted = gtk_tree_model_sort_new_with_model(GTK_TREE_MODEL(model));
+    filtered = trg_sortable_filtered_model_new(GTK_TREE_SORTABLE(sorted), NULL);
+    gtk_tree_model_filter_set_visible_func(GTK_TREE_MODEL_FILTER(filtered), bench_visible_func,
+                                           &filter, NULL);
+    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(sorted), TORRENT_COLUMN_NAME,
+                                         GTK_SORT_ASCENDING);
+
+    selector = g_object_ref_sink(trg_state_selector_new(tc, model));
+
+    /* The first response as it would arrive, serialized once. */
+    response = bench_response_new(fields, n, 0, FALSE);
+    data = bench_serialize(response, &len);
+    json_object_unref(response);
+
+    for (i = 0; i < bench_iterations; i++) {
+        g_autoptr(JsonParser) parser = json_parser_new();
+        trg_torrent_model_update_stats *stats;
+        gint64 start;
+
+        trg_torrent_model_remove_all(model);
+
+        /* As the client's response handler does. */
+        start = g_get_monotonic_time();
+        if (!g_utf8_validate(data, len, NULL)
+            || !json_parser_load_from_data(parser, data, len, NULL)) {
+            g_printerr("trg-benchmark: unable to parse a generated response\n");
+            exit(EXIT_FAILURE);
+        }
+        bench_add(&times[BENCH_RPC_PARSE], start);
+
+        response = json_node_get_object(json_parser_get_root(parser));
+        start = g_get_monotonic_time();
+        stats = trg_torrent_model_update(model, tc, response, TORRENT_GET_MODE_FIRST);
+        bench_add(&times[BENCH_MODEL_FIRST], start);
+
+        start = g_get_monotonic_time();
+        trg_state_selector_stats_update(selector, stats);
+        bench_add(&times[BENCH_STATE_SELECTOR], start);
+
+        response = bench_response_new(fields, n, i + 1, FALSE);
+        start = g_get_monotonic_time();
+        trg_torrent_model_update(model, tc, response, TORRENT_GET_MODE_UPDATE);
+        bench_add(&times[BENCH_MODEL_UPDATE], start);
+        json_object_unref(response);
+
+        response = bench_response_new(fields, MAX(1, n / BENCH_ACTIVE_DIVISOR), i + 2, TRUE);
+        start = g_get_monotonic_time();
+        trg_torrent_model_update(model, tc, response, TORRENT_GET_MODE_ACTIVE);
+        bench_add(&times[BENCH_MODEL_ACTIVE], start);
+        json_object_unref(response);
+
+        trg_torrent_filter_compile(&filter, 0, NULL, "ubuntu-1");
+        start = g_get_monotonic_time();
+        gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(filtered));
+        bench_add(&times[BENCH_REFILTER_NAME], start);
+
+        trg_torrent_filter_compile(&filter, 0, NULL, "ratio>0.5 tracker:example.org");
+        start = g_get_monotonic_time();
+        gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(filtered));
+        bench_add(&times[BENCH_REFILTER_QUERY], start);
+
+        trg_torrent_filter_compile(&filter, 0, NULL, NULL);
+        gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(filtered));
+
+        start = g_get_monotonic_time();
+        gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(sorted),
+                                             i % 2 ? TORRENT_COLUMN_NAME : TORRENT_COLUMN_RATIO,
+                                             GTK_SORT_ASCENDING);
+        bench_add(&times[BENCH_SORT], start);
+    }
+
+    trg_torrent_model_remove_all(model);
+    trg_torrent_filter_clear(&filter);
+    gtk_widget_destroy(GTK_WIDGET(selector));
+    g_object_unref(selector);
+    g_object_unref(filtered);
+    g_object_unref(sorted);
+    g_object_unref(model);
+}
+
+static void bench_files_model(gint64 n, trg_bench_times *times)
+{
+    TrgFilesModel *model = trg_files_model_new();
+    GtkWidget *tv = g_object_ref_sink(gtk_tree_view_new_with_model(GTK_TREE_MODEL(model)));
+    gint i;
+
+    for (i = 0; i < bench_iterations; i++) {
+        JsonObject *t = bench_detail_torrent_new(1, n, 0, i);
+        gint64 start = g_get_monotonic_time();
+
+        /* Big lists are built in a thread and applied from an idle. */
+        trg_files_model_update(model, GTK_TREE_VIEW(tv), i, t, TORRENT_GET_MODE_FIRST);
+        while (gtk_tree_model_iter_n_children(GTK_TREE_MODEL(model), NULL) == 0)
+            g_main_context_iteration(NULL, TRUE);
+        bench_add(&times[BENCH_FILES_FIRST], start);
+        json_object_unref(t);
+
+        t = bench_detail_torrent_new(1, n, 0, i + 1);
+        start = g_get_monotonic_time();
+        trg_files_model_update(model, GTK_TREE_VIEW(tv), i, t, TORRENT_GET_MODE_UPDATE);
+        bench_add(&times[BENCH_FILES_UPDATE], start);
+        json_object_unref(t);
+    }
+
+    gtk_widget_destroy(tv);
+    g_object_unref(tv);
+    g_object_unref(model);
+}
+
+/* Select torrents spread over the list in turn, loading their files and
+ * peers, whose counts vary per torrent. Every other one is the previous
+ * torrent polled again. */
+static void bench_detail(gint64 n, trg_bench_times *times)
+{
+    TrgFilesModel *files = trg_files_model_new();
+    TrgPeersModel *peers = trg_peers_model_new();
+    GtkWidget *filesTv = g_object_ref_sink(gtk_tree_view_new_with_model(GTK_TREE_MODEL(files)));
+    GtkWidget *peersTv = g_object_ref_sink(trg_tree_view_new());
+    gint64 step = MAX(1, n / BENCH_DETAIL_TORRENTS);
+    gint64 serial = 0;
+    gint i, j;
+
+    for (i = 0; i < bench_iterations; i++) {
+        for (j = 0; j < BENCH_DETAIL_TORRENTS; j++) {
+            gint mode = j % 2 ? TORRENT_GET_MODE_UPDATE : TORRENT_GET_MODE_FIRST;
+            gint64 id = (j - j % 2) * step;
+            JsonObject *t = bench_detail_torrent_new(id, bench_file_count(id),
+                                                     bench_peer_count(id), i + j % 2);
+            gint64 start;
+
+            serial++;
+
+            start = g_get_monotonic_time();
+            trg_files_model_update(files, GTK_TREE_VIEW(filesTv), serial, t, mode);
+            bench_add(&times[BENCH_DETAIL_FILES], start);
+
+            start = g_get_monotonic_time();
+            trg_peers_model_update(peers, TRG_TREE_VIEW(peersTv), serial, t, mode);
+            bench_add(&times[BENCH_DETAIL_PEERS], start);
+
+            json_object_unref(t);
+        }
+    }
+
+    gtk_widget_destroy(filesTv);
+    gtk_widget_destroy(peersTv);
+    g_object_unref(filesTv);
+    g_object_unref(peersTv);
+    g_object_unref(peers);
+    g_object_unref(files);
+}
+
+static void bench_torrent_file(gint64 n, trg_bench_times *times)
+{
+    g_autofree gchar *filename = bench_torrent_file_new(n);
+    gint i;
+
+    for (i = 0; i < bench_iterations; i++) {
+        g_autoptr(GError) error = NULL;
+        gint64 start = g_get_monotonic_time();
+        trg_torrent_file *file = trg_parse_torrent_file(filename, &error);
+
+        bench_add(&times[BENCH_TORRENT_FILE], start);
+
+        if (!file) {
+            g_printerr("trg-benchmark: unable to parse %s\n", filename);
+            exit(EXIT_FAILURE);
+        }
+
+        trg_torrent_file_free(file);
+    }
+
+    g_unlink(filename);
+}
+
+static void bench_write_times(JsonBuilder *builder, trg_bench_times *times)
+{
+    guint i;
+
+    json_builder_begin_object(builder);
+
+    for (i = 0; i < BENCH_COUNT; i++) {
+        if (times[i].count == 0)
+            continue;
+
+        json_builder_set_member_name(builder, trg_bench_names[i]);
+        json_builder_begin_object(builder);
+        json_builder_set_member_name(builder, "count");
+        json_builder_add_int_value(builder, times[i].count);
+        json_builder_set_member_name(builder, "total-us");
+        json_builder_add_int_value(builder, times[i].total);
+        json_builder_set_member_name(builder, "min-us");
+        json_builder_add_int_value(builder, times[i].min);
+        json_builder_set_member_name(builder, "max-us");
+        json_builder_add_int_value(builder, times[i].max);
+        json_builder_set_member_name(builder, "mean-us");
+        json_builder_add_int_value(builder, times[i].total / times[i].count);
+        json_builder_end_object(builder);
+    }
+
+    json_builder_end_object(builder);
+}
+
+static TrgClient *bench_client_new(void)
+{
+    TrgClient *tc = trg_client_new();
+    JsonObject *session = json_object_new();
+
+    json_object_set_string_member(session, SGET_VERSION, "4.0.0 (benchmark)");
+    json_object_set_int_member(session, SGET_RPC_VERSION, 17);
+    json_object_set_string_member(session, SGET_DOWNLOAD_DIR, "/downloads/dir0");
+    json_object_set_double_member(session, SGET_SEED_RATIO_LIMIT, 2.0);
+    json_object_set_boolean_member(session, SGET_SEED_RATIO_LIMITED, FALSE);
+
+    trg_client_set_session(tc, session);
+    json_object_unref(session);
+
+    return tc;
+}
+
+int main(int argc, char *argv[])
+{
+    g_autoptr(GOptionContext) context = g_option_context_new("- benchmark the update paths");
+    g_autoptr(GError) error = NULL;
+    g_autoptr(JsonBuilder) builder = json_builder_new();
+    g_autoptr(JsonGenerator) generator = NULL;
+    g_autoptr(JsonNode) root = NULL;
+    g_auto(GStrv) sizes = NULL;
+    TrgClient *tc;
+    guint i;
+
+    g_set_application_name("trg-benchmark");
+    g_option_context_add_main_entries(context, bench_entries, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("trg-benchmark: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    if (!gtk_init_check(&argc, &argv)) {
+        g_printerr("trg-benchmark: no display, skipping\n");
+        return 77;
+    }
+
+    bench_iterations = MAX(bench_iterations, 1);
+    sizes = g_strsplit(bench_sizes ? bench_sizes : "1000,10000,100000", ",", -1);
+    tc = bench_client_new();
+
+    json_builder_begin_object(builder);
+    json_builder_set_member_name(builder, "version");
+    json_builder_add_string_value(builder, PACKAGE_VERSION);
+    json_builder_set_member_name(builder, "iterations");
+    json_builder_add_int_value(builder, bench_iterations);
+    json_builder_set_member_name(builder, "fixtures");
+    json_builder_begin_object(builder);
+
+    for (i = 0; sizes[i]; i++) {
+        trg_bench_times times[BENCH_COUNT] = { { 0 } };
+        gint64 n = g_ascii_strtoll(sizes[i], NULL, 10);
+
+        if (n <= 0)
+            continue;
+
+        g_printerr("trg-benchmark: %" G_GINT64_FORMAT " torrents\n", n);
+
+        bench_rpc_round_trip(n, times);
+        bench_torrent_model(tc, n, times);
+        bench_files_model(n, times);
+        bench_detail(n, times);
+        bench_torrent_file(n, times);
+
+        json_builder_set_member_name(builder, sizes[i]);
+        bench_write_times(builder, times);
+    }
+
+    json_builder_end_object(builder);
+    json_builder_end_object(builder);
+
+    root = json_builder_get_root(builder);
+    generator = trg_json_serializer(root, TRUE);
+
+    if (bench_output) {
+        if (!json_generator_to_file(generator, bench_output, &error)) {
+            g_printerr("trg-benchmark: unable to write %s: %s\n", bench_output, error->message);
+            return EXIT_FAILURE;
+        }
+    } else {
+        g_autofree gchar *json = json_generator_to_data(generator, NULL);
+        g_print("%s\n", json);
+    }
+
+    g_object_unref(tc);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Runs a trg-mock-daemon.c stand-in daemon until interrupted. */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include "trg-mock-daemon.h"
+
+static gchar *mock_host = NULL;
+static gint mock_port = 9091;
+static gchar *mock_path = NULL;
+static gchar *mock_user = NULL;
+static gchar *mock_password = NULL;
+static gint mock_seed = 0;
+static trg_mock_options mock_options = { .torrents = 500, .churn = 0.1 };
+
+static GOptionEntry mock_entries[] = {
+    { "host", 0, 0, G_OPTION_ARG_STRING, &mock_host, "Address to listen on (127.0.0.1)", "ADDR" },
+    { "port", 'p', 0, G_OPTION_ARG_INT, &mock_port, "Port to listen on (9091)", "PORT" },
+    { "path", 0, 0, G_OPTION_ARG_STRING, &mock_path, "RPC path (" TRG_MOCK_DEFAULT_PATH ")",
+      "PATH" },
+    { "torrents", 'n', 0, G_OPTION_ARG_INT, &mock_options.torrents, "Torrents to start with (500)",
+      "N" },
+    { "churn", 0, 0, G_OPTION_ARG_DOUBLE, &mock_options.churn,
+      "Share of torrents whose stats change each second (0.1)", "FRACTION" },
+    { "rotate-ids", 0, 0, G_OPTION_ARG_DOUBLE, &mock_options.rotateIds,
+      "Chance each second of removing a torrent and adding another", "FRACTION" },
+    { "rotate-session", 0, 0, G_OPTION_ARG_INT, &mock_options.rotateSession,
+      "Seconds between session id changes (never)", "SECS" },
+    { "latency", 0, 0, G_OPTION_ARG_INT, &mock_options.latency, "Milliseconds per request", "MS" },
+    { "jitter", 0, 0, G_OPTION_ARG_INT, &mock_options.jitter,
+      "Up to this many extra milliseconds per request", "MS" },
+    { "bandwidth", 0, 0, G_OPTION_ARG_INT, &mock_options.bandwidth,
+      "Response bytes per second (unlimited)", "BYTES" },
+    { "error-rate", 0, 0, G_OPTION_ARG_DOUBLE, &mock_options.errorRate,
+      "Share of requests that fail", "FRACTION" },
+    { "user", 'u', 0, G_OPTION_ARG_STRING, &mock_user, "Require basic auth as this user", "USER" },
+    { "password", 0, 0, G_OPTION_ARG_STRING, &mock_password, "The basic auth password",
+      "PASSWORD" },
+    { "seed", 0, 0, G_OPTION_ARG_INT, &mock_seed, "Random seed for the simulated torrents", "N" },
+    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &mock_options.verbose, "Log each request", NULL },
+    { NULL },
+};
+
+int main(int argc, char *argv[])
+{
+    g_autoptr(GOptionContext) context = g_option_context_new("- a stand-in Transmission daemon");
+    g_autoptr(GMainLoop) loop = NULL;
+    g_autoptr(GError) error = NULL;
+    trg_mock_daemon *daemon;
+    guint port;
+
+    g_set_application_name("trg-mock-daemon");
+    g_option_context_add_main_entries(context, mock_entries, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("trg-mock-daemon: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    mock_options.path = mock_path;
+    mock_options.user = mock_user;
+    mock_options.password = mock_password;
+    mock_options.seed = mock_seed;
+
+    daemon = trg_mock_daemon_new(&mock_options);
+    port = trg_mock_daemon_listen(daemon, mock_host ? mock_host : "127.0.0.1",
+                                  CLAMP(mock_port, 0, G_MAXUINT16), &error);
+    if (!port) {
+        g_printerr("trg-mock-daemon: %s\n", error->message);
+        trg_mock_daemon_free(daemon);
+        return EXIT_FAILURE;
+    }
+
+    g_print("Serving %d torrents on http://%s:%u%s\n", mock_options.torrents,
+            mock_host ? mock_host : "127.0.0.1", port,
+            mock_path ? mock_path : TRG_MOCK_DEFAULT_PATH);
+
+    loop = g_main_loop_new(NULL, FALSE);
+    g_main_loop_run(loop);
+
+    trg_mock_daemon_free(daemon);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1574 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A stand-in Transmission daemon for load and latency testing.
+ *
+ * Serves the RPC methods requests.c uses from a set of simulated torrents,
+ * so the client can be run against thousands of torrents, a slow or flaky
+ * link, or a daemon that keeps rotating its session id, without a real
+ * daemon or any network access. trg-mock-daemon runs one on its own:
+ *
+ *   trg-mock-daemon --torrents 5000 --churn 0.05 --latency 200
+ *
+ * then connect the client to localhost:9091. trg-benchmark runs one on a
+ * loopback port for its rpc-round-trip stage.
+ *
+ * Implements session-get/set/stats, torrent-get (ids, "recently-active",
+ * fields and the "table" format), torrent-set, torrent-add, torrent-remove,
+ * torrent-start/stop/verify, the 409 session id exchange and, with a user,
+ * basic auth. Everything else (reannounce, the queue moves, renames)
+ * succeeds without doing anything.
+ *
+ * Each second, churn is the share of torrents whose rates, peers and
+ * progress move on, and rotateIds the chance of one torrent being removed
+ * and another added. Requests can be held back (latency, plus up to jitter
+ * more milliseconds), have their responses trickled out (bandwidth, in
+ * bytes per second) or fail (errorRate, half with a 500 and half with an
+ * unsuccessful result).
+ *
+ * Torrents are kept as plain structs and torrent-get responses written out
+ * directly, so even 100k torrents take little memory and serving them costs
+ * about what it does a real daemon.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+#include <string.h>
+
+#include "protocol-constants.h"
+#include "session-get.h"
+#include "trg-client.h"
+#include "trg-mock-daemon.h"
+
+#define MOCK_RPC_VERSION 17
+/* How long a torrent counts as recently active, or as removed. */
+#define MOCK_RECENT_SECS 60
+/* Trickled responses go out this often. */
+#define MOCK_TRICKLE_MS 100
+/* Peers listed per torrent, of however many are connected. */
+#define MOCK_PEERS_LISTED 8
+
+#define MOCK_MIB ((gint64)1024 * 1024)
+
+typedef enum {
+    MOCK_ID,
+    MOCK_NAME,
+    MOCK_HASH_STRING,
+    MOCK_STATUS,
+    MOCK_TOTAL_SIZE,
+    MOCK_SIZE_WHEN_DONE,
+    MOCK_PERCENT_DONE,
+    MOCK_LEFT_UNTIL_DONE,
+    MOCK_HAVE_VALID,
+    MOCK_HAVE_UNCHECKED,
+    MOCK_METADATA_PERCENT_COMPLETE,
+    MOCK_RECHECK_PROGRESS,
+    MOCK_RATE_DOWNLOAD,
+    MOCK_RATE_UPLOAD,
+    MOCK_ETA,
+    MOCK_UPLOADED_EVER,
+    MOCK_DOWNLOADED_EVER,
+    MOCK_CORRUPT_EVER,
+    MOCK_UPLOAD_RATIO,
+    MOCK_ADDED_DATE,
+    MOCK_DONE_DATE,
+    MOCK_DATE_CREATED,
+    MOCK_ACTIVITY_DATE,
+    MOCK_DOWNLOAD_DIR,
+    MOCK_BANDWIDTH_PRIORITY,
+    MOCK_QUEUE_POSITION,
+    MOCK_ERROR,
+    MOCK_ERROR_STRING,
+    MOCK_IS_FINISHED,
+    MOCK_IS_PRIVATE,
+    MOCK_SEED_RATIO_MODE,
+    MOCK_SEED_RATIO_LIMIT,
+    MOCK_HONORS_SESSION_LIMITS,
+    MOCK_DOWNLOAD_LIMIT,
+    MOCK_DOWNLOAD_LIMITED,
+    MOCK_UPLOAD_LIMIT,
+    MOCK_UPLOAD_LIMITED,
+    MOCK_PEER_LIMIT,
+    MOCK_PEERS_CONNECTED,
+    MOCK_PEERS_GETTING_FROM_US,
+    MOCK_PEERS_SENDING_TO_US,
+    MOCK_WEBSEEDS_SENDING_TO_US,
+    MOCK_PEERS_FROM,
+    MOCK_PEERS,
+    MOCK_COMMENT,
+    MOCK_CREATOR,
+    MOCK_MAGNET_LINK,
+    MOCK_FILE_COUNT,
+    MOCK_FILES,
+    MOCK_FILE_STATS,
+    MOCK_PRIORITIES,
+    MOCK_WANTED,
+    MOCK_TRACKER_STATS,
+    MOCK_FIELDS
+} trg_mock_field;
+
+static const gchar *const mock_field_names[MOCK_FIELDS] = {
+    [MOCK_ID] = FIELD_ID,
+    [MOCK_NAME] = FIELD_NAME,
+    [MOCK_HASH_STRING] = FIELD_HASH_STRING,
+    [MOCK_STATUS] = FIELD_STATUS,
+    [MOCK_TOTAL_SIZE] = FIELD_TOTAL_SIZE,
+    [MOCK_SIZE_WHEN_DONE] = FIELD_SIZEWHENDONE,
+    [MOCK_PERCENT_DONE] = FIELD_PERCENTDONE,
+    [MOCK_LEFT_UNTIL_DONE] = FIELD_LEFTUNTILDONE,
+    [MOCK_HAVE_VALID] = FIELD_HAVEVALID,
+    [MOCK_HAVE_UNCHECKED] = FIELD_HAVEUNCHECKED,
+    [MOCK_METADATA_PERCENT_COMPLETE] = FIELD_METADATAPERCENTCOMPLETE,
+    [MOCK_RECHECK_PROGRESS] = FIELD_RECHECK_PROGRESS,
+    [MOCK_RATE_DOWNLOAD] = FIELD_RATEDOWNLOAD,
+    [MOCK_RATE_UPLOAD] = FIELD_RATEUPLOAD,
+    [MOCK_ETA] = FIELD_ETA,
+    [MOCK_UPLOADED_EVER] = FIELD_UPLOADEDEVER,
+    [MOCK_DOWNLOADED_EVER] = FIELD_DOWNLOADEDEVER,
+    [MOCK_CORRUPT_EVER] = FIELD_CORRUPTEVER,
+    [MOCK_UPLOAD_RATIO] = "uploadRatio",
+    [MOCK_ADDED_DATE] = FIELD_ADDED_DATE,
+    [MOCK_DONE_DATE] = FIELD_DONE_DATE,
+    [MOCK_DATE_CREATED] = FIELD_DATE_CREATED,
+    [MOCK_ACTIVITY_DATE] = FIELD_ACTIVITY_DATE,
+    [MOCK_DOWNLOAD_DIR] = FIELD_DOWNLOAD_DIR,
+    [MOCK_BANDWIDTH_PRIORITY] = FIELD_BANDWIDTH_PRIORITY,
+    [MOCK_QUEUE_POSITION] = FIELD_QUEUE_POSITION,
+    [MOCK_ERROR] = FIELD_ERROR,
+    [MOCK_ERROR_STRING] = FIELD_ERROR_STRING,
+    [MOCK_IS_FINISHED] = FIELD_ISFINISHED,
+    [MOCK_IS_PRIVATE] = FIELD_ISPRIVATE,
+    [MOCK_SEED_RATIO_MODE] = FIELD_SEED_RATIO_MODE,
+    [MOCK_SEED_RATIO_LIMIT] = FIELD_SEED_RATIO_LIMIT,
+    [MOCK_HONORS_SESSION_LIMITS] = FIELD_HONORS_SESSION_LIMITS,
+    [MOCK_DOWNLOAD_LIMIT] = FIELD_DOWNLOAD_LIMIT,
+    [MOCK_DOWNLOAD_LIMITED] = FIELD_DOWNLOAD_LIMITED,
+    [MOCK_UPLOAD_LIMIT] = FIELD_UPLOAD_LIMIT,
+    [MOCK_UPLOAD_LIMITED] = FIELD_UPLOAD_LIMITED,
+    [MOCK_PEER_LIMIT] = FIELD_PEER_LIMIT,
+    [MOCK_PEERS_CONNECTED] = FIELD_PEERS_CONNECTED,
+    [MOCK_PEERS_GETTING_FROM_US] = FIELD_PEERS_GETTING_FROM_US,
+    [MOCK_PEERS_SENDING_TO_US] = FIELD_PEERS_SENDING_TO_US,
+    [MOCK_WEBSEEDS_SENDING_TO_US] = FIELD_WEB_SEEDS_SENDING_TO_US,
+    [MOCK_PEERS_FROM] = FIELD_PEERSFROM,
+    [MOCK_PEERS] = FIELD_PEERS,
+    [MOCK_COMMENT] = FIELD_COMMENT,
+    [MOCK_CREATOR] = FIELD_CREATOR,
+    [MOCK_MAGNET_LINK] = FIELD_MAGNETLINK,
+    [MOCK_FILE_COUNT] = FIELD_FILE_COUNT,
+    [MOCK_FILES] = FIELD_FILES,
+    [MOCK_FILE_STATS] = "fileStats",
+    [MOCK_PRIORITIES] = FIELD_PRIORITIES,
+    [MOCK_WANTED] = FIELD_WANTED,
+    [MOCK_TRACKER_STATS] = FIELD_TRACKER_STATS,
+};
+
+typedef struct {
+    gint64 id;
+    gchar *name;
+    gchar *hash;
+    gchar *downloadDir;
+    const gchar *tracker;
+    gint status;
+    gint nFiles;
+    gint64 *fileSizes;
+    gint *priorities;
+    gboolean *wanted;
+    gint64 sizeWhenDone;
+    gint64 leftUntilDone;
+    gint64 downloadedEver;
+    gint64 uploadedEver;
+    gint64 rateDownload;
+    gint64 rateUpload;
+    gint64 eta;
+    gint64 addedDate;
+    gint64 doneDate;
+    gint64 activityDate;
+    gint64 queuePosition;
+    gint peersConnected;
+    gint peersSendingToUs;
+    gint peersGettingFromUs;
+    /* The listed peers are generated from this, which churn changes. */
+    guint32 peerSeed;
+    gint seeders;
+    gint leechers;
+    gint downloads;
+    gint bandwidthPriority;
+    gint seedRatioMode;
+    gdouble seedRatioLimit;
+    gboolean honorsSessionLimits;
+    gint64 downloadLimit;
+    gboolean downloadLimited;
+    gint64 uploadLimit;
+    gboolean uploadLimited;
+    gint64 peerLimit;
+} trg_mock_torrent;
+
+typedef struct {
+    gint64 id;
+    gint64 when;
+} trg_mock_removed;
+
+struct _trg_mock_daemon {
+    trg_mock_options options;
+    gchar *path;
+    gchar *user;
+    gchar *password;
+    SoupServer *server;
+    GRand *rand;
+    /* name -> trg_mock_field + 1 */
+    GHashTable *fields;
+    /* &id -> trg_mock_torrent, in id order */
+    GTree *torrents;
+    /* trg_mock_removed, oldest first */
+    GArray *removed;
+    JsonObject *session;
+    gchar *sessionId;
+    gint64 sessionSince;
+    gint64 lastTick;
+    gint64 started;
+    gint64 nextId;
+};
+
+static const gchar *const mock_trackers[]
+    = { "tracker.example.org", "open.example.net", "private.example.com" };
+
+static const gchar *const mock_dirs[]
+    = { "/srv/downloads", "/srv/downloads/tv", "/srv/downloads/music", "/srv/seeding" };
+
+static const gint mock_file_counts[] = { 1, 1, 1, 3, 12, 40 };
+
+static const gint mock_added_states[]
+    = { TR_STATUS_STOPPED, TR_STATUS_DOWNLOAD, TR_STATUS_DOWNLOAD_WAIT };
+
+static const gint mock_churn_states[] = { TR_STATUS_STOPPED, TR_STATUS_DOWNLOAD, TR_STATUS_SEED,
+                                          TR_STATUS_SEED_WAIT, TR_STATUS_DOWNLOAD_WAIT };
+
+#define mock_choice(rand, array) ((array)[g_rand_int_range((rand), 0, G_N_ELEMENTS(array))])
+
+static gint64 mock_now(void)
+{
+    return g_get_real_time() / G_USEC_PER_SEC;
+}
+
+static gint mock_id_compare(gconstpointer a, gconstpointer b, gpointer data)
+{
+    gint64 x = *(const gint64 *)a;
+    gint64 y = *(const gint64 *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void mock_torrent_free(trg_mock_torrent *t)
+{
+    g_free(t->name);
+    g_free(t->hash);
+    g_free(t->downloadDir);
+    g_free(t->fileSizes);
+    g_free(t->priorities);
+    g_free(t->wanted);
+    g_free(t);
+}
+
+static gdouble mock_percent_done(trg_mock_torrent *t)
+{
+    return 1.0 - (gdouble)t->leftUntilDone / t->sizeWhenDone;
+}
+
+static trg_mock_torrent *mock_add(trg_mock_daemon *daemon, const gchar *name)
+{
+    GRand *rand = daemon->rand;
+    trg_mock_torrent *t = g_new0(trg_mock_torrent, 1);
+    gint64 now = mock_now();
+    gdouble done;
+    gint i;
+
+    t->id = daemon->nextId++;
+    t->name = name ? g_strdup(name)
+                   : g_strdup_printf("Mock Torrent %" G_GINT64_FORMAT " %06x", t->id,
+                                     (guint)g_rand_int_range(rand, 0, 0x1000000));
+    t->hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, t->name, -1);
+    t->tracker = mock_choice(rand, mock_trackers);
+    t->downloadDir = g_strdup(mock_choice(rand, mock_dirs));
+
+    t->nFiles = mock_choice(rand, mock_file_counts);
+    t->fileSizes = g_new(gint64, t->nFiles);
+    t->priorities = g_new0(gint, t->nFiles);
+    t->wanted = g_new(gboolean, t->nFiles);
+    for (i = 0; i < t->nFiles; i++) {
+        t->fileSizes[i] = g_rand_int_range(rand, 1, 2049) * MOCK_MIB;
+        t->wanted[i] = TRUE;
+        t->sizeWhenDone += t->fileSizes[i];
+    }
+
+    switch (g_rand_int_range(rand, 0, 4)) {
+    case 0:
+        done = 0.0;
+        break;
+    case 1:
+        done = g_rand_double(rand);
+        break;
+    default:
+        done = 1.0;
+        break;
+    }
+
+    t->leftUntilDone = (gint64)(t->sizeWhenDone * (1.0 - done));
+    t->downloadedEver = t->sizeWhenDone - t->leftUntilDone;
+    t->uploadedEver = (gint64)(t->sizeWhenDone * g_rand_double(rand) * 2);
+    t->status = t->leftUntilDone ? mock_choice(rand, mock_added_states) : TR_STATUS_SEED;
+    t->eta = -1;
+    t->addedDate = now - g_rand_int_range(rand, 0, 365 * 86400);
+    t->activityDate = now;
+    t->queuePosition = t->id - 1;
+    t->seeders = g_rand_int_range(rand, 0, 501);
+    t->leechers = g_rand_int_range(rand, 0, 101);
+    t->downloads = g_rand_int_range(rand, 0, 5001);
+    t->seedRatioLimit = 2.0;
+    t->honorsSessionLimits = TRUE;
+    t->downloadLimit = t->uploadLimit = 100;
+    t->peerLimit = 50;
+
+    g_tree_insert(daemon->torrents, &t->id, t);
+
+    return t;
+}
+
+static void mock_remove(trg_mock_daemon *daemon, gint64 id)
+{
+    trg_mock_removed removed = { id, mock_now() };
+
+    if (g_tree_remove(daemon->torrents, &id))
+        g_array_append_val(daemon->removed, removed);
+}
+
+static void mock_churn(trg_mock_daemon *daemon, trg_mock_torrent *t, gint64 now)
+{
+    GRand *rand = daemon->rand;
+
+    if (t->status == TR_STATUS_DOWNLOAD || t->status == TR_STATUS_SEED) {
+        gint peers = g_rand_int_range(rand, 0, 41);
+
+        t->peersConnected = peers;
+        t->peersSendingToUs
+            = t->status == TR_STATUS_DOWNLOAD ? g_rand_int_range(rand, 0, peers + 1) : 0;
+        t->peersGettingFromUs = g_rand_int_range(rand, 0, peers + 1);
+        t->peerSeed = g_rand_int(rand);
+        t->rateUpload = g_rand_int_range(rand, 0, MOCK_MIB + 1);
+        t->uploadedEver += t->rateUpload;
+    } else {
+        t->peersConnected = t->peersSendingToUs = t->peersGettingFromUs = 0;
+        t->rateUpload = 0;
+    }
+
+    if (t->status == TR_STATUS_DOWNLOAD) {
+        gint64 got;
+
+        t->rateDownload = g_rand_int_range(rand, 0, 8 * MOCK_MIB + 1);
+        got = MIN(t->rateDownload, t->leftUntilDone);
+        t->leftUntilDone -= got;
+        t->downloadedEver += got;
+        t->eta = t->rateDownload ? t->leftUntilDone / t->rateDownload : -1;
+
+        if (t->leftUntilDone == 0) {
+            t->status = TR_STATUS_SEED;
+            t->doneDate = now;
+            t->eta = -1;
+        }
+    } else {
+        t->rateDownload = 0;
+        t->eta = -1;
+    }
+
+    if (g_rand_double(rand) < 0.02) {
+        t->status = mock_choice(rand, mock_churn_states);
+        if ((t->status == TR_STATUS_DOWNLOAD || t->status == TR_STATUS_DOWNLOAD_WAIT)
+            && t->leftUntilDone == 0)
+            t->status = TR_STATUS_SEED;
+    }
+
+    t->activityDate = now;
+}
+
+typedef struct {
+    GPtrArray *torrents;
+    gint64 since;
+} trg_mock_collect;
+
+static gboolean mock_collect_func(gpointer key, gpointer value, gpointer data)
+{
+    trg_mock_collect *collect = data;
+    trg_mock_torrent *t = value;
+
+    if (t->activityDate >= collect->since)
+        g_ptr_array_add(collect->torrents, t);
+
+    return FALSE;
+}
+
+/* The torrents active since the given time (G_MININT64 for all), in id order. */
+static GPtrArray *mock_collect(trg_mock_daemon *daemon, gint64 since)
+{
+    trg_mock_collect collect = { g_ptr_array_new(), since };
+
+    g_tree_foreach(daemon->torrents, mock_collect_func, &collect);
+
+    return collect.torrents;
+}
+
+/* Move the simulation on by however many whole seconds have passed. */
+static void mock_tick(trg_mock_daemon *daemon)
+{
+    trg_mock_options *options = &daemon->options;
+    gint64 now = mock_now();
+    guint i;
+
+    if (options->rotateSession > 0 && now - daemon->sessionSince >= options->rotateSession) {
+        g_free(daemon->sessionId);
+        daemon->sessionId = g_uuid_string_random();
+        daemon->sessionSince = now;
+    }
+
+    /* Catching up on a long quiet spell one second at a time would only
+     * hold up this request; the last minute is all anything can see. */
+    daemon->lastTick = MAX(daemon->lastTick, now - MOCK_RECENT_SECS);
+
+    while (now - daemon->lastTick >= 1) {
+        g_autoptr(GPtrArray) torrents = mock_collect(daemon, G_MININT64);
+        guint count = MIN((guint)(torrents->len * options->churn + g_rand_double(daemon->rand)),
+                          torrents->len);
+
+        daemon->lastTick++;
+
+        /* A partial shuffle picks count different torrents. */
+        for (i = 0; i < count; i++) {
+            guint j = g_rand_int_range(daemon->rand, i, torrents->len);
+            gpointer t = torrents->pdata[j];
+
+            torrents->pdata[j] = torrents->pdata[i];
+            torrents->pdata[i] = t;
+            mock_churn(daemon, t, now);
+        }
+
+        if (torrents->len && g_rand_double(daemon->rand) < options->rotateIds) {
+            trg_mock_torrent *t
+                = torrents->pdata[g_rand_int_range(daemon->rand, 0, torrents->len)];
+
+            mock_remove(daemon, t->id);
+            mock_add(daemon, NULL);
+        }
+    }
+
+    i = 0;
+    while (i < daemon->removed->len
+           && now - g_array_index(daemon->removed, trg_mock_removed, i).when >= MOCK_RECENT_SECS)
+        i++;
+    g_array_remove_range(daemon->removed, 0, i);
+}
+
+static void mock_write_string(GString *out, const gchar *s)
+{
+    g_string_append_c(out, '"');
+
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            g_string_append_c(out, '\\');
+            g_string_append_c(out, *s);
+        } else if ((guchar)*s < 0x20) {
+            g_string_append_printf(out, "\\u%04x", (guchar)*s);
+        } else {
+            g_string_append_c(out, *s);
+        }
+    }
+
+    g_string_append_c(out, '"');
+}
+
+static void mock_write_int(GString *out, gint64 value)
+{
+    g_string_append_printf(out, "%" G_GINT64_FORMAT, value);
+}
+
+static void mock_write_double(GString *out, gdouble value)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(out, g_ascii_dtostr(buf, sizeof(buf), value));
+}
+
+static void mock_write_boolean(GString *out, gboolean value)
+{
+    g_string_append(out, value ? "true" : "false");
+}
+
+static void mock_write_object(GString *out, JsonObject *obj)
+{
+    g_autoptr(JsonNode) node = json_node_init_object(json_node_alloc(), obj);
+    g_autofree gchar *text = json_to_string(node, FALSE);
+
+    g_string_append(out, text);
+}
+
+static gchar *mock_file_name(trg_mock_torrent *t, gint i)
+{
+    return t->nFiles > 1 ? g_strdup_printf("%s/file-%03d.bin", t->name, i) : g_strdup(t->name);
+}
+
+static gint64 mock_file_completed(trg_mock_torrent *t, gint i)
+{
+    return (gint64)(t->fileSizes[i] * mock_percent_done(t));
+}
+
+static void mock_write_peers(GString *out, trg_mock_torrent *t)
+{
+    GRand *rand = g_rand_new_with_seed(t->peerSeed);
+    gint i;
+
+    g_string_append_c(out, '[');
+
+    for (i = 0; i < MIN(t->peersConnected, MOCK_PEERS_LISTED); i++) {
+        gint64 toClient = g_rand_int_range(rand, 0, 2 * MOCK_MIB + 1);
+        gint64 toPeer = g_rand_int_range(rand, 0, 512 * 1024 + 1);
+        gchar progress[G_ASCII_DTOSTR_BUF_SIZE];
+
+        g_ascii_dtostr(progress, sizeof(progress), g_rand_double(rand));
+        g_string_append_printf(
+            out,
+            "%s{\"address\":\"10.%d.%d.%d\",\"clientName\":\"Mock %d.%d\",\"flagStr\":\"TDEI\","
+            "\"isDownloadingFrom\":%s,\"isEncrypted\":true,\"isUploadingTo\":%s,"
+            "\"port\":51413,\"progress\":%s,\"rateToClient\":%" G_GINT64_FORMAT
+            ",\"rateToPeer\":%" G_GINT64_FORMAT "}",
+            i ? "," : "", g_rand_int_range(rand, 0, 256), g_rand_int_range(rand, 0, 256), i,
+            g_rand_int_range(rand, 1, 5), g_rand_int_range(rand, 0, 10),
+            toClient ? "true" : "false", toPeer ? "true" : "false", progress, toClient, toPeer);
+    }
+
+    g_string_append_c(out, ']');
+    g_rand_free(rand);
+}
+
+static void mock_write_field(GString *out, trg_mock_torrent *t, trg_mock_field field)
+{
+    gint i;
+
+    switch (field) {
+    case MOCK_ID:
+        mock_write_int(out, t->id);
+        break;
+    case MOCK_NAME:
+        mock_write_string(out, t->name);
+        break;
+    case MOCK_HASH_STRING:
+        mock_write_string(out, t->hash);
+        break;
+    case MOCK_STATUS:
+        mock_write_int(out, t->status);
+        break;
+    case MOCK_TOTAL_SIZE:
+    case MOCK_SIZE_WHEN_DONE:
+        mock_write_int(out, t->sizeWhenDone);
+        break;
+    case MOCK_PERCENT_DONE:
+        mock_write_double(out, mock_percent_done(t));
+        break;
+    case MOCK_LEFT_UNTIL_DONE:
+        mock_write_int(out, t->leftUntilDone);
+        break;
+    case MOCK_HAVE_VALID:
+        mock_write_int(out, t->sizeWhenDone - t->leftUntilDone);
+        break;
+    case MOCK_HAVE_UNCHECKED:
+    case MOCK_CORRUPT_EVER:
+    case MOCK_ERROR:
+    case MOCK_WEBSEEDS_SENDING_TO_US:
+    case MOCK_RECHECK_PROGRESS:
+        mock_write_int(out, 0);
+        break;
+    case MOCK_METADATA_PERCENT_COMPLETE:
+        mock_write_int(out, 1);
+        break;
+    case MOCK_RATE_DOWNLOAD:
+        mock_write_int(out, t->rateDownload);
+        break;
+    case MOCK_RATE_UPLOAD:
+        mock_write_int(out, t->rateUpload);
+        break;
+    case MOCK_ETA:
+        mock_write_int(out, t->eta);
+        break;
+    case MOCK_UPLOADED_EVER:
+        mock_write_int(out, t->uploadedEver);
+        break;
+    case MOCK_DOWNLOADED_EVER:
+        mock_write_int(out, t->downloadedEver);
+        break;
+    case MOCK_UPLOAD_RATIO:
+        mock_write_double(out, t->downloadedEver ? (gdouble)t->uploadedEver / t->downloadedEver
+                                                 : -1.0);
+        break;
+    case MOCK_ADDED_DATE:
+        mock_write_int(out, t->addedDate);
+        break;
+    case MOCK_DONE_DATE:
+        mock_write_int(out, t->doneDate);
+        break;
+    case MOCK_DATE_CREATED:
+        mock_write_int(out, t->addedDate - 86400);
+        break;
+    case MOCK_ACTIVITY_DATE:
+        mock_write_int(out, t->activityDate);
+        break;
+    case MOCK_DOWNLOAD_DIR:
+        mock_write_string(out, t->downloadDir);
+        break;
+    case MOCK_BANDWIDTH_PRIORITY:
+        mock_write_int(out, t->bandwidthPriority);
+        break;
+    case MOCK_QUEUE_POSITION:
+        mock_write_int(out, t->queuePosition);
+        break;
+    case MOCK_ERROR_STRING:
+    case MOCK_COMMENT:
+        mock_write_string(out, "");
+        break;
+    case MOCK_IS_FINISHED:
+        mock_write_boolean(out, FALSE);
+        break;
+    case MOCK_IS_PRIVATE:
+        mock_write_boolean(out, g_str_has_prefix(t->tracker, "private"));
+        break;
+    case MOCK_SEED_RATIO_MODE:
+        mock_write_int(out, t->seedRatioMode);
+        break;
+    case MOCK_SEED_RATIO_LIMIT:
+        mock_write_double(out, t->seedRatioLimit);
+        break;
+    case MOCK_HONORS_SESSION_LIMITS:
+        mock_write_boolean(out, t->honorsSessionLimits);
+        break;
+    case MOCK_DOWNLOAD_LIMIT:
+        mock_write_int(out, t->downloadLimit);
+        break;
+    case MOCK_DOWNLOAD_LIMITED:
+        mock_write_boolean(out, t->downloadLimited);
+        break;
+    case MOCK_UPLOAD_LIMIT:
+        mock_write_int(out, t->uploadLimit);
+        break;
+    case MOCK_UPLOAD_LIMITED:
+        mock_write_boolean(out, t->uploadLimited);
+        break;
+    case MOCK_PEER_LIMIT:
+        mock_write_int(out, t->peerLimit);
+        break;
+    case MOCK_PEERS_CONNECTED:
+        mock_write_int(out, t->peersConnected);
+        break;
+    case MOCK_PEERS_GETTING_FROM_US:
+        mock_write_int(out, t->peersGettingFromUs);
+        break;
+    case MOCK_PEERS_SENDING_TO_US:
+        mock_write_int(out, t->peersSendingToUs);
+        break;
+    case MOCK_PEERS_FROM:
+        g_string_append_printf(out,
+                               "{\"fromCache\":0,\"fromDht\":%d,\"fromIncoming\":0,\"fromLpd\":0,"
+                               "\"fromLtep\":0,\"fromPex\":0,\"fromTracker\":%d}",
+                               t->peersConnected - t->peersConnected / 2,
+                               t->peersConnected / 2);
+        break;
+    case MOCK_PEERS:
+        mock_write_peers(out, t);
+        break;
+    case MOCK_CREATOR:
+        mock_write_string(out, "trg-mock-daemon");
+        break;
+    case MOCK_MAGNET_LINK:
+        g_string_append_printf(out, "\"magnet:?xt=urn:btih:%s\"", t->hash);
+        break;
+    case MOCK_FILE_COUNT:
+        mock_write_int(out, t->nFiles);
+        break;
+    case MOCK_FILES:
+        g_string_append_c(out, '[');
+        for (i = 0; i < t->nFiles; i++) {
+            g_autofree gchar *name = mock_file_name(t, i);
+
+            g_string_append_printf(out,
+                                   "%s{\"bytesCompleted\":%" G_GINT64_FORMAT
+                                   ",\"length\":%" G_GINT64_FORMAT ",\"name\":",
+                                   i ? "," : "", mock_file_completed(t, i), t->fileSizes[i]);
+            mock_write_string(out, name);
+            g_string_append_c(out, '}');
+        }
+        g_string_append_c(out, ']');
+        break;
+    case MOCK_FILE_STATS:
+        g_string_append_c(out, '[');
+        for (i = 0; i < t->nFiles; i++)
+            g_string_append_printf(out,
+                                   "%s{\"bytesCompleted\":%" G_GINT64_FORMAT
+                                   ",\"priority\":%d,\"wanted\":%s}",
+                                   i ? "," : "", mock_file_completed(t, i), t->priorities[i],
+                                   t->wanted[i] ? "true" : "false");
+        g_string_append_c(out, ']');
+        break;
+    case MOCK_PRIORITIES:
+    case MOCK_WANTED:
+        g_string_append_c(out, '[');
+        for (i = 0; i < t->nFiles; i++)
+            g_string_append_printf(out, "%s%d", i ? "," : "",
+                                   field == MOCK_WANTED ? t->wanted[i] : t->priorities[i]);
+        g_string_append_c(out, ']');
+        break;
+    case MOCK_TRACKER_STATS:
+        g_string_append_printf(
+            out,
+            "[{\"announce\":\"https://%s/announce\",\"downloadCount\":%d,"
+            "\"host\":\"https://%s:443\",\"id\":0,\"lastAnnouncePeerCount\":%d,"
+            "\"lastAnnounceResult\":\"Success\",\"lastAnnounceTime\":%" G_GINT64_FORMAT
+            ",\"lastScrapeTime\":%" G_GINT64_FORMAT ",\"leecherCount\":%d,"
+            "\"scrape\":\"https://%s/scrape\",\"seederCount\":%d,\"tier\":0}]",
+            t->tracker, t->downloads, t->tracker, t->peersConnected, t->activityDate,
+            t->activityDate, t->leechers, t->tracker, t->seeders);
+        break;
+    case MOCK_FIELDS:
+        g_string_append(out, "null");
+        break;
+    }
+}
+
+static trg_mock_field mock_lookup_field(trg_mock_daemon *daemon, const gchar *name)
+{
+    gpointer field = name ? g_hash_table_lookup(daemon->fields, name) : NULL;
+
+    return field ? GPOINTER_TO_INT(field) - 1 : MOCK_FIELDS;
+}
+
+static const gchar *mock_node_string(JsonNode *node)
+{
+    return node && json_node_get_value_type(node) == G_TYPE_STRING ? json_node_get_string(node)
+                                                                   : NULL;
+}
+
+static const gchar *mock_get_string(JsonObject *obj, const gchar *key)
+{
+    return mock_node_string(json_object_get_member(obj, key));
+}
+
+static JsonArray *mock_get_array(JsonObject *obj, const gchar *key)
+{
+    JsonNode *node = json_object_get_member(obj, key);
+
+    return node && JSON_NODE_HOLDS_ARRAY(node) ? json_node_get_array(node) : NULL;
+}
+
+static JsonObject *mock_get_object(JsonObject *obj, const gchar *key)
+{
+    JsonNode *node = json_object_get_member(obj, key);
+
+    return node && JSON_NODE_HOLDS_OBJECT(node) ? json_node_get_object(node) : NULL;
+}
+
+static void mock_select_one(trg_mock_daemon *daemon, JsonNode *id, GPtrArray *torrents)
+{
+    const gchar *hash = mock_node_string(id);
+    g_autoptr(GPtrArray) all = NULL;
+    trg_mock_torrent *t;
+    gint64 n;
+    guint i;
+
+    if (!hash) {
+        if (!JSON_NODE_HOLDS_VALUE(id))
+            return;
+
+        n = json_node_get_int(id);
+        t = g_tree_lookup(daemon->torrents, &n);
+        if (t)
+            g_ptr_array_add(torrents, t);
+
+        return;
+    }
+
+    all = mock_collect(daemon, G_MININT64);
+    for (i = 0; i < all->len; i++) {
+        t = all->pdata[i];
+        if (!g_ascii_strcasecmp(t->hash, hash))
+            g_ptr_array_add(torrents, t);
+    }
+}
+
+/* The torrents a request's ids member asks for. With "recently-active",
+ * recent is set, and those removed lately should be listed too. */
+static GPtrArray *mock_select(trg_mock_daemon *daemon, JsonObject *args, gboolean *recent)
+{
+    JsonNode *ids = json_object_get_member(args, PARAM_IDS);
+    GPtrArray *torrents;
+    guint i;
+
+    *recent = FALSE;
+
+    if (!ids)
+        return mock_collect(daemon, G_MININT64);
+
+    if (!g_strcmp0(mock_node_string(ids), FIELD_RECENTLY_ACTIVE)) {
+        *recent = TRUE;
+        return mock_collect(daemon, mock_now() - MOCK_RECENT_SECS);
+    }
+
+    torrents = g_ptr_array_new();
+
+    if (JSON_NODE_HOLDS_ARRAY(ids)) {
+        JsonArray *array = json_node_get_array(ids);
+
+        for (i = 0; i < json_array_get_length(array); i++)
+            mock_select_one(daemon, json_array_get_element(array, i), torrents);
+    } else {
+        mock_select_one(daemon, ids, torrents);
+    }
+
+    return torrents;
+}
+
+static void mock_torrent_get(trg_mock_daemon *daemon, JsonObject *args, GString *out)
+{
+    JsonArray *requested = mock_get_array(args, PARAM_FIELDS);
+    gboolean table = !g_strcmp0(mock_get_string(args, "format"), "table");
+    g_autoptr(GPtrArray) names = g_ptr_array_new();
+    g_autoptr(GArray) fields = g_array_new(FALSE, FALSE, sizeof(trg_mock_field));
+    g_autoptr(GPtrArray) torrents = NULL;
+    gboolean recent;
+    guint i, j;
+
+    for (i = 0; requested && i < json_array_get_length(requested); i++) {
+        const gchar *name = mock_node_string(json_array_get_element(requested, i));
+        trg_mock_field field = mock_lookup_field(daemon, name);
+
+        /* Fields a real daemon doesn't know are left out, or null in a table. */
+        if (name && (table || field != MOCK_FIELDS)) {
+            g_ptr_array_add(names, (gpointer)name);
+            g_array_append_val(fields, field);
+        }
+    }
+
+    if (!requested) {
+        trg_mock_field field = MOCK_ID;
+
+        g_ptr_array_add(names, (gpointer)FIELD_ID);
+        g_array_append_val(fields, field);
+    }
+
+    torrents = mock_select(daemon, args, &recent);
+
+    g_string_append(out, "{\"torrents\":[");
+
+    if (table) {
+        g_string_append_c(out, '[');
+        for (j = 0; j < names->len; j++) {
+            if (j)
+                g_string_append_c(out, ',');
+            mock_write_string(out, names->pdata[j]);
+        }
+        g_string_append_c(out, ']');
+    }
+
+    for (i = 0; i < torrents->len; i++) {
+        if (i || table)
+            g_string_append_c(out, ',');
+
+        g_string_append_c(out, table ? '[' : '{');
+
+        for (j = 0; j < names->len; j++) {
+            if (j)
+                g_string_append_c(out, ',');
+
+            if (!table) {
+                mock_write_string(out, names->pdata[j]);
+                g_string_append_c(out, ':');
+            }
+
+            mock_write_field(out, torrents->pdata[i], g_array_index(fields, trg_mock_field, j));
+        }
+
+        g_string_append_c(out, table ? ']' : '}');
+    }
+
+    g_string_append_c(out, ']');
+
+    if (recent) {
+        g_string_append(out, ",\"removed\":[");
+        for (i = 0; i < daemon->removed->len; i++) {
+            if (i)
+                g_string_append_c(out, ',');
+            mock_write_int(out, g_array_index(daemon->removed, trg_mock_removed, i).id);
+        }
+        g_string_append_c(out, ']');
+    }
+
+    g_string_append_c(out, '}');
+}
+
+static void mock_set_files(trg_mock_torrent *t, JsonObject *args, const gchar *key, gint *values,
+                           gint value)
+{
+    JsonArray *indices = mock_get_array(args, key);
+    guint i;
+
+    for (i = 0; indices && i < json_array_get_length(indices); i++) {
+        gint64 index = json_array_get_int_element(indices, i);
+
+        if (index >= 0 && index < t->nFiles)
+            values[index] = value;
+    }
+}
+
+static void mock_torrent_set(trg_mock_daemon *daemon, JsonObject *args)
+{
+    g_autoptr(GPtrArray) torrents = NULL;
+    g_autoptr(GList) members = json_object_get_members(args);
+    const gchar *location = mock_get_string(args, FIELD_LOCATION);
+    gboolean recent;
+    GList *li;
+    guint i;
+
+    torrents = mock_select(daemon, args, &recent);
+
+    for (i = 0; i < torrents->len; i++) {
+        trg_mock_torrent *t = torrents->pdata[i];
+
+        for (li = members; li; li = g_list_next(li)) {
+            JsonNode *value = json_object_get_member(args, li->data);
+
+            if (!JSON_NODE_HOLDS_VALUE(value))
+                continue;
+
+            switch (mock_lookup_field(daemon, li->data)) {
+            case MOCK_BANDWIDTH_PRIORITY:
+                t->bandwidthPriority = json_node_get_int(value);
+                break;
+            case MOCK_QUEUE_POSITION:
+                t->queuePosition = json_node_get_int(value);
+                break;
+            case MOCK_SEED_RATIO_MODE:
+                t->seedRatioMode = json_node_get_int(value);
+                break;
+            case MOCK_SEED_RATIO_LIMIT:
+                t->seedRatioLimit = json_node_get_double(value);
+                break;
+            case MOCK_HONORS_SESSION_LIMITS:
+                t->honorsSessionLimits = json_node_get_boolean(value);
+                break;
+            case MOCK_DOWNLOAD_LIMIT:
+                t->downloadLimit = json_node_get_int(value);
+                break;
+            case MOCK_DOWNLOAD_LIMITED:
+                t->downloadLimited = json_node_get_boolean(value);
+                break;
+            case MOCK_UPLOAD_LIMIT:
+                t->uploadLimit = json_node_get_int(value);
+                break;
+            case MOCK_UPLOAD_LIMITED:
+                t->uploadLimited = json_node_get_boolean(value);
+                break;
+            case MOCK_PEER_LIMIT:
+                t->peerLimit = json_node_get_int(value);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (location) {
+            g_free(t->downloadDir);
+            t->downloadDir = g_strdup(location);
+        }
+
+        mock_set_files(t, args, FIELD_FILES_WANTED, t->wanted, TRUE);
+        mock_set_files(t, args, FIELD_FILES_UNWANTED, t->wanted, FALSE);
+        mock_set_files(t, args, FIELD_FILES_PRIORITY_LOW, t->priorities, -1);
+        mock_set_files(t, args, FIELD_FILES_PRIORITY_NORMAL, t->priorities, 0);
+        mock_set_files(t, args, FIELD_FILES_PRIORITY_HIGH, t->priorities, 1);
+
+        t->activityDate = mock_now();
+    }
+}
+
+static void mock_set_status(trg_mock_daemon *daemon, JsonObject *args, gint status)
+{
+    g_autoptr(GPtrArray) torrents = NULL;
+    gboolean recent;
+    guint i;
+
+    torrents = mock_select(daemon, args, &recent);
+
+    for (i = 0; i < torrents->len; i++) {
+        trg_mock_torrent *t = torrents->pdata[i];
+
+        t->status = status != TR_STATUS_DOWNLOAD || t->leftUntilDone ? status : TR_STATUS_SEED;
+        t->activityDate = mock_now();
+    }
+}
+
+static JsonObject *mock_torrent_add(trg_mock_daemon *daemon, JsonObject *args)
+{
+    const gchar *filename = mock_get_string(args, PARAM_FILENAME);
+    const gchar *downloadDir = mock_get_string(args, FIELD_FILE_DOWNLOAD_DIR);
+    JsonNode *paused = json_object_get_member(args, PARAM_PAUSED);
+    JsonObject *result = json_object_new();
+    JsonObject *added = json_object_new();
+    g_autofree gchar *name = NULL;
+    trg_mock_torrent *t;
+    const gchar *p;
+
+    /* A magnet link's display name, or the last part of a filename or URL. */
+    if (filename && (p = strstr(filename, "dn=")))
+        name = g_strndup(p + 3, strcspn(p + 3, "&"));
+    else if (filename && (p = strrchr(filename, '/')))
+        name = g_strdup(p + 1);
+    else if (filename)
+        name = g_strdup(filename);
+
+    t = mock_add(daemon, name && *name ? name : "Added Torrent");
+
+    if (downloadDir) {
+        g_free(t->downloadDir);
+        t->downloadDir = g_strdup(downloadDir);
+    }
+
+    if (paused && JSON_NODE_HOLDS_VALUE(paused) && json_node_get_boolean(paused))
+        t->status = TR_STATUS_STOPPED;
+
+    json_object_set_int_member(added, FIELD_ID, t->id);
+    json_object_set_string_member(added, FIELD_NAME, t->name);
+    json_object_set_string_member(added, FIELD_HASH_STRING, t->hash);
+    json_object_set_object_member(result, "torrent-added", added);
+
+    return result;
+}
+
+static void mock_torrent_remove(trg_mock_daemon *daemon, JsonObject *args)
+{
+    g_autoptr(GPtrArray) torrents = NULL;
+    gboolean recent;
+    guint i;
+
+    torrents = mock_select(daemon, args, &recent);
+
+    for (i = 0; i < torrents->len; i++)
+        mock_remove(daemon, ((trg_mock_torrent *)torrents->pdata[i])->id);
+}
+
+static JsonObject *mock_session_stats(trg_mock_daemon *daemon)
+{
+    g_autoptr(GPtrArray) torrents = mock_collect(daemon, G_MININT64);
+    JsonObject *result = json_object_new();
+    JsonObject *stats = json_object_new();
+    gint64 uploaded = 0, downloaded = 0, down = 0, up = 0;
+    gint active = 0, paused = 0;
+    guint i;
+
+    for (i = 0; i < torrents->len; i++) {
+        trg_mock_torrent *t = torrents->pdata[i];
+
+        uploaded += t->uploadedEver;
+        downloaded += t->downloadedEver;
+        down += t->rateDownload;
+        up += t->rateUpload;
+        active += t->rateDownload || t->rateUpload;
+        paused += t->status == TR_STATUS_STOPPED;
+    }
+
+    json_object_set_int_member(stats, "uploadedBytes", uploaded);
+    json_object_set_int_member(stats, "downloadedBytes", downloaded);
+    json_object_set_int_member(stats, "filesAdded", torrents->len);
+    json_object_set_int_member(stats, "sessionCount", 1);
+    json_object_set_int_member(stats, "secondsActive", mock_now() - daemon->started);
+
+    json_object_set_int_member(result, SSTAT_ACTIVE_COUNT, active);
+    json_object_set_int_member(result, "pausedTorrentCount", paused);
+    json_object_set_int_member(result, SSTAT_TORRENT_COUNT, torrents->len);
+    json_object_set_int_member(result, SSTAT_DOWNLOAD_SPEED, down);
+    json_object_set_int_member(result, SSTAT_UPLOAD_SPEED, up);
+    json_object_set_object_member(result, "cumulative-stats", json_object_ref(stats));
+    json_object_set_object_member(result, "current-stats", stats);
+
+    return result;
+}
+
+static void mock_session_set(trg_mock_daemon *daemon, JsonObject *args)
+{
+    g_autoptr(GList) members = json_object_get_members(args);
+    GList *li;
+
+    for (li = members; li; li = g_list_next(li))
+        json_object_set_member(daemon->session, li->data,
+                               json_node_copy(json_object_get_member(args, li->data)));
+}
+
+static JsonObject *mock_free_space(trg_mock_daemon *daemon, JsonObject *args)
+{
+    JsonObject *result = json_object_new();
+    const gchar *path = mock_get_string(args, FIELD_PATH);
+
+    json_object_set_string_member(result, FIELD_PATH, path ? path : "");
+    json_object_set_int_member(result, "size-bytes",
+                               json_object_get_int_member(daemon->session,
+                                                          SGET_DOWNLOAD_DIR_FREE_SPACE));
+
+    return result;
+}
+
+/* Run one RPC method, writing its arguments to out. */
+static void mock_call(trg_mock_daemon *daemon, const gchar *method, JsonObject *args, GString *out)
+{
+    JsonObject *result = NULL;
+
+    if (!strcmp(method, METHOD_TORRENT_GET)) {
+        mock_torrent_get(daemon, args, out);
+        return;
+    } else if (!strcmp(method, METHOD_TORRENT_SET)
+               || !strcmp(method, METHOD_TORRENT_SET_LOCATION)) {
+        mock_torrent_set(daemon, args);
+    } else if (!strcmp(method, METHOD_TORRENT_ADD)) {
+        result = mock_torrent_add(daemon, args);
+    } else if (!strcmp(method, METHOD_TORRENT_REMOVE)) {
+        mock_torrent_remove(daemon, args);
+    } else if (!strcmp(method, METHOD_TORRENT_START)
+               || !strcmp(method, METHOD_TORRENT_START_NOW)) {
+        mock_set_status(daemon, args, TR_STATUS_DOWNLOAD);
+    } else if (!strcmp(method, METHOD_TORRENT_STOP)) {
+        mock_set_status(daemon, args, TR_STATUS_STOPPED);
+    } else if (!strcmp(method, METHOD_TORRENT_VERIFY)) {
+        mock_set_status(daemon, args, TR_STATUS_CHECK_WAIT);
+    } else if (!strcmp(method, METHOD_SESSION_GET)) {
+        result = json_object_ref(daemon->session);
+    } else if (!strcmp(method, METHOD_SESSION_SET)) {
+        mock_session_set(daemon, args);
+    } else if (!strcmp(method, METHOD_SESSION_STATS)) {
+        result = mock_session_stats(daemon);
+    } else if (!strcmp(method, METHOD_PORT_TEST)) {
+        result = json_object_new();
+        json_object_set_boolean_member(result, "port-is-open", TRUE);
+    } else if (!strcmp(method, METHOD_BLOCKLIST_UPDATE)) {
+        result = json_object_new();
+        json_object_set_int_member(result, SGET_BLOCKLIST_SIZE, 0);
+    } else if (!strcmp(method, "free-space")) {
+        result = mock_free_space(daemon, args);
+    }
+
+    if (!result)
+        result = json_object_new();
+
+    mock_write_object(out, result);
+    json_object_unref(result);
+}
+
+static void mock_pause(SoupServer *server, SoupServerMessage *msg)
+{
+#if SOUP_CHECK_VERSION(3, 2, 0)
+    soup_server_message_pause(msg);
+#else
+    soup_server_pause_message(server, msg);
+#endif
+}
+
+static void mock_unpause(SoupServer *server, SoupServerMessage *msg)
+{
+#if SOUP_CHECK_VERSION(3, 2, 0)
+    soup_server_message_unpause(msg);
+#else
+    soup_server_unpause_message(server, msg);
+#endif
+}
+
+typedef struct {
+    trg_mock_daemon *daemon;
+    SoupServerMessage *msg;
+    GBytes *body;
+    gsize offset;
+    gsize chunk;
+    gboolean finished;
+} trg_mock_trickle;
+
+static void mock_trickle_finished(SoupServerMessage *msg, gpointer data)
+{
+    trg_mock_trickle *trickle = data;
+    trickle->finished = TRUE;
+}
+
+/* Add the next chunk of a trickled response, returning whether there's more. */
+static gboolean mock_trickle_append(trg_mock_trickle *trickle)
+{
+    gsize size = g_bytes_get_size(trickle->body);
+    gsize len = MIN(trickle->chunk, size - trickle->offset);
+    g_autoptr(GBytes) chunk = g_bytes_new_from_bytes(trickle->body, trickle->offset, len);
+
+    soup_message_body_append_bytes(soup_server_message_get_response_body(trickle->msg), chunk);
+    trickle->offset += len;
+
+    return trickle->offset < size;
+}
+
+static void mock_trickle_free(trg_mock_trickle *trickle)
+{
+    g_signal_handlers_disconnect_by_data(trickle->msg, trickle);
+    g_object_unref(trickle->msg);
+    g_bytes_unref(trickle->body);
+    g_free(trickle);
+}
+
+static gboolean mock_trickle(gpointer data)
+{
+    trg_mock_trickle *trickle = data;
+
+    if (!trickle->finished) {
+        gboolean more = mock_trickle_append(trickle);
+
+        /* The response paused itself when it ran out of body to write. */
+        mock_unpause(trickle->daemon->server, trickle->msg);
+        if (more)
+            return G_SOURCE_CONTINUE;
+    }
+
+    mock_trickle_free(trickle);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Set the response, taking the body (if any). */
+static void mock_reply(trg_mock_daemon *daemon, SoupServerMessage *msg, guint status,
+                       GBytes *body)
+{
+    SoupMessageHeaders *headers = soup_server_message_get_response_headers(msg);
+    gint bandwidth = daemon->options.bandwidth;
+    trg_mock_trickle *trickle;
+
+    soup_server_message_set_status(msg, status, NULL);
+    soup_message_headers_replace(headers, TRANSMISSION_SESSION_ID_HEADER, daemon->sessionId);
+
+    if (daemon->options.verbose)
+        g_print("%s %s %u %" G_GSIZE_FORMAT "\n", soup_server_message_get_method(msg),
+                g_uri_get_path(soup_server_message_get_uri(msg)), status,
+                body ? g_bytes_get_size(body) : 0);
+
+    if (!body)
+        return;
+
+    soup_message_headers_set_content_type(headers, "application/json; charset=UTF-8", NULL);
+
+    if (bandwidth <= 0 || g_bytes_get_size(body) == 0) {
+        soup_message_body_append_bytes(soup_server_message_get_response_body(msg), body);
+        g_bytes_unref(body);
+        return;
+    }
+
+    /* Send what the bandwidth allows each MOCK_TRICKLE_MS. */
+    soup_message_headers_set_content_length(headers, g_bytes_get_size(body));
+
+    trickle = g_new0(trg_mock_trickle, 1);
+    trickle->daemon = daemon;
+    trickle->msg = g_object_ref(msg);
+    trickle->body = body;
+    trickle->chunk = MAX(1, (gsize)bandwidth * MOCK_TRICKLE_MS / 1000);
+    g_signal_connect(msg, "finished", G_CALLBACK(mock_trickle_finished), trickle);
+
+    if (mock_trickle_append(trickle))
+        g_timeout_add(MOCK_TRICKLE_MS, mock_trickle, trickle);
+    else
+        mock_trickle_free(trickle);
+}
+
+static gboolean mock_authorized(trg_mock_daemon *daemon, SoupServerMessage *msg)
+{
+    SoupMessageHeaders *headers = soup_server_message_get_request_headers(msg);
+    g_autofree gchar *credentials = NULL;
+    g_autofree gchar *encoded = NULL;
+    g_autofree gchar *expected = NULL;
+
+    if (!daemon->user)
+        return TRUE;
+
+    credentials = g_strdup_printf("%s:%s", daemon->user, daemon->password);
+    encoded = g_base64_encode((const guchar *)credentials, strlen(credentials));
+    expected = g_strconcat("Basic ", encoded, NULL);
+
+    return !g_strcmp0(soup_message_headers_get_one(headers, "Authorization"), expected);
+}
+
+static GBytes *mock_text(const gchar *text)
+{
+    return g_bytes_new_static(text, strlen(text));
+}
+
+static void mock_respond(trg_mock_daemon *daemon, SoupServerMessage *msg, const gchar *path)
+{
+    SoupMessageHeaders *headers = soup_server_message_get_request_headers(msg);
+    SoupMessageBody *requestBody = soup_server_message_get_request_body(msg);
+    g_autoptr(JsonParser) parser = json_parser_new();
+    g_autoptr(JsonObject) empty = json_object_new();
+    JsonObject *request, *args;
+    const gchar *method;
+    JsonNode *root, *tag;
+    GString *out;
+
+    if (!mock_authorized(daemon, msg)) {
+        soup_message_headers_replace(soup_server_message_get_response_headers(msg),
+                                     "WWW-Authenticate", "Basic realm=\"Transmission\"");
+        mock_reply(daemon, msg, SOUP_STATUS_UNAUTHORIZED, NULL);
+        return;
+    }
+
+    if (!g_str_has_prefix(path, daemon->path)) {
+        mock_reply(daemon, msg, SOUP_STATUS_NOT_FOUND, NULL);
+        return;
+    }
+
+    if (strcmp(soup_server_message_get_method(msg), SOUP_METHOD_POST)) {
+        mock_reply(daemon, msg, SOUP_STATUS_METHOD_NOT_ALLOWED, NULL);
+        return;
+    }
+
+    mock_tick(daemon);
+
+    if (g_strcmp0(soup_message_headers_get_one(headers, TRANSMISSION_SESSION_ID_HEADER),
+                  daemon->sessionId)) {
+        mock_reply(daemon, msg, SOUP_STATUS_CONFLICT, mock_text("<h1>409: Conflict</h1>"));
+        return;
+    }
+
+    if (g_random_double() < daemon->options.errorRate) {
+        if (g_random_boolean())
+            mock_reply(daemon, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR,
+                       mock_text("<h1>500: Internal Server Error</h1>"));
+        else
+            mock_reply(daemon, msg, SOUP_STATUS_OK,
+                       mock_text("{\"result\":\"simulated failure\"}"));
+        return;
+    }
+
+    if (!requestBody->data
+        || !json_parser_load_from_data(parser, requestBody->data, requestBody->length, NULL)
+        || !(root = json_parser_get_root(parser)) || !JSON_NODE_HOLDS_OBJECT(root)) {
+        mock_reply(daemon, msg, SOUP_STATUS_BAD_REQUEST, NULL);
+        return;
+    }
+
+    request = json_node_get_object(root);
+    method = mock_get_string(request, PARAM_METHOD);
+    if (!method) {
+        mock_reply(daemon, msg, SOUP_STATUS_BAD_REQUEST, NULL);
+        return;
+    }
+
+    args = mock_get_object(request, PARAM_ARGUMENTS);
+    if (!args)
+        args = empty;
+
+    out = g_string_new("{\"arguments\":");
+    mock_call(daemon, method, args, out);
+    g_string_append(out, ",\"result\":\"success\"");
+
+    tag = json_object_get_member(request, PARAM_TAG);
+    if (tag) {
+        g_autofree gchar *text = json_to_string(tag, FALSE);
+        g_string_append_printf(out, ",\"tag\":%s", text);
+    }
+
+    g_string_append_c(out, '}');
+
+    mock_reply(daemon, msg, SOUP_STATUS_OK, g_string_free_to_bytes(out));
+}
+
+typedef struct {
+    trg_mock_daemon *daemon;
+    SoupServerMessage *msg;
+    gchar *path;
+} trg_mock_delayed;
+
+static gboolean mock_delayed(gpointer data)
+{
+    trg_mock_delayed *delayed = data;
+
+    mock_respond(delayed->daemon, delayed->msg, delayed->path);
+    mock_unpause(delayed->daemon->server, delayed->msg);
+
+    g_object_unref(delayed->msg);
+    g_free(delayed->path);
+    g_free(delayed);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void mock_handler(SoupServer *server, SoupServerMessage *msg, const char *path,
+                         GHashTable *query, gpointer data)
+{
+    trg_mock_daemon *daemon = data;
+    trg_mock_options *options = &daemon->options;
+    gint delay = options->latency;
+    trg_mock_delayed *delayed;
+
+    if (options->jitter > 0)
+        delay += g_random_int_range(0, options->jitter + 1);
+
+    if (delay <= 0) {
+        mock_respond(daemon, msg, path);
+        return;
+    }
+
+    delayed = g_new0(trg_mock_delayed, 1);
+    delayed->daemon = daemon;
+    delayed->msg = g_object_ref(msg);
+    delayed->path = g_strdup(path);
+
+    mock_pause(server, msg);
+    g_timeout_add(delay, mock_delayed, delayed);
+}
+
+static JsonObject *mock_session_new(void)
+{
+    JsonObject *session = json_object_new();
+
+    json_object_set_int_member(session, SGET_ALT_SPEED_DOWN, 50);
+    json_object_set_boolean_member(session, SGET_ALT_SPEED_ENABLED, FALSE);
+    json_object_set_int_member(session, SGET_ALT_SPEED_TIME_BEGIN, 540);
+    json_object_set_int_member(session, SGET_ALT_SPEED_TIME_DAY, 127);
+    json_object_set_boolean_member(session, SGET_ALT_SPEED_TIME_ENABLED, FALSE);
+    json_object_set_int_member(session, SGET_ALT_SPEED_TIME_END, 1020);
+    json_object_set_int_member(session, SGET_ALT_SPEED_UP, 50);
+    json_object_set_boolean_member(session, SGET_BLOCKLIST_ENABLED, FALSE);
+    json_object_set_int_member(session, SGET_BLOCKLIST_SIZE, 0);
+    json_object_set_string_member(session, SGET_BLOCKLIST_URL, "");
+    json_object_set_int_member(session, SGET_CACHE_SIZE_MB, 4);
+    json_object_set_boolean_member(session, SGET_DHT_ENABLED, TRUE);
+    json_object_set_string_member(session, SGET_DOWNLOAD_DIR, mock_dirs[0]);
+    json_object_set_int_member(session, SGET_DOWNLOAD_DIR_FREE_SPACE, 512 * 1024 * MOCK_MIB);
+    json_object_set_boolean_member(session, SGET_DOWNLOAD_QUEUE_ENABLED, TRUE);
+    json_object_set_int_member(session, SGET_DOWNLOAD_QUEUE_SIZE, 5);
+    json_object_set_string_member(session, SGET_ENCRYPTION, "preferred");
+    json_object_set_string_member(session, SGET_INCOMPLETE_DIR, "/srv/incomplete");
+    json_object_set_boolean_member(session, SGET_INCOMPLETE_DIR_ENABLED, FALSE);
+    json_object_set_boolean_member(session, SGET_LPD_ENABLED, FALSE);
+    json_object_set_int_member(session, SGET_PEER_LIMIT_GLOBAL, 200);
+    json_object_set_int_member(session, SGET_PEER_LIMIT_PER_TORRENT, 50);
+    json_object_set_int_member(session, SGET_PEER_PORT, 51413);
+    json_object_set_boolean_member(session, SGET_PEER_PORT_RANDOM_ON_START, FALSE);
+    json_object_set_boolean_member(session, SGET_PEX_ENABLED, TRUE);
+    json_object_set_boolean_member(session, SGET_PORT_FORWARDING_ENABLED, FALSE);
+    json_object_set_boolean_member(session, SGET_QUEUE_STALLED_ENABLED, TRUE);
+    json_object_set_int_member(session, SGET_QUEUE_STALLED_MINUTES, 30);
+    json_object_set_boolean_member(session, SGET_RENAME_PARTIAL_FILES, TRUE);
+    json_object_set_int_member(session, SGET_RPC_VERSION, MOCK_RPC_VERSION);
+    json_object_set_int_member(session, SGET_RPC_VERSION_MINIMUM, 14);
+    json_object_set_boolean_member(session, SGET_SCRIPT_TORRENT_DONE_ENABLED, FALSE);
+    json_object_set_string_member(session, SGET_SCRIPT_TORRENT_DONE_FILENAME, "");
+    json_object_set_boolean_member(session, SGET_SEED_QUEUE_ENABLED, FALSE);
+    json_object_set_int_member(session, SGET_SEED_QUEUE_SIZE, 10);
+    json_object_set_double_member(session, SGET_SEED_RATIO_LIMIT, 2.0);
+    json_object_set_boolean_member(session, SGET_SEED_RATIO_LIMITED, FALSE);
+    json_object_set_int_member(session, SGET_SPEED_LIMIT_DOWN, 100);
+    json_object_set_boolean_member(session, SGET_SPEED_LIMIT_DOWN_ENABLED, FALSE);
+    json_object_set_int_member(session, SGET_SPEED_LIMIT_UP, 100);
+    json_object_set_boolean_member(session, SGET_SPEED_LIMIT_UP_ENABLED, FALSE);
+    json_object_set_boolean_member(session, SGET_START_ADDED_TORRENTS, TRUE);
+    json_object_set_boolean_member(session, SGET_TRASH_ORIGINAL_TORRENT_FILES, FALSE);
+    json_object_set_string_member(session, SGET_VERSION, "4.0.5 (mock)");
+
+    return session;
+}
+
+trg_mock_daemon *trg_mock_daemon_new(const trg_mock_options *options)
+{
+    trg_mock_daemon *daemon = g_new0(trg_mock_daemon, 1);
+    gint i;
+
+    daemon->options = *options;
+    daemon->path = g_strdup(options->path ? options->path : TRG_MOCK_DEFAULT_PATH);
+    daemon->user = options->user && *options->user ? g_strdup(options->user) : NULL;
+    daemon->password = g_strdup(options->password ? options->password : "");
+    daemon->options.path = daemon->options.user = daemon->options.password = NULL;
+
+    daemon->rand = options->seed ? g_rand_new_with_seed(options->seed) : g_rand_new();
+    daemon->fields = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < MOCK_FIELDS; i++)
+        g_hash_table_insert(daemon->fields, (gpointer)mock_field_names[i], GINT_TO_POINTER(i + 1));
+
+    daemon->torrents
+        = g_tree_new_full(mock_id_compare, NULL, NULL, (GDestroyNotify)mock_torrent_free);
+    daemon->removed = g_array_new(FALSE, FALSE, sizeof(trg_mock_removed));
+    daemon->session = mock_session_new();
+    daemon->sessionId = g_uuid_string_random();
+    daemon->started = daemon->sessionSince = daemon->lastTick = mock_now();
+    daemon->nextId = 1;
+
+    for (i = 0; i < options->torrents; i++)
+        mock_add(daemon, NULL);
+
+    daemon->server = soup_server_new("server-header", "Transmission (mock)", NULL);
+    soup_server_add_handler(daemon->server, NULL, mock_handler, daemon, NULL);
+
+    return daemon;
+}
+
+/* Listen on host (an address, not a name) and port, or any free port for 0.
+ * Returns the port, or 0 on failure. */
+guint trg_mock_daemon_listen(trg_mock_daemon *daemon, const gchar *host, guint port,
+                             GError **error)
+{
+    g_autoptr(GSocketAddress) address = g_inet_socket_address_new_from_string(host, port);
+    GSList *uris;
+    guint bound = 0;
+
+    if (!address) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Invalid address %s", host);
+        return 0;
+    }
+
+    if (!soup_server_listen(daemon->server, address, 0, error))
+        return 0;
+
+    uris = soup_server_get_uris(daemon->server);
+    if (uris)
+        bound = g_uri_get_port(uris->data);
+    g_slist_free_full(uris, (GDestroyNotify)g_uri_unref);
+
+    if (!bound)
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Not listening on %s", host);
+
+    return bound;
+}
+
+void trg_mock_daemon_free(trg_mock_daemon *daemon)
+{
+    soup_server_disconnect(daemon->server);
+    g_object_unref(daemon->server);
+    g_tree_destroy(daemon->torrents);
+    g_array_free(daemon->removed, TRUE);
+    g_hash_table_destroy(daemon->fields);
+    json_object_unref(daemon->session);
+    g_rand_free(daemon->rand);
+    g_free(daemon->sessionId);
+    g_free(daemon->path);
+    g_free(daemon->user);
+    g_free(daemon->password);
+    g_free(daemon);
+}
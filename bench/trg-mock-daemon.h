@@ -0,0 +1,48 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+/* How the mock daemon behaves; see trg-mock-daemon.c. */
+typedef struct {
+    gint torrents;
+    gdouble churn;
+    gdouble rotateIds;
+    gint rotateSession;
+    gint latency;
+    gint jitter;
+    gint bandwidth;
+    gdouble errorRate;
+    const gchar *path;
+    const gchar *user;
+    const gchar *password;
+    guint32 seed;
+    gboolean verbose;
+} trg_mock_options;
+
+#define TRG_MOCK_DEFAULT_PATH "/transmission/rpc"
+
+typedef struct _trg_mock_daemon trg_mock_daemon;
+
+trg_mock_daemon *trg_mock_daemon_new(const trg_mock_options *options);
+guint trg_mock_daemon_listen(trg_mock_daemon *daemon, const gchar *host, guint port,
+                             GError **error);
+void trg_mock_daemon_free(trg_mock_daemon *daemon);
@@ -54,6 +54,14 @@ static int get_size_in_pixels(GtkIconSize icon_size)
     return MAX(width, height);
 }
 
+static void icon_cache_theme_changed(GtkIconTheme *icon_theme G_GNUC_UNUSED,
+                                     IconCache *icon_cache)
+{
+    g_hash_table_remove_all(icon_cache->cache);
+    g_hash_table_insert(icon_cache->cache, (void *)VOID_PIXBUF_KEY,
+                        create_void_pixbuf(icon_cache->icon_size, icon_cache->icon_size));
+}
+
 static IconCache *icon_cache_new(GtkWidget *for_widget, int icon_size)
 {
     IconCache *icon_cache;
@@ -67,6 +75,8 @@ static IconCache *icon_cache_new(GtkWidget *for_widget, int icon_size)
 
     g_hash_table_insert(icon_cache->cache, (void *)VOID_PIXBUF_KEY,
                         create_void_pixbuf(icon_cache->icon_size, icon_cache->icon_size));
+    g_signal_connect(icon_cache->icon_theme, "changed", G_CALLBACK(icon_cache_theme_changed),
+                     icon_cache);
 
     return icon_cache;
 }
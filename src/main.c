@@ -26,6 +26,9 @@
 #include "trg-client.h"
 #include "trg-gtk-app.h"
 #include "trg-main-window.h"
+#include "trg-memory.h"
+#include "trg-profile.h"
+#include "trg-trace.h"
 
 /* Handle arguments and start the main window. */
 
@@ -51,8 +54,15 @@ int main(int argc, char *argv[])
 {
     g_set_application_name(PACKAGE_NAME);
     bindtext_wrapper();
+    trg_trace_init();
+    trg_memory_init();
 
     g_autoptr(TrgClient) client = trg_client_new();
     g_autoptr(TrgGtkApp) gtk_app = trg_gtk_app_new(client);
-    return g_application_run(G_APPLICATION(gtk_app), argc, argv);
+    int status = g_application_run(G_APPLICATION(gtk_app), argc, argv);
+
+    trg_profile_write();
+    trg_trace_close();
+
+    return status;
 }
@@ -63,6 +63,7 @@
 #define FIELD_PEERS                   "peers"
 #define FIELD_PEERSFROM               "peersFrom"
 #define FIELD_FILES                   "files"
+#define FIELD_FILE_COUNT              "file-count"
 #define FIELD_WANTED                  "wanted"
 #define FIELD_WEB_SEEDS_SENDING_TO_US "webseedsSendingToUs"
 #define FIELD_PRIORITIES              "priorities"
@@ -164,9 +165,19 @@
 #define TPEERFROM_FROMINCOMING "fromIncoming"
 #define TPEERFROM_FROMLPD      "fromLpd"
 
+/* session-stats arguments */
+
+#define SSTAT_TORRENT_COUNT  "torrentCount"
+#define SSTAT_ACTIVE_COUNT   "activeTorrentCount"
+#define SSTAT_DOWNLOAD_SPEED "downloadSpeed"
+#define SSTAT_UPLOAD_SPEED   "uploadSpeed"
+
 /* The rpc-version >= that the status field of torrent-get changed */
 #define NEW_STATUS_RPC_VERSION 14
 
+/* The rpc-version >= that torrent-get has file-count */
+#define FILE_COUNT_RPC_VERSION 17
+
 typedef enum {
     OLD_STATUS_WAITING_TO_CHECK = 1,
     OLD_STATUS_CHECKING = 2,
@@ -55,6 +55,56 @@ JsonNode *session_stats(void)
     return base_request(METHOD_SESSION_STATS);
 }
 
+/* Serialize a request for dispatch_rpc_bytes_async(), freeing it. */
+GBytes *request_to_bytes(JsonNode *req)
+{
+    g_autoptr(JsonGenerator) generator = trg_json_serializer(req, FALSE);
+    gchar *body;
+    gsize len;
+
+    body = json_generator_to_data(generator, &len);
+    json_node_unref(req);
+
+    return g_bytes_new_take(body, len);
+}
+
+/* Recurring requests which never change are only built and serialized
+ * once. The results aren't owned by the caller. */
+GBytes *session_get_body(void)
+{
+    static GBytes *body = NULL;
+
+    if (!body)
+        body = request_to_bytes(session_get());
+
+    return body;
+}
+
+GBytes *session_stats_body(void)
+{
+    static GBytes *body = NULL;
+
+    if (!body)
+        body = request_to_bytes(session_stats());
+
+    return body;
+}
+
+/* Just enough of every torrent to count those downloading and seeding and
+ * total their speeds, for polling while the window is hidden in the tray. */
+GBytes *torrent_get_tray_body(void)
+{
+    static const gchar *const fields[]
+        = { FIELD_STATUS, FIELD_ERROR, FIELD_RATEDOWNLOAD, FIELD_RATEUPLOAD,
+            FIELD_PEERS_GETTING_FROM_US, NULL };
+    static GBytes *body = NULL;
+
+    if (!body)
+        body = request_to_bytes(torrent_get_fields(TORRENT_GET_TAG_MODE_FULL, fields));
+
+    return body;
+}
+
 JsonNode *blocklist_update(void)
 {
     return base_request(METHOD_BLOCKLIST_UPDATE);
@@ -156,7 +206,7 @@ JsonNode *torrent_remove(JsonArray *array, gboolean removeData)
     return root;
 }
 
-JsonNode *torrent_get(gint64 id)
+JsonNode *torrent_get(gint64 id, gint64 rpcv)
 {
     JsonNode *root = base_request(METHOD_TORRENT_GET);
     JsonObject *args = node_get_arguments(root);
@@ -171,9 +221,11 @@ JsonNode *torrent_get(gint64 id)
     }
 
     json_array_add_string_element(fields, FIELD_ETA);
-    json_array_add_string_element(fields, FIELD_PEERS);
-    json_array_add_string_element(fields, FIELD_PEERSFROM);
-    json_array_add_string_element(fields, FIELD_FILES);
+    /* Only the count is needed here; the files themselves are fetched for
+     * the one torrent whose files are showing. Daemons without file-count
+     * have to send them all. */
+    json_array_add_string_element(fields,
+                                  rpcv >= FILE_COUNT_RPC_VERSION ? FIELD_FILE_COUNT : FIELD_FILES);
     json_array_add_string_element(fields, FIELD_PEERS_SENDING_TO_US);
     json_array_add_string_element(fields, FIELD_PEERS_GETTING_FROM_US);
     json_array_add_string_element(fields, FIELD_WEB_SEEDS_SENDING_TO_US);
@@ -219,13 +271,57 @@ JsonNode *torrent_get(gint64 id)
     json_array_add_string_element(fields, FIELD_MAGNETLINK);
     json_array_add_string_element(fields, FIELD_ERROR);
     json_array_add_string_element(fields, FIELD_ERROR_STRING);
-    json_array_add_string_element(fields, FIELD_WANTED);
-    json_array_add_string_element(fields, FIELD_PRIORITIES);
     json_array_add_string_element(fields, FIELD_RECHECK_PROGRESS);
     json_object_set_array_member(args, PARAM_FIELDS, fields);
     return root;
 }
 
+/* A torrent-get for one torrent and just the given (NULL terminated) fields,
+ * for the details which aren't fetched for every torrent on each update. */
+JsonNode *torrent_get_fields(gint64 id, const gchar *const *fields)
+{
+    JsonNode *root = base_request(METHOD_TORRENT_GET);
+    JsonObject *args = node_get_arguments(root);
+    JsonArray *fieldsArray = json_array_new();
+
+    /* A negative id asks for every torrent. */
+    if (id >= 0) {
+        JsonArray *ids = json_array_new();
+        json_array_add_int_element(ids, id);
+        json_object_set_array_member(args, PARAM_IDS, ids);
+    }
+
+    for (; *fields; fields++)
+        json_array_add_string_element(fieldsArray, *fields);
+
+    json_object_set_array_member(args, PARAM_FIELDS, fieldsArray);
+    return root;
+}
+
+/* The fields the files and peers views need, for a single torrent. */
+JsonNode *torrent_get_files_detail(gint64 id)
+{
+    static const gchar *const fields[]
+        = { FIELD_ID, FIELD_FILES, FIELD_PRIORITIES, FIELD_WANTED, NULL };
+
+    return torrent_get_fields(id, fields);
+}
+
+JsonNode *torrent_get_peers_detail(gint64 id)
+{
+    static const gchar *const fields[] = { FIELD_ID, FIELD_PEERS, NULL };
+
+    return torrent_get_fields(id, fields);
+}
+
+JsonNode *torrent_get_detail(gint64 id)
+{
+    static const gchar *const fields[]
+        = { FIELD_ID, FIELD_FILES, FIELD_PRIORITIES, FIELD_WANTED, FIELD_PEERS, NULL };
+
+    return torrent_get_fields(id, fields);
+}
+
 JsonNode *torrent_add_url(const gchar *url, gboolean paused)
 {
     JsonNode *root = base_request(METHOD_TORRENT_ADD);
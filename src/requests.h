@@ -29,7 +29,11 @@ JsonNode *generic_request(gchar *method, JsonArray *array);
 
 JsonNode *session_set(void);
 JsonNode *session_get(void);
-JsonNode *torrent_get(gint64 id);
+JsonNode *torrent_get(gint64 id, gint64 rpcv);
+JsonNode *torrent_get_fields(gint64 id, const gchar *const *fields);
+JsonNode *torrent_get_files_detail(gint64 id);
+JsonNode *torrent_get_peers_detail(gint64 id);
+JsonNode *torrent_get_detail(gint64 id);
 JsonNode *torrent_set(JsonArray *array);
 JsonNode *torrent_pause(JsonArray *array);
 JsonNode *torrent_start(JsonArray *array);
@@ -49,6 +53,11 @@ JsonNode *torrent_queue_move_bottom(JsonArray *array);
 JsonNode *torrent_queue_move_top(JsonArray *array);
 JsonNode *torrent_start_now(JsonArray *array);
 
+GBytes *request_to_bytes(JsonNode *req);
+GBytes *session_get_body(void);
+GBytes *session_stats_body(void);
+GBytes *torrent_get_tray_body(void);
+
 void request_set_tag(JsonNode *req, gint64 tag);
 void request_set_tag_from_ids(JsonNode *req, JsonArray *ids);
 
@@ -18,12 +18,14 @@
 #include <gdk/gdk.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
+#include <string.h>
 
 #include "hig.h"
 #include "icons.h"
 #include "torrent-cell-renderer.h"
 #include "torrent.h"
 #include "trg-client.h"
+#include "trg-memory.h"
 #include "util.h"
 
 enum {
@@ -60,6 +62,28 @@ enum {
 #define COMPACT_ICON_SIZE  GTK_ICON_SIZE_MENU
 #define FULL_ICON_SIZE     GTK_ICON_SIZE_DND
 
+/* Status strings change with every update, so the measured text cache is
+ * simply emptied when it grows past this many entries. */
+#define TEXT_SIZE_CACHE_MAX 4096
+
+enum {
+    TEXT_STYLE_NAME,
+    TEXT_STYLE_NAME_BOLD,
+    TEXT_STYLE_SMALL
+};
+
+enum {
+    ICON_KIND_UNKNOWN,
+    ICON_KIND_DIRECTORY,
+    ICON_KIND_FILE,
+    ICON_KIND_COUNT
+};
+
+typedef struct {
+    GdkPixbuf *pixbuf;
+    GtkRequisition size;
+} trg_cell_icon;
+
 #define FOREGROUND_COLOR_KEY "foreground-rgba"
 typedef GdkRGBA GtrColor;
 typedef cairo_t GtrDrawable;
@@ -85,6 +109,9 @@ struct _TorrentCellRenderer {
     GtkCellRenderer *icon_renderer;
     GString *gstr1;
     GString *gstr2;
+    GString *sizeKey;
+    GHashTable *textSizes;
+    trg_cell_icon icons[ICON_KIND_COUNT][2];
     int bar_height;
 
     guint flags;
@@ -324,13 +351,59 @@ static void getStatusString(GString *gstr, TorrentCellRenderer *r)
 ****
 ***/
 
-static GdkPixbuf *get_icon(TorrentCellRenderer *r, GtkIconSize icon_size, GtkWidget *for_widget)
+static void torrent_cell_renderer_reset_caches(TorrentCellRenderer *r)
+{
+    guint i;
+
+    g_hash_table_remove_all(r->textSizes);
+
+    for (i = 0; i < ICON_KIND_COUNT; i++) {
+        g_clear_object(&r->icons[i][0].pixbuf);
+        g_clear_object(&r->icons[i][1].pixbuf);
+    }
+}
+
+static void torrent_cell_renderer_cache_usage(GObject *object, trg_memory_usage *usage)
+{
+    TorrentCellRenderer *r = TORRENT_CELL_RENDERER(object);
+    GHashTableIter iter;
+    gpointer key;
+
+    if (!r->textSizes)
+        return;
+
+    usage->bytes += trg_memory_table_size(r->textSizes);
+
+    g_hash_table_iter_init(&iter, r->textSizes);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        usage->count++;
+        usage->bytes += strlen(key) + 1 + sizeof(GtkRequisition);
+    }
+}
+
+/* The returned icon belongs to the renderer's cache, which is emptied on
+ * icon theme and style changes. */
+static const trg_cell_icon *get_icon(TorrentCellRenderer *r, gboolean compact,
+                                     GtkWidget *for_widget)
 {
     const char *mime_type;
+    trg_cell_icon *icon;
+    guint kind;
 
     if (r->fileCount == 0)
-        mime_type = UNKNOWN_MIME_TYPE;
+        kind = ICON_KIND_UNKNOWN;
     else if (r->fileCount > 1)
+        kind = ICON_KIND_DIRECTORY;
+    else
+        kind = ICON_KIND_FILE;
+
+    icon = &r->icons[kind][compact ? 1 : 0];
+    if (icon->pixbuf)
+        return icon;
+
+    if (kind == ICON_KIND_UNKNOWN)
+        mime_type = UNKNOWN_MIME_TYPE;
+    else if (kind == ICON_KIND_DIRECTORY)
         mime_type = DIRECTORY_MIME_TYPE;
     /*else if( strchr( info->files[0].name, '/' ) != NULL )
        mime_type = DIRECTORY_MIME_TYPE;
@@ -339,8 +412,12 @@ static GdkPixbuf *get_icon(TorrentCellRenderer *r, GtkIconSize icon_size, GtkWid
     else
         mime_type = FILE_MIME_TYPE;
 
-    // return NULL;
-    return gtr_get_mime_type_icon(mime_type, icon_size, for_widget);
+    icon->pixbuf = gtr_get_mime_type_icon(mime_type, compact ? COMPACT_ICON_SIZE : FULL_ICON_SIZE,
+                                          for_widget);
+    g_object_set(r->icon_renderer, "pixbuf", icon->pixbuf, NULL);
+    gtk_cell_renderer_get_preferred_size(r->icon_renderer, for_widget, NULL, &icon->size);
+
+    return icon;
 }
 
 /***
@@ -354,30 +431,54 @@ static void gtr_cell_renderer_get_preferred_size(GtkCellRenderer *renderer, GtkW
     gtk_cell_renderer_get_preferred_size(renderer, widget, minimum_size, natural_size);
 }
 
+/* Measure text as the text renderer would lay it out unellipsized in the
+ * given style. Shaping is the expensive part of drawing a row, and names
+ * rarely change, so the results are kept per renderer. */
+static void get_text_size(TorrentCellRenderer *cell, GtkWidget *widget, gint style,
+                          const gchar *text, GtkRequisition *size)
+{
+    GtkRequisition *cached;
+
+    g_string_truncate(cell->sizeKey, 0);
+    g_string_append_c(cell->sizeKey, '0' + style);
+    g_string_append(cell->sizeKey, text);
+
+    cached = g_hash_table_lookup(cell->textSizes, cell->sizeKey->str);
+    if (cached) {
+        *size = *cached;
+        return;
+    }
+
+    g_object_set(cell->text_renderer, "text", text, "ellipsize", PANGO_ELLIPSIZE_NONE, "scale",
+                 style == TEXT_STYLE_SMALL ? SMALL_SCALE : 1.0, "weight",
+                 style == TEXT_STYLE_NAME_BOLD ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL, NULL);
+    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, size);
+
+    if (g_hash_table_size(cell->textSizes) >= TEXT_SIZE_CACHE_MAX)
+        g_hash_table_remove_all(cell->textSizes);
+
+    g_hash_table_insert(cell->textSizes, g_strdup(cell->sizeKey->str),
+                        g_memdup2(size, sizeof(GtkRequisition)));
+}
+
 static void get_size_compact(TorrentCellRenderer *cell, GtkWidget *widget, gint *width,
                              gint *height)
 {
     int xpad, ypad;
-    GtkRequisition icon_size;
     GtkRequisition name_size;
     GtkRequisition stat_size;
-    GdkPixbuf *icon;
+    const trg_cell_icon *icon;
 
     GString *gstr_stat = cell->gstr1;
 
-    icon = get_icon(cell, COMPACT_ICON_SIZE, widget);
+    icon = get_icon(cell, TRUE, widget);
     g_string_truncate(gstr_stat, 0);
     getShortStatusString(gstr_stat, cell);
     gtk_cell_renderer_get_padding(GTK_CELL_RENDERER(cell), &xpad, &ypad);
 
     /* get the idealized cell dimensions */
-    g_object_set(cell->icon_renderer, "pixbuf", icon, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->icon_renderer, widget, NULL, &icon_size);
-    g_object_set(cell->text_renderer, "text", torrent_get_name(cell->json), "ellipsize",
-                 PANGO_ELLIPSIZE_NONE, "scale", 1.0, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &name_size);
-    g_object_set(cell->text_renderer, "text", gstr_stat->str, "scale", SMALL_SCALE, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &stat_size);
+    get_text_size(cell, widget, TEXT_STYLE_NAME, torrent_get_name(cell->json), &name_size);
+    get_text_size(cell, widget, TEXT_STYLE_SMALL, gstr_stat->str, &stat_size);
 
     /**
     *** LAYOUT
@@ -385,28 +486,24 @@ static void get_size_compact(TorrentCellRenderer *cell, GtkWidget *widget, gint
 
 #define BAR_WIDTH 50
     if (width != NULL)
-        *width = xpad * 2 + icon_size.width + GUI_PAD + name_size.width + GUI_PAD + BAR_WIDTH
+        *width = xpad * 2 + icon->size.width + GUI_PAD + name_size.width + GUI_PAD + BAR_WIDTH
             + GUI_PAD + stat_size.width;
     if (height != NULL)
         *height = ypad * 2 + MAX(name_size.height, cell->bar_height);
-
-    /* cleanup */
-    g_object_unref(icon);
 }
 
 static void get_size_full(TorrentCellRenderer *cell, GtkWidget *widget, gint *width, gint *height)
 {
     int xpad, ypad;
-    GtkRequisition icon_size;
     GtkRequisition name_size;
     GtkRequisition stat_size;
     GtkRequisition prog_size;
-    GdkPixbuf *icon;
+    const trg_cell_icon *icon;
 
     GString *gstr_prog = cell->gstr1;
     GString *gstr_stat = cell->gstr2;
 
-    icon = get_icon(cell, FULL_ICON_SIZE, widget);
+    icon = get_icon(cell, FALSE, widget);
 
     g_string_truncate(gstr_stat, 0);
     getStatusString(gstr_stat, cell);
@@ -415,30 +512,20 @@ static void get_size_full(TorrentCellRenderer *cell, GtkWidget *widget, gint *wi
     gtk_cell_renderer_get_padding(GTK_CELL_RENDERER(cell), &xpad, &ypad);
 
     /* get the idealized cell dimensions */
-    g_object_set(cell->icon_renderer, "pixbuf", icon, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->icon_renderer, widget, NULL, &icon_size);
-    g_object_set(cell->text_renderer, "text", torrent_get_name(cell->json), "weight",
-                 PANGO_WEIGHT_BOLD, "scale", 1.0, "ellipsize", PANGO_ELLIPSIZE_NONE, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &name_size);
-    g_object_set(cell->text_renderer, "text", gstr_prog->str, "weight", PANGO_WEIGHT_NORMAL,
-                 "scale", SMALL_SCALE, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &prog_size);
-    g_object_set(cell->text_renderer, "text", gstr_stat->str, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &stat_size);
+    get_text_size(cell, widget, TEXT_STYLE_NAME_BOLD, torrent_get_name(cell->json), &name_size);
+    get_text_size(cell, widget, TEXT_STYLE_SMALL, gstr_prog->str, &prog_size);
+    get_text_size(cell, widget, TEXT_STYLE_SMALL, gstr_stat->str, &stat_size);
 
     /**
     *** LAYOUT
     **/
 
     if (width != NULL)
-        *width = xpad * 2 + icon_size.width + GUI_PAD
+        *width = xpad * 2 + icon->size.width + GUI_PAD
             + MAX3(name_size.width, prog_size.width, stat_size.width);
     if (height != NULL)
         *height = ypad * 2 + name_size.height + prog_size.height + GUI_PAD_SMALL + cell->bar_height
             + GUI_PAD_SMALL + stat_size.height;
-
-    /* cleanup */
-    g_object_unref(icon);
 }
 
 static void torrent_cell_renderer_get_size(GtkCellRenderer *cell, GtkWidget *widget,
@@ -610,6 +697,10 @@ static void torrent_cell_renderer_set_property(GObject *object, guint property_i
         break;
     case P_OWNER:
         self->owner = g_value_get_pointer(v);
+        if (self->owner)
+            g_signal_connect_object(self->owner, "style-updated",
+                                    G_CALLBACK(torrent_cell_renderer_reset_caches), self,
+                                    G_CONNECT_SWAPPED);
         break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -630,6 +721,9 @@ static void torrent_cell_renderer_dispose(GObject *o)
     if (r) {
         g_string_free(r->gstr1, TRUE);
         g_string_free(r->gstr2, TRUE);
+        g_string_free(r->sizeKey, TRUE);
+        torrent_cell_renderer_reset_caches(r);
+        g_clear_pointer(&r->textSizes, g_hash_table_destroy);
         g_object_unref(G_OBJECT(r->text_renderer));
         g_object_unref(G_OBJECT(r->progress_renderer));
         g_object_unref(G_OBJECT(r->icon_renderer));
@@ -757,6 +851,10 @@ static void torrent_cell_renderer_init(TorrentCellRenderer *self)
 {
     self->gstr1 = g_string_new(NULL);
     self->gstr2 = g_string_new(NULL);
+    self->sizeKey = g_string_new(NULL);
+    self->textSizes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    trg_memory_register(G_OBJECT(self), TRG_MEMORY_CACHED_STRINGS,
+                        torrent_cell_renderer_cache_usage);
     self->text_renderer = gtk_cell_renderer_text_new();
     g_object_set(self->text_renderer, "xpad", 0, "ypad", 0, NULL);
     self->progress_renderer = gtk_cell_renderer_progress_new();
@@ -766,6 +864,10 @@ static void torrent_cell_renderer_init(TorrentCellRenderer *self)
     g_object_ref_sink(self->icon_renderer);
 
     self->bar_height = DEFAULT_BAR_HEIGHT;
+
+    g_signal_connect_object(gtk_icon_theme_get_default(), "changed",
+                            G_CALLBACK(torrent_cell_renderer_reset_caches), self,
+                            G_CONNECT_SWAPPED);
 }
 
 GtkCellRenderer *torrent_cell_renderer_new(void)
@@ -784,7 +886,7 @@ static void render_compact(TorrentCellRenderer *cell, GtrDrawable *window, GtkWi
     GdkRectangle stat_area;
     GdkRectangle prog_area;
     GdkRectangle fill_area;
-    GdkPixbuf *icon;
+    const trg_cell_icon *icon;
     GtrColor text_color;
     gboolean seed;
 
@@ -795,7 +897,7 @@ static void render_compact(TorrentCellRenderer *cell, GtrDrawable *window, GtkWi
     const gboolean sensitive = active || cell->error;
     GString *gstr_stat = cell->gstr1;
 
-    icon = get_icon(cell, COMPACT_ICON_SIZE, widget);
+    icon = get_icon(cell, TRUE, widget);
 
     g_string_truncate(gstr_stat, 0);
     getShortStatusString(gstr_stat, cell);
@@ -809,15 +911,10 @@ static void render_compact(TorrentCellRenderer *cell, GtrDrawable *window, GtkWi
     fill_area.height -= ypad * 2;
     icon_area = name_area = stat_area = prog_area = fill_area;
 
-    g_object_set(cell->icon_renderer, "pixbuf", icon, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->icon_renderer, widget, NULL, &size);
-    icon_area.width = size.width;
-    g_object_set(cell->text_renderer, "text", torrent_get_name(cell->json), "ellipsize",
-                 PANGO_ELLIPSIZE_NONE, "scale", 1.0, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &size);
+    icon_area.width = icon->size.width;
+    get_text_size(cell, widget, TEXT_STYLE_NAME, torrent_get_name(cell->json), &size);
     name_area.width = size.width;
-    g_object_set(cell->text_renderer, "text", gstr_stat->str, "scale", SMALL_SCALE, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &size);
+    get_text_size(cell, widget, TEXT_STYLE_SMALL, gstr_stat->str, &size);
     stat_area.width = size.width;
 
     icon_area.x = fill_area.x;
@@ -832,20 +929,18 @@ static void render_compact(TorrentCellRenderer *cell, GtrDrawable *window, GtkWi
     *** RENDER
     **/
 
-    g_object_set(cell->icon_renderer, "pixbuf", icon, "sensitive", sensitive, NULL);
+    g_object_set(cell->icon_renderer, "pixbuf", icon->pixbuf, "sensitive", sensitive, NULL);
     gtr_cell_renderer_render(cell->icon_renderer, window, widget, &icon_area, flags);
     g_object_set(cell->progress_renderer, "value", (gint)percentDone, "text", NULL, "sensitive",
                  sensitive, NULL);
     gtr_cell_renderer_render(cell->progress_renderer, window, widget, &prog_area, flags);
-    g_object_set(cell->text_renderer, "text", gstr_stat->str, "scale", SMALL_SCALE, "ellipsize",
-                 PANGO_ELLIPSIZE_END, FOREGROUND_COLOR_KEY, &text_color, NULL);
+    g_object_set(cell->text_renderer, "text", gstr_stat->str, "scale", SMALL_SCALE, "weight",
+                 PANGO_WEIGHT_NORMAL, "ellipsize", PANGO_ELLIPSIZE_END, FOREGROUND_COLOR_KEY,
+                 &text_color, NULL);
     gtr_cell_renderer_render(cell->text_renderer, window, widget, &stat_area, flags);
     g_object_set(cell->text_renderer, "text", torrent_get_name(cell->json), "scale", 1.0,
                  FOREGROUND_COLOR_KEY, &text_color, NULL);
     gtr_cell_renderer_render(cell->text_renderer, window, widget, &name_area, flags);
-
-    /* cleanup */
-    g_object_unref(icon);
 }
 
 static void render_full(TorrentCellRenderer *cell, GtrDrawable *window, GtkWidget *widget,
@@ -860,7 +955,7 @@ static void render_full(TorrentCellRenderer *cell, GtrDrawable *window, GtkWidge
     GdkRectangle stat_area;
     GdkRectangle prog_area;
     GdkRectangle prct_area;
-    GdkPixbuf *icon;
+    const trg_cell_icon *icon;
     GtrColor text_color;
     gboolean seed;
 
@@ -872,7 +967,7 @@ static void render_full(TorrentCellRenderer *cell, GtrDrawable *window, GtkWidge
     GString *gstr_prog = cell->gstr1;
     GString *gstr_stat = cell->gstr2;
 
-    icon = get_icon(cell, FULL_ICON_SIZE, widget);
+    icon = get_icon(cell, FALSE, widget);
     g_string_truncate(gstr_prog, 0);
     getProgressString(gstr_prog, cell);
     g_string_truncate(gstr_stat, 0);
@@ -881,22 +976,15 @@ static void render_full(TorrentCellRenderer *cell, GtrDrawable *window, GtkWidge
     get_text_color(cell, widget, &text_color);
 
     /* get the idealized cell dimensions */
-    g_object_set(cell->icon_renderer, "pixbuf", icon, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->icon_renderer, widget, NULL, &size);
-    icon_area.width = size.width;
-    icon_area.height = size.height;
-    g_object_set(cell->text_renderer, "text", torrent_get_name(cell->json), "weight",
-                 PANGO_WEIGHT_BOLD, "ellipsize", PANGO_ELLIPSIZE_NONE, "scale", 1.0, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &size);
+    icon_area.width = icon->size.width;
+    icon_area.height = icon->size.height;
+    get_text_size(cell, widget, TEXT_STYLE_NAME_BOLD, torrent_get_name(cell->json), &size);
     name_area.width = size.width;
     name_area.height = size.height;
-    g_object_set(cell->text_renderer, "text", gstr_prog->str, "weight", PANGO_WEIGHT_NORMAL,
-                 "scale", SMALL_SCALE, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &size);
+    get_text_size(cell, widget, TEXT_STYLE_SMALL, gstr_prog->str, &size);
     prog_area.width = size.width;
     prog_area.height = size.height;
-    g_object_set(cell->text_renderer, "text", gstr_stat->str, NULL);
-    gtr_cell_renderer_get_preferred_size(cell->text_renderer, widget, NULL, &size);
+    get_text_size(cell, widget, TEXT_STYLE_SMALL, gstr_stat->str, &size);
     stat_area.width = size.width;
     stat_area.height = size.height;
 
@@ -939,7 +1027,7 @@ static void render_full(TorrentCellRenderer *cell, GtrDrawable *window, GtkWidge
     *** RENDER
     **/
 
-    g_object_set(cell->icon_renderer, "pixbuf", icon, "sensitive", sensitive, NULL);
+    g_object_set(cell->icon_renderer, "pixbuf", icon->pixbuf, "sensitive", sensitive, NULL);
     gtr_cell_renderer_render(cell->icon_renderer, window, widget, &icon_area, flags);
     g_object_set(cell->text_renderer, "text", torrent_get_name(cell->json), "scale", 1.0,
                  FOREGROUND_COLOR_KEY, &text_color, "ellipsize", PANGO_ELLIPSIZE_END, "weight",
@@ -954,9 +1042,6 @@ static void render_full(TorrentCellRenderer *cell, GtrDrawable *window, GtkWidge
     g_object_set(cell->text_renderer, "text", gstr_stat->str, FOREGROUND_COLOR_KEY, &text_color,
                  NULL);
     gtr_cell_renderer_render(cell->text_renderer, window, widget, &stat_area, flags);
-
-    /* cleanup */
-    g_object_unref(icon);
 }
 
 GtkTreeView *torrent_cell_renderer_get_owner(TorrentCellRenderer *r)
@@ -398,29 +398,24 @@ gchar *torrent_get_status_string(gint64 rpcv, gint64 value, guint flags)
     return g_strdup(_("Unknown"));
 }
 
-gboolean torrent_has_tracker(JsonObject *t, GRegex *rx, gchar *search)
-{
-    GList *trackers;
-    GList *li;
-    gboolean ret = FALSE;
-
-    trackers = json_array_get_elements(torrent_get_tracker_stats(t));
-
-    for (li = trackers; li; li = g_list_next(li)) {
-        JsonObject *tracker = json_node_get_object((JsonNode *)li->data);
-        const gchar *trackerAnnounce = tracker_stats_get_announce(tracker);
-        gchar *trackerAnnounceHost = trg_gregex_get_first(rx, trackerAnnounce);
-        int cmpResult = g_strcmp0(trackerAnnounceHost, search);
-        g_free(trackerAnnounceHost);
-        if (!cmpResult) {
-            ret = TRUE;
-            break;
-        }
-    }
+gboolean torrent_tracker_announces_equal(JsonObject *a, JsonObject *b)
+{
+    JsonArray *aTrackers = torrent_get_tracker_stats(a);
+    JsonArray *bTrackers = torrent_get_tracker_stats(b);
+    guint i, n = json_array_get_length(aTrackers);
+
+    if (n != json_array_get_length(bTrackers))
+        return FALSE;
+
+    for (i = 0; i < n; i++) {
+        JsonObject *aTracker = json_array_get_object_element(aTrackers, i);
+        JsonObject *bTracker = json_array_get_object_element(bTrackers, i);
 
-    g_list_free(trackers);
+        if (g_strcmp0(tracker_stats_get_announce(aTracker), tracker_stats_get_announce(bTracker)))
+            return FALSE;
+    }
 
-    return ret;
+    return TRUE;
 }
 
 gint64 torrent_get_left_until_done(JsonObject *t)
@@ -457,6 +452,17 @@ JsonArray *torrent_get_files(JsonObject *args)
     return json_object_get_array_member(args, FIELD_FILES);
 }
 
+/* From file-count where the daemon has it, otherwise the files array. */
+guint torrent_get_file_count(JsonObject *t)
+{
+    if (json_object_has_member(t, FIELD_FILE_COUNT))
+        return json_object_get_int_member(t, FIELD_FILE_COUNT);
+    else if (json_object_has_member(t, FIELD_FILES))
+        return json_array_get_length(torrent_get_files(t));
+    else
+        return 0;
+}
+
 gint64 torrent_get_peers_connected(JsonObject *args)
 {
     return json_object_get_int_member(args, FIELD_PEERS_CONNECTED);
@@ -40,6 +40,7 @@
 #define TORRENT_FLAG_DOWNLOADING_METADATA (1 << 13)
 #define FILTER_FLAG_TRACKER               (1 << 14)
 #define FILTER_FLAG_DIR                   (1 << 15)
+#define FILTER_FLAG_QUERY                 (1 << 16)
 
 #define TORRENT_ADD_FLAG_PAUSED (1 << 0) /* 0x01 */
 #define TORRENT_ADD_FLAG_DELETE (1 << 1) /* 0x02 */
@@ -74,6 +75,7 @@ JsonArray *torrent_get_wanted(JsonObject *t);
 JsonArray *torrent_get_priorities(JsonObject *t);
 gint64 torrent_get_id(JsonObject *t);
 JsonArray *torrent_get_files(JsonObject *args);
+guint torrent_get_file_count(JsonObject *t);
 gint64 torrent_get_peers_getting_from_us(JsonObject *args);
 gint64 torrent_get_peers_sending_to_us(JsonObject *args);
 gint64 torrent_get_web_seeds_sending_to_us(JsonObject *args);
@@ -95,7 +97,7 @@ gboolean torrent_get_download_limited(JsonObject *t);
 gdouble torrent_get_seed_ratio_limit(JsonObject *t);
 gint64 torrent_get_seed_ratio_mode(JsonObject *t);
 gint64 torrent_get_peer_limit(JsonObject *t);
-gboolean torrent_has_tracker(JsonObject *t, GRegex *rx, gchar *search);
+gboolean torrent_tracker_announces_equal(JsonObject *a, JsonObject *b);
 gint64 torrent_get_queue_position(JsonObject *args);
 gint64 torrent_get_activity_date(JsonObject *t);
 gchar *torrent_get_full_dir(JsonObject *obj);
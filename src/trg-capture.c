@@ -0,0 +1,262 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Recording and replaying RPC traffic.
+ *
+ * With TRG_RECORD=<file>, every response the client gets is appended to that
+ * file along with the request that produced it. With TRG_REPLAY=<file>,
+ * nothing is sent at all: each request is answered from the capture after
+ * the time the original response took, so a session recorded against a real
+ * daemon can be run again, with identical data, against another build (with
+ * TRG_PROFILE to compare the timings).
+ *
+ * The file starts with a TRG_CAPTURE_MAGIC line and each record is a line of
+ *
+ *   <usec since start> <usec taken> <HTTP status> <headers> <request length> <response length>
+ *
+ * followed by that many "Name: value" response header lines, the request and
+ * response bodies as they were, and a newline.
+ *
+ * Responses are replayed in order for each distinct request body. Once one
+ * runs out, its last response keeps being served, so a replay can go on for
+ * longer than the capture did.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trg-capture.h"
+
+#define TRG_CAPTURE_MAGIC "TRG-CAPTURE 1\n"
+
+typedef struct {
+    guint status;
+    gint64 duration;
+    GBytes *response;
+} trg_capture_reply;
+
+static FILE *trg_capture_file;
+static gint64 trg_capture_started;
+/* request body (GBytes) -> GQueue of trg_capture_reply, when replaying */
+static GHashTable *trg_capture_replies;
+
+static void trg_capture_reply_free(trg_capture_reply *reply)
+{
+    g_bytes_unref(reply->response);
+    g_free(reply);
+}
+
+static void trg_capture_replies_free(GQueue *replies)
+{
+    g_queue_free_full(replies, (GDestroyNotify)trg_capture_reply_free);
+}
+
+static const gchar *trg_capture_next_line(const gchar *p, const gchar *end)
+{
+    const gchar *eol = memchr(p, '\n', end - p);
+    return eol ? eol + 1 : NULL;
+}
+
+static void trg_capture_load(const gchar *filename)
+{
+    g_autoptr(GError) error = NULL;
+    GMappedFile *mf;
+    const gchar *p, *end;
+    guint count = 0;
+
+    trg_capture_replies = g_hash_table_new_full(g_bytes_hash, g_bytes_equal,
+                                                (GDestroyNotify)g_bytes_unref,
+                                                (GDestroyNotify)trg_capture_replies_free);
+
+    mf = g_mapped_file_new(filename, FALSE, &error);
+    if (!mf) {
+        g_warning("unable to replay %s: %s", filename, error->message);
+        return;
+    }
+
+    p = g_mapped_file_get_contents(mf);
+    end = p + g_mapped_file_get_length(mf);
+
+    if (end - p < (gssize)strlen(TRG_CAPTURE_MAGIC)
+        || memcmp(p, TRG_CAPTURE_MAGIC, strlen(TRG_CAPTURE_MAGIC))) {
+        g_warning("%s is not an RPC capture", filename);
+        g_mapped_file_unref(mf);
+        return;
+    }
+
+    p += strlen(TRG_CAPTURE_MAGIC);
+
+    while (p < end) {
+        const gchar *next = trg_capture_next_line(p, end);
+        g_autofree gchar *line = NULL;
+        g_auto(GStrv) fields = NULL;
+        trg_capture_reply *reply;
+        GBytes *request;
+        GQueue *replies;
+        guint64 nHeaders, requestLen, responseLen;
+
+        if (!next)
+            break;
+
+        line = g_strndup(p, next - p - 1);
+        fields = g_strsplit(line, " ", 0);
+        if (g_strv_length(fields) != 6)
+            break;
+
+        nHeaders = g_ascii_strtoull(fields[3], NULL, 10);
+        requestLen = g_ascii_strtoull(fields[4], NULL, 10);
+        responseLen = g_ascii_strtoull(fields[5], NULL, 10);
+
+        for (p = next; p && nHeaders > 0; nHeaders--)
+            p = trg_capture_next_line(p, end);
+
+        if (!p || (guint64)(end - p) < requestLen + responseLen + 1)
+            break;
+
+        reply = g_new0(trg_capture_reply, 1);
+        reply->duration = g_ascii_strtoll(fields[1], NULL, 10);
+        reply->status = g_ascii_strtoull(fields[2], NULL, 10);
+        reply->response = g_bytes_new(p + requestLen, responseLen);
+
+        request = g_bytes_new(p, requestLen);
+        replies = g_hash_table_lookup(trg_capture_replies, request);
+        if (!replies) {
+            replies = g_queue_new();
+            g_hash_table_insert(trg_capture_replies, g_bytes_ref(request), replies);
+        }
+
+        g_queue_push_tail(replies, reply);
+        g_bytes_unref(request);
+
+        p += requestLen + responseLen + 1;
+        count++;
+    }
+
+    if (p < end)
+        g_warning("%s is truncated or corrupt, replaying the first %u responses", filename, count);
+
+    g_mapped_file_unref(mf);
+}
+
+static void trg_capture_init(void)
+{
+    static gboolean initialised = FALSE;
+    const gchar *filename;
+
+    if (G_LIKELY(initialised))
+        return;
+
+    initialised = TRUE;
+
+    if ((filename = g_getenv("TRG_REPLAY"))) {
+        trg_capture_load(filename);
+    } else if ((filename = g_getenv("TRG_RECORD"))) {
+        trg_capture_file = g_fopen(filename, "ab");
+        if (!trg_capture_file) {
+            g_warning("unable to record to %s: %s", filename, g_strerror(errno));
+            return;
+        }
+
+        fseek(trg_capture_file, 0, SEEK_END);
+        if (ftell(trg_capture_file) == 0)
+            fputs(TRG_CAPTURE_MAGIC, trg_capture_file);
+
+        trg_capture_started = g_get_monotonic_time();
+    }
+}
+
+/* Whether requests should be answered from a capture instead of being sent. */
+gboolean trg_capture_replaying(void)
+{
+    trg_capture_init();
+    return trg_capture_replies != NULL;
+}
+
+/* Append a response, and the request body it answers, to the capture being
+ * recorded, if there is one. sent is when the request went out. */
+void trg_capture_record(GBytes *request, guint status, SoupMessageHeaders *headers,
+                        GBytes *response, gint64 sent)
+{
+    SoupMessageHeadersIter iter;
+    const gchar *name, *value;
+    gconstpointer requestData, responseData;
+    gsize requestLen, responseLen;
+    GString *lines;
+    guint nHeaders = 0;
+
+    trg_capture_init();
+
+    if (!trg_capture_file)
+        return;
+
+    lines = g_string_new(NULL);
+    soup_message_headers_iter_init(&iter, headers);
+    while (soup_message_headers_iter_next(&iter, &name, &value)) {
+        g_string_append_printf(lines, "%s: %s\n", name, value);
+        nHeaders++;
+    }
+
+    requestData = g_bytes_get_data(request, &requestLen);
+    responseData = g_bytes_get_data(response, &responseLen);
+
+    fprintf(trg_capture_file, "%" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %u %u",
+            sent - trg_capture_started, g_get_monotonic_time() - sent, status, nHeaders);
+    fprintf(trg_capture_file, " %" G_GSIZE_FORMAT " %" G_GSIZE_FORMAT "\n", requestLen,
+            responseLen);
+    fwrite(lines->str, 1, lines->len, trg_capture_file);
+    fwrite(requestData, 1, requestLen, trg_capture_file);
+    fwrite(responseData, 1, responseLen, trg_capture_file);
+    fputc('\n', trg_capture_file);
+    fflush(trg_capture_file);
+
+    g_string_free(lines, TRUE);
+}
+
+/* The next recorded response to a request body, with its HTTP status and how
+ * long it took in microseconds, or NULL if the capture never saw it. */
+GBytes *trg_capture_replay(GBytes *request, guint *status, gint64 *duration)
+{
+    trg_capture_reply *reply;
+    GBytes *response;
+    GQueue *replies;
+
+    if (!trg_capture_replaying())
+        return NULL;
+
+    replies = g_hash_table_lookup(trg_capture_replies, request);
+    if (!replies)
+        return NULL;
+
+    reply = g_queue_peek_head(replies);
+    *status = reply->status;
+    *duration = reply->duration;
+    response = g_bytes_ref(reply->response);
+
+    if (g_queue_get_length(replies) > 1)
+        trg_capture_reply_free(g_queue_pop_head(replies));
+
+    return response;
+}
@@ -61,9 +61,8 @@ static void trg_cell_renderer_epoch_set_property(GObject *object, guint property
         gint64 new_value = g_value_get_int64(value);
         if (self->epoch_value != new_value) {
             if (new_value > 0) {
-                gchar *timestring = epoch_to_string(new_value);
-                g_object_set(object, "text", timestring, NULL);
-                g_free(timestring);
+                g_object_set(object, "text", trg_format_cached(TRG_FORMAT_EPOCH, new_value),
+                             NULL);
             } else {
                 g_object_set(object, "text", "", NULL);
             }
@@ -58,15 +58,15 @@ static void trg_cell_renderer_eta_set_property(GObject *object, guint property_i
     TrgCellRendererEta *self = TRG_CELL_RENDERER_ETA(object);
 
     if (property_id == PROP_ETA_VALUE) {
-        self->eta_value = g_value_get_int64(value);
-        if (self->eta_value > 0) {
-            char etaString[32];
-            tr_strltime_short(etaString, self->eta_value, sizeof(etaString));
-            g_object_set(object, "text", etaString, NULL);
-        } else if (self->eta_value == -2) {
-            g_object_set(object, "text", "∞", NULL);
-        } else {
-            g_object_set(object, "text", "", NULL);
+        gint64 new_value = g_value_get_int64(value);
+        if (self->eta_value != new_value) {
+            if (new_value > 0)
+                g_object_set(object, "text", trg_format_cached(TRG_FORMAT_ETA, new_value), NULL);
+            else if (new_value == -2)
+                g_object_set(object, "text", "∞", NULL);
+            else
+                g_object_set(object, "text", "", NULL);
+            self->eta_value = new_value;
         }
     } else {
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -57,13 +57,13 @@ static void trg_cell_renderer_ratio_set_property(GObject *object, guint property
 {
     TrgCellRendererRatio *self = TRG_CELL_RENDERER_RATIO(object);
     if (property_id == PROP_RATIO_VALUE) {
-        self->ratio_value = g_value_get_double(value);
-        if (self->ratio_value > 0) {
-            char ratioString[32];
-            trg_strlratio(ratioString, self->ratio_value);
-            g_object_set(object, "text", ratioString, NULL);
-        } else {
-            g_object_set(object, "text", "", NULL);
+        gdouble new_value = g_value_get_double(value);
+        if (self->ratio_value != new_value) {
+            if (new_value > 0)
+                g_object_set(object, "text", trg_format_ratio_cached(new_value), NULL);
+            else
+                g_object_set(object, "text", "", NULL);
+            self->ratio_value = new_value;
         }
     } else {
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
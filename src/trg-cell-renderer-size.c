@@ -60,9 +60,7 @@ static void trg_cell_renderer_size_set_property(GObject *object, guint property_
         gint64 new_value = g_value_get_int64(value);
         if (self->size_value != new_value) {
             if (new_value > 0) {
-                char sizeString[32];
-                trg_strlsize(sizeString, new_value);
-                g_object_set(object, "text", sizeString, NULL);
+                g_object_set(object, "text", trg_format_cached(TRG_FORMAT_SIZE, new_value), NULL);
             } else {
                 g_object_set(object, "text", "", NULL);
             }
@@ -60,9 +60,8 @@ static void trg_cell_renderer_speed_set_property(GObject *object, guint property
         gint64 new_value = g_value_get_int64(value);
         if (new_value != self->speed_value) {
             if (new_value > 0) {
-                char speedString[32];
-                trg_strlspeed(speedString, new_value / disk_K);
-                g_object_set(object, "text", speedString, NULL);
+                g_object_set(object, "text", trg_format_cached(TRG_FORMAT_SPEED, new_value),
+                             NULL);
             } else {
                 g_object_set(object, "text", "", NULL);
             }
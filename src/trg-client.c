@@ -22,6 +22,9 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gprintf.h>
+#ifdef G_OS_UNIX
+#include <gio/gunixsocketaddress.h>
+#endif
 #include <libsoup/soup.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -30,8 +33,11 @@
 #include "json.h"
 #include "protocol-constants.h"
 #include "requests.h"
+#include "trg-capture.h"
 #include "trg-client.h"
 #include "trg-prefs.h"
+#include "trg-profile.h"
+#include "trg-trace.h"
 #include "util.h"
 
 /* This class manages/does quite a few things, and is passed around a lot. It:
@@ -57,8 +63,10 @@ struct _TrgClient {
     JsonObject *session;
     gboolean ssl;
     gboolean ssl_validate;
+    gboolean compression;
     gdouble version;
     GUri *url;
+    char *socketPath;
     char *username;
     char *password;
     GHashTable *headers;
@@ -114,6 +122,7 @@ static void trg_client_finalize(GObject *object)
     g_clear_pointer(&self->session_id, g_free);
     g_clear_pointer(&self->session, json_object_unref);
     g_clear_pointer(&self->url, g_uri_unref);
+    g_clear_pointer(&self->socketPath, g_free);
     g_clear_pointer(&self->username, g_free);
     g_clear_pointer(&self->password, g_free);
     g_clear_pointer(&self->headers, g_hash_table_unref);
@@ -139,18 +148,43 @@ static void trg_client_init(TrgClient *self)
 {
 }
 
-TrgClient *trg_client_new(void)
+/* A session for talking to daemons over TCP or, given a socket path, to the
+ * one listening on that Unix domain socket. */
+SoupSession *trg_client_session_new(const gchar *socketPath)
 {
-    TrgClient *self = TRG_CLIENT(g_object_new(TRG_TYPE_CLIENT, NULL));
+    GSocketAddress *remote = NULL;
+    SoupSession *session;
 
-    TrgPrefs *prefs = self->prefs = trg_prefs_new();
-    self->rpc_session = soup_session_new_with_options("user-agent", PACKAGE_NAME, NULL);
+#ifdef G_OS_UNIX
+    if (socketPath)
+        remote = g_unix_socket_address_new(socketPath);
+#endif
+
+    session = soup_session_new_with_options("user-agent", PACKAGE_NAME, "remote-connectable",
+                                            remote, NULL);
+    g_clear_object(&remote);
+
+    /* Advertise gzip and deflate (and brotli, if libsoup was built with it)
+     * and decode responses as they're read. Left out per message when the
+     * profile turns compression off. */
+    if (!soup_session_has_feature(session, SOUP_TYPE_CONTENT_DECODER))
+        soup_session_add_feature_by_type(session, SOUP_TYPE_CONTENT_DECODER);
 
     if (g_getenv("TRG_CLIENT_DEBUG") != NULL) {
         g_autoptr(SoupLogger) log = soup_logger_new(SOUP_LOGGER_LOG_BODY);
-        soup_session_add_feature(self->rpc_session, SOUP_SESSION_FEATURE(log));
+        soup_session_add_feature(session, SOUP_SESSION_FEATURE(log));
     }
 
+    return session;
+}
+
+TrgClient *trg_client_new(void)
+{
+    TrgClient *self = TRG_CLIENT(g_object_new(TRG_TYPE_CLIENT, NULL));
+
+    TrgPrefs *prefs = self->prefs = trg_prefs_new();
+    self->rpc_session = trg_client_session_new(NULL);
+
     trg_prefs_load(prefs);
 
     g_mutex_init(&self->configMutex);
@@ -206,12 +240,18 @@ void trg_client_set_session(TrgClient *tc, JsonObject *session)
     g_signal_emit(tc, signals[TC_SESSION_UPDATED], 0, session);
 }
 
+/* Shared with anything else talking to a daemon, to pool connections. */
+SoupSession *trg_client_get_soup_session(TrgClient *tc)
+{
+    return tc->rpc_session;
+}
+
 TrgPrefs *trg_client_get_prefs(TrgClient *tc)
 {
     return tc->prefs;
 }
 
-static GHashTable *trg_client_headers_array_to_table(JsonArray *array)
+GHashTable *trg_client_headers_array_to_table(JsonArray *array)
 {
     GList *nodes, *nodes_iter;
     const gchar *key, *value;
@@ -244,7 +284,7 @@ static GHashTable *trg_client_headers_array_to_table(JsonArray *array)
     return headers;
 }
 
-static void trg_client_inject_custom_header(gpointer key, gpointer value, gpointer user_data)
+void trg_client_inject_custom_header(gpointer key, gpointer value, gpointer user_data)
 {
     SoupMessageHeaders *headers = user_data;
     soup_message_headers_replace(headers, (gchar *)key, (gchar *)value);
@@ -272,6 +312,8 @@ gboolean trg_client_parse_settings(TrgClient *tc, gchar **err_msg)
         = trg_prefs_get_string(prefs, TRG_PREFS_KEY_HOSTNAME, TRG_PREFS_CONNECTION);
     g_autofree gchar *path
         = trg_prefs_get_string(prefs, TRG_PREFS_KEY_RPC_URL_PATH, TRG_PREFS_CONNECTION);
+    const gchar *socketPath;
+    g_autofree gchar *uri_str = NULL;
 
     if (!host || strlen(host) < 1) {
         g_mutex_unlock(&tc->configMutex);
@@ -279,11 +321,44 @@ gboolean trg_client_parse_settings(TrgClient *tc, gchar **err_msg)
         return FALSE;
     }
 
+    socketPath = g_str_has_prefix(host, UNIX_SOCKET_PREFIX) ? host + strlen(UNIX_SOCKET_PREFIX)
+                                                            : NULL;
+
+#ifndef G_OS_UNIX
+    if (socketPath) {
+        g_mutex_unlock(&tc->configMutex);
+        *err_msg = g_strdup(_("Unix domain sockets aren't supported on this platform."));
+        return FALSE;
+    }
+#endif
+
+    if (socketPath && !*socketPath) {
+        g_mutex_unlock(&tc->configMutex);
+        *err_msg = g_strdup(_("Bad socket path."));
+        return FALSE;
+    }
+
+    /* The socket is fixed for the life of a session, so a different one
+     * (or none) means a new session. */
+    if (g_strcmp0(socketPath, tc->socketPath)) {
+        soup_session_abort(tc->rpc_session);
+        g_object_unref(tc->rpc_session);
+        tc->rpc_session = trg_client_session_new(socketPath);
+        g_free(tc->socketPath);
+        tc->socketPath = g_strdup(socketPath);
+    }
+
     tc->ssl = trg_prefs_get_bool(prefs, TRG_PREFS_KEY_SSL, TRG_PREFS_CONNECTION);
     tc->ssl_validate = trg_prefs_get_bool(prefs, TRG_PREFS_KEY_SSL_VALIDATE, TRG_PREFS_CONNECTION);
+    tc->compression = trg_prefs_get_bool(prefs, TRG_PREFS_KEY_COMPRESSION, TRG_PREFS_CONNECTION);
 
-    g_autofree gchar *uri_str = g_strdup_printf(
-        "%s://%s:%d%s", tc->ssl ? HTTPS_URI_PREFIX : HTTP_URI_PREFIX, host, port, path);
+    /* Over a socket the URL's host and port aren't used to connect, but
+     * still make up the Host header. */
+    if (socketPath)
+        uri_str = g_strdup_printf("%s://localhost%s", HTTP_URI_PREFIX, path);
+    else
+        uri_str = g_strdup_printf("%s://%s:%d%s", tc->ssl ? HTTPS_URI_PREFIX : HTTP_URI_PREFIX,
+                                  host, port, path);
 
     tc->url = g_uri_parse(uri_str, G_URI_FLAGS_NONE, &uri_err);
     if (uri_err) {
@@ -417,13 +492,14 @@ void trg_response_free(trg_response *response)
     if (response) {
         g_clear_pointer(&response->obj, json_object_unref);
         g_clear_pointer(&response->err_msg, g_free);
+        trg_request_timing_submit(response->timing);
         g_free(response);
     }
 }
 
 void trg_client_update_session(TrgClient *tc, GSourceFunc callback, gpointer data)
 {
-    dispatch_rpc_async(tc, session_get(), callback, data);
+    dispatch_rpc_bytes_async(tc, session_get_body(), METHOD_SESSION_GET, callback, data);
 }
 
 gdouble trg_client_get_seed_ratio_limit(TrgClient *tc)
@@ -443,12 +519,17 @@ typedef struct {
     GCancellable *cancellable;
     gint connid;
     GBytes *body;
+    gint64 sent;
+    guint replayStatus;
+    GBytes *replayBody;
+    trg_request_timing *timing;
     GSourceFunc response_cb;
     gpointer *cb_data;
 } trg_request;
 
 /* request handling */
-static trg_request *trg_request_new(TrgClient *tc, GBytes *body, GSourceFunc cb, gpointer cb_data)
+static trg_request *trg_request_new(TrgClient *tc, GBytes *body, trg_request_timing *timing,
+                                    GSourceFunc cb, gpointer cb_data)
 {
     trg_request *request = (trg_request *)g_new0(trg_request, 1);
 
@@ -460,6 +541,7 @@ static trg_request *trg_request_new(TrgClient *tc, GBytes *body, GSourceFunc cb,
     request->connid = trg_client_get_connid(tc);
 
     request->body = body;
+    request->timing = timing;
     request->response_cb = cb;
     request->cb_data = cb_data;
 
@@ -467,8 +549,10 @@ static trg_request *trg_request_new(TrgClient *tc, GBytes *body, GSourceFunc cb,
 }
 
 static void session_id_callback(SoupMessage *msg, gpointer user_data);
+static void got_headers_callback(SoupMessage *msg, gpointer user_data);
 static gboolean auth_callback(SoupMessage *msg, SoupAuth *auth, gboolean retry, gpointer user_data);
 static void rpc_callback(GObject *source, GAsyncResult *result, gpointer user_data);
+static gboolean replay_callback(gpointer user_data);
 static gboolean tls_callback(SoupMessage *msg, GTlsCertificate *cert,
                              GTlsCertificateFlags tls_errors, gpointer user_data);
 
@@ -485,6 +569,10 @@ static void trg_request_setup_msg(trg_request *request)
     }
 
     msg = soup_message_new_from_uri(SOUP_METHOD_POST, self->url);
+    soup_message_add_flags(msg, SOUP_MESSAGE_COLLECT_METRICS);
+
+    if (!self->compression)
+        soup_message_disable_feature(msg, SOUP_TYPE_CONTENT_DECODER);
 
     request->cancellable = g_cancellable_new();
 
@@ -499,6 +587,7 @@ static void trg_request_setup_msg(trg_request *request)
 
     g_signal_connect(msg, "accept-certificate", G_CALLBACK(tls_callback), (gpointer)request);
     g_signal_connect(msg, "authenticate", G_CALLBACK(auth_callback), (gpointer)request);
+    g_signal_connect(msg, "got-headers", G_CALLBACK(got_headers_callback), (gpointer)request);
     soup_message_add_status_code_handler(msg, "got-headers", SOUP_STATUS_CONFLICT,
                                          G_CALLBACK(session_id_callback), request);
 
@@ -514,6 +603,17 @@ static void trg_request_set_body(trg_request *request)
 static void trg_request_send(trg_request *request)
 {
     TrgClient *self = request->client;
+    gint64 duration = 0;
+
+    request->sent = g_get_monotonic_time();
+    trg_request_timing_mark(request->timing, TRG_TIMING_SENT);
+
+    if (trg_capture_replaying()) {
+        request->replayBody = trg_capture_replay(request->body, &request->replayStatus, &duration);
+        g_timeout_add(duration / 1000, replay_callback, request);
+        return;
+    }
+
     soup_session_send_and_read_async(self->rpc_session, request->msg, G_PRIORITY_DEFAULT,
                                      request->cancellable, rpc_callback, request);
 }
@@ -524,6 +624,8 @@ static void trg_request_free(trg_request *request)
     g_clear_object(&request->msg);
     g_clear_object(&request->cancellable);
     g_clear_pointer(&request->body, g_bytes_unref);
+    g_clear_pointer(&request->replayBody, g_bytes_unref);
+    g_clear_pointer(&request->timing, trg_request_timing_free);
     g_clear_pointer(&request, g_free);
 }
 
@@ -540,6 +642,9 @@ static void trg_request_free(trg_request *request)
  * 4. trg_request_callback(): calls the original callback passed to dispatch_rpc_async(), sets
  *    up a trg_response and/or passes back any errors and state
  * 5. response_cb(): original callback passed to dispatch_rpc_async().
+ *
+ * When replaying a capture (see trg-capture.c), step 1 instead schedules replay_callback(), which
+ * hands the recorded response to the same parsing as rpc_callback() and carries on from step 4.
  */
 
 static void trg_request_callback(trg_request *request, JsonObject *obj, gint status, gchar *err_msg)
@@ -560,44 +665,47 @@ static void trg_request_callback(trg_request *request, JsonObject *obj, gint sta
     response->cb_data = cb_data;
     response->status = status;
     response->err_msg = err_msg;
+    response->timing = g_steal_pointer(&request->timing);
 
     trg_request_free(request);
+    trg_request_timing_mark(response->timing, TRG_TIMING_CALLBACK);
+
+    if (response->timing)
+        trg_trace_async("rpc", response->timing->method,
+                        response->timing->at[TRG_TIMING_DISPATCHED]);
+
     response_cb(response);
 }
 
-static void rpc_callback(GObject *source, GAsyncResult *result, gpointer user_data)
+/* Turn a response body (taking ownership of it) into the trg_response the
+ * original callback gets. */
+static void trg_request_handle_response(trg_request *request, gint status, GBytes *bytes)
 {
-    trg_request *request = user_data;
     g_autofree gchar *data = NULL;
     g_autoptr(GError) error = NULL;
     g_autoptr(JsonParser) parser = NULL;
     g_autoptr(JsonNode) root = NULL;
     JsonObject *obj = NULL;
-    gint status = SOUP_STATUS_OK;
     gsize len;
     gchar *err_msg = NULL;
     JsonNode *rpc_result;
+    gint64 parseStart;
+    gboolean parsed;
 
-    GBytes *bytes = soup_session_send_and_read_finish(SOUP_SESSION(source), result, &error);
-    if (error) {
-        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-            return;
-
-        status = FAIL_HTTP_UNSUCCESSFUL;
-        err_msg = g_strdup(error->message);
-        goto out;
-    }
-
-    status = soup_message_get_status(request->msg);
     if (status != SOUP_STATUS_OK) {
+        g_bytes_unref(bytes);
         goto out;
     }
 
+    if (request->timing)
+        request->timing->bytes = g_bytes_get_size(bytes);
+
     /* TODO(?): Switch this to json_parser_load_from_stream_async() when libsoup
      * can handle threading better. That function works in a thread underneath
      * the hood so libsoup has trouble with it. See libsoup #307 */
     parser = json_parser_new();
     data = (gchar *)g_bytes_unref_to_data(bytes, &len);
+    parseStart = trg_span_start();
 
     // Potential Transmission bug, we need to validate utf-8, see #261
     if (!g_utf8_validate(data, len, NULL)) {
@@ -612,7 +720,13 @@ static void rpc_callback(GObject *source, GAsyncResult *result, gpointer user_da
         len = strlen(data);
     }
 
-    if (!json_parser_load_from_data(parser, data, len, &error)) {
+    trg_request_timing_mark(request->timing, TRG_TIMING_VALIDATED);
+
+    parsed = json_parser_load_from_data(parser, data, len, &error);
+    trg_span_stop(TRG_PROFILE_RPC_PARSE, "rpc", "parse", parseStart);
+    trg_request_timing_mark(request->timing, TRG_TIMING_PARSED);
+
+    if (!parsed) {
         status = FAIL_JSON_DECODE;
         err_msg = g_strdup(error->message);
         goto out;
@@ -635,6 +749,53 @@ out:
     trg_request_callback(request, obj, status, err_msg);
 }
 
+static void rpc_callback(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    trg_request *request = user_data;
+    g_autoptr(GError) error = NULL;
+    SoupMessageMetrics *metrics;
+    guint status;
+
+    GBytes *bytes = soup_session_send_and_read_finish(SOUP_SESSION(source), result, &error);
+    if (error) {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            return;
+
+        trg_request_callback(request, NULL, FAIL_HTTP_UNSUCCESSFUL, g_strdup(error->message));
+        return;
+    }
+
+    trg_request_timing_mark(request->timing, TRG_TIMING_RECEIVED);
+
+    metrics = soup_message_get_metrics(request->msg);
+    if (metrics && request->timing)
+        request->timing->wireBytes = soup_message_metrics_get_response_body_bytes_received(metrics);
+
+    status = soup_message_get_status(request->msg);
+    trg_capture_record(request->body, status, soup_message_get_response_headers(request->msg),
+                       bytes, request->sent);
+
+    trg_request_handle_response(request, status, bytes);
+}
+
+/* Deliver a response from the capture given by TRG_REPLAY in place of one
+ * from the daemon. */
+static gboolean replay_callback(gpointer user_data)
+{
+    trg_request *request = user_data;
+
+    trg_request_timing_mark(request->timing, TRG_TIMING_RECEIVED);
+
+    if (!request->replayBody)
+        trg_request_callback(request, NULL, FAIL_HTTP_UNSUCCESSFUL,
+                             g_strdup("No response to this request was recorded."));
+    else
+        trg_request_handle_response(request, request->replayStatus,
+                                    g_steal_pointer(&request->replayBody));
+
+    return G_SOURCE_REMOVE;
+}
+
 static gboolean tls_callback(SoupMessage *msg, GTlsCertificate *cert,
                              GTlsCertificateFlags tls_errors, gpointer user_data)
 {
@@ -657,6 +818,12 @@ static gboolean auth_callback(SoupMessage *msg, SoupAuth *auth, gboolean retry,
     return TRUE;
 }
 
+static void got_headers_callback(SoupMessage *msg, gpointer user_data)
+{
+    trg_request *request = user_data;
+    trg_request_timing_mark(request->timing, TRG_TIMING_HEADERS);
+}
+
 static void session_id_callback(SoupMessage *msg, gpointer data)
 {
     SoupMessageHeaders *response_headers;
@@ -681,12 +848,26 @@ static void session_id_callback(SoupMessage *msg, gpointer data)
     trg_request_send(request);
 }
 
+static void trg_request_dispatch(TrgClient *tc, GBytes *body, trg_request_timing *timing,
+                                 GSourceFunc callback, gpointer data)
+{
+    trg_request_timing_mark(timing, TRG_TIMING_SERIALIZED);
+
+    trg_request *request = trg_request_new(tc, body, timing, callback, data);
+    trg_request_setup_msg(request);
+
+    trg_request_set_body(request);
+    trg_request_send(request);
+}
+
 void dispatch_rpc_async(TrgClient *tc, JsonNode *req, GSourceFunc callback, gpointer data)
 {
     GBytes *req_bytes;
     gchar *req_body;
     gsize len;
     g_autoptr(JsonGenerator) generator = NULL;
+    const gchar *method = json_object_get_string_member(json_node_get_object(req), PARAM_METHOD);
+    trg_request_timing *timing = trg_request_timing_new(method);
 
     /* Note: ownership of req_body is taken by g_bytes_new_take() and will
      * be freed when req_bytes is freed */
@@ -694,9 +875,13 @@ void dispatch_rpc_async(TrgClient *tc, JsonNode *req, GSourceFunc callback, gpoi
     req_body = json_generator_to_data(generator, &len);
     req_bytes = g_bytes_new_take((gpointer)req_body, len);
 
-    trg_request *request = trg_request_new(tc, req_bytes, callback, data);
-    trg_request_setup_msg(request);
+    trg_request_dispatch(tc, req_bytes, timing, callback, data);
+}
 
-    trg_request_set_body(request);
-    trg_request_send(request);
+/* Send a request which has already been serialized, such as one of the
+ * recurring polls kept by requests.c. The body is referenced, not taken. */
+void dispatch_rpc_bytes_async(TrgClient *tc, GBytes *body, const gchar *method,
+                              GSourceFunc callback, gpointer data)
+{
+    trg_request_dispatch(tc, g_bytes_ref(body), trg_request_timing_new(method), callback, data);
 }
@@ -20,8 +20,10 @@
 
 #include <glib-object.h>
 #include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
 
 #include "session-get.h"
+#include "trg-diagnostics.h"
 #include "trg-prefs.h"
 
 #define TRANSMISSION_MIN_SUPPORTED     2.0
@@ -38,6 +40,9 @@
 #define HTTP_URI_PREFIX  "http"
 #define HTTPS_URI_PREFIX "https"
 
+/* A hostname of unix:/path/to/socket connects over a Unix domain socket. */
+#define UNIX_SOCKET_PREFIX "unix:"
+
 #define FAIL_HTTP_UNSUCCESSFUL   -1
 #define FAIL_JSON_DECODE         -2
 #define FAIL_RESULT_UNSUCCESSFUL -3
@@ -48,6 +53,7 @@ typedef struct {
     gchar *err_msg;
     JsonObject *obj;
     gpointer cb_data;
+    trg_request_timing *timing;
 } trg_response;
 
 void trg_response_free(trg_response *response);
@@ -58,11 +64,17 @@ G_DECLARE_FINAL_TYPE(TrgClient, trg_client, TRG, CLIENT, GObject);
 /* NOTE: This function is NOT THREAD SAFE, it MUST be called from the thread that TrgClient was
  * created in. */
 void dispatch_rpc_async(TrgClient *client, JsonNode *req, GSourceFunc callback, gpointer data);
+void dispatch_rpc_bytes_async(TrgClient *client, GBytes *body, const gchar *method,
+                              GSourceFunc callback, gpointer data);
 
 GType trg_client_get_type(void);
 
 TrgClient *trg_client_new(void);
 TrgPrefs *trg_client_get_prefs(TrgClient *tc);
+SoupSession *trg_client_get_soup_session(TrgClient *tc);
+SoupSession *trg_client_session_new(const gchar *socketPath);
+GHashTable *trg_client_headers_array_to_table(JsonArray *array);
+void trg_client_inject_custom_header(gpointer key, gpointer value, gpointer user_data);
 gboolean trg_client_parse_settings(TrgClient *tc, gchar **err_msg);
 void trg_client_set_session(TrgClient *tc, JsonObject *session);
 gdouble trg_client_get_version(TrgClient *tc);
@@ -0,0 +1,912 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Every connection profile at once: a row per daemon above one list of all
+ * their torrents, with a column saying which daemon each belongs to. Each
+ * daemon gets its own poller sending torrent-get, with at most one request
+ * in flight. The first poll (and the first after a failure or a daemon
+ * restart) asks for everything; later ones only for recently-active
+ * torrents and the ids removed since, so a quiet daemon costs next to
+ * nothing however many torrents it has.
+ *
+ * A daemon's rows are found by id through its own hash table of list store
+ * iters, which persist, rather than by walking the list, and a row is only
+ * set when something in it changed. Counts and speeds are kept up to date
+ * as rows change rather than summed afresh.
+ *
+ * TCP daemons share a SoupSession owned by the dialog, so connections are
+ * pooled; it isn't the main client's, which may be talking to a Unix domain
+ * socket and is aborted when the profile changes. The main window stays
+ * connected to the current profile as before.
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+
+#include "hig.h"
+#include "protocol-constants.h"
+#include "torrent.h"
+#include "trg-client.h"
+#include "trg-daemons-dialog.h"
+#include "trg-main-window.h"
+#include "trg-prefs.h"
+#include "trg-tree-view.h"
+#include "util.h"
+
+enum {
+    DAEMONCOL_NAME,
+    DAEMONCOL_STATUS,
+    DAEMONCOL_TORRENTS,
+    DAEMONCOL_ACTIVE,
+    DAEMONCOL_DOWNSPEED,
+    DAEMONCOL_UPSPEED,
+    DAEMONCOL_LATENCY,
+    DAEMONCOL_COLUMNS
+};
+
+enum {
+    TORRENTCOL_DAEMON,
+    TORRENTCOL_NAME,
+    TORRENTCOL_STATUS,
+    TORRENTCOL_SIZE,
+    TORRENTCOL_DONE,
+    TORRENTCOL_DOWNSPEED,
+    TORRENTCOL_UPSPEED,
+    TORRENTCOL_RATIO,
+    TORRENTCOL_COLUMNS
+};
+
+enum {
+    PROP_0,
+    PROP_PARENT,
+    PROP_CLIENT
+};
+
+#define TORRENT_FIELDS                                                                           \
+    "[\"" FIELD_ID "\",\"" FIELD_NAME "\",\"" FIELD_STATUS "\",\"" FIELD_SIZEWHENDONE            \
+    "\",\"" FIELD_PERCENTDONE "\",\"" FIELD_RATEDOWNLOAD "\",\"" FIELD_RATEUPLOAD                 \
+    "\",\"" FIELD_UPLOADEDEVER "\",\"" FIELD_DOWNLOADEDEVER "\"]"
+
+/* The same for every poll, so they're never built or serialized. */
+static const gchar full_request[] = "{\"" PARAM_METHOD "\":\"" METHOD_TORRENT_GET
+                                    "\",\"" PARAM_ARGUMENTS "\":{\"" PARAM_FIELDS
+                                    "\":" TORRENT_FIELDS "}}";
+static const gchar update_request[] = "{\"" PARAM_METHOD "\":\"" METHOD_TORRENT_GET
+                                      "\",\"" PARAM_ARGUMENTS "\":{\"" PARAM_IDS
+                                      "\":\"" FIELD_RECENTLY_ACTIVE "\",\"" PARAM_FIELDS
+                                      "\":" TORRENT_FIELDS "}}";
+
+struct _TrgDaemonsDialog {
+    GtkDialog parent;
+
+    TrgMainWindow *parent_win;
+    TrgClient *client;
+    GtkListStore *model;
+    GtkListStore *torrents;
+    GtkWidget *torrentsTv;
+    GtkTreeRowReference *total_rr;
+    GPtrArray *daemons;
+    SoupSession *session; /* shared by the TCP daemons */
+};
+
+typedef struct {
+    gint64 id; /* the key in the daemon's rows */
+    GtkTreeIter iter;
+    gint64 serial;
+    gchar *name;
+    gint64 status;
+    gint64 size;
+    gdouble done;
+    gint64 downSpeed;
+    gint64 upSpeed;
+    gdouble ratio;
+} trg_daemon_torrent;
+
+typedef struct {
+    TrgDaemonsDialog *dlg; /* NULL once the dialog has gone */
+    JsonObject *profile;
+    gchar *name;
+    GUri *url;
+    gchar *username;
+    gchar *password;
+    gboolean sslValidate;
+    gboolean compression;
+    GHashTable *headers;
+    SoupSession *session; /* the dialog's, or one of its own for a socket */
+    gchar *sessionId;
+    GtkTreeRowReference *rr;
+    guint timerTag;
+    SoupMessage *msg; /* while a request is in flight */
+    GCancellable *cancellable;
+    gint64 sent;
+    gboolean connected;
+    gboolean full; /* the request in flight asks for every torrent */
+    gboolean needFull;
+    GHashTable *rows; /* id to trg_daemon_torrent */
+    gint64 serial;
+    gint64 active;
+    gint64 downSpeed;
+    gint64 upSpeed;
+} trg_daemon;
+
+G_DEFINE_TYPE(TrgDaemonsDialog, trg_daemons_dialog, GTK_TYPE_DIALOG)
+
+static GObject *instance = NULL;
+
+static void trg_daemon_send(trg_daemon *daemon);
+
+static void trg_daemon_torrent_free(trg_daemon_torrent *row)
+{
+    g_free(row->name);
+    g_free(row);
+}
+
+/* The rows themselves go with the list store. */
+static void trg_daemon_free(trg_daemon *daemon)
+{
+    g_clear_handle_id(&daemon->timerTag, g_source_remove);
+    g_clear_object(&daemon->msg);
+    g_clear_object(&daemon->cancellable);
+    g_clear_pointer(&daemon->rr, gtk_tree_row_reference_free);
+    g_clear_pointer(&daemon->headers, g_hash_table_unref);
+    g_clear_pointer(&daemon->rows, g_hash_table_unref);
+    g_clear_object(&daemon->session);
+    g_clear_pointer(&daemon->url, g_uri_unref);
+    g_free(daemon->username);
+    g_free(daemon->password);
+    g_free(daemon->sessionId);
+    g_free(daemon->name);
+    json_object_unref(daemon->profile);
+    g_free(daemon);
+}
+
+/* An in-flight request is cancelled, and its callback frees the daemon. */
+static void trg_daemon_close(trg_daemon *daemon)
+{
+    daemon->dlg = NULL;
+    g_clear_handle_id(&daemon->timerTag, g_source_remove);
+
+    if (daemon->msg)
+        g_cancellable_cancel(daemon->cancellable);
+    else
+        trg_daemon_free(daemon);
+}
+
+static void trg_daemons_dialog_get_property(GObject *object, guint property_id, GValue *value,
+                                            GParamSpec *pspec)
+{
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+}
+
+static void trg_daemons_dialog_set_property(GObject *object, guint property_id,
+                                            const GValue *value, GParamSpec *pspec)
+{
+    TrgDaemonsDialog *self = TRG_DAEMONS_DIALOG(object);
+    switch (property_id) {
+    case PROP_PARENT:
+        self->parent_win = g_value_get_object(value);
+        break;
+    case PROP_CLIENT:
+        self->client = g_value_get_pointer(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+static void trg_daemons_response_cb(GtkDialog *dlg, gint res_id, gpointer data G_GNUC_UNUSED)
+{
+    TrgDaemonsDialog *self = TRG_DAEMONS_DIALOG(dlg);
+
+    trg_tree_view_persist(TRG_TREE_VIEW(self->torrentsTv),
+                          TRG_TREE_VIEW_PERSIST_SORT | TRG_TREE_VIEW_PERSIST_LAYOUT);
+
+    gtk_widget_destroy(GTK_WIDGET(dlg));
+}
+
+static void trg_daemons_destroy_cb(GtkWidget *w, gpointer data G_GNUC_UNUSED)
+{
+    TrgDaemonsDialog *dlg = TRG_DAEMONS_DIALOG(w);
+
+    g_clear_pointer(&dlg->daemons, g_ptr_array_unref);
+    g_clear_pointer(&dlg->total_rr, gtk_tree_row_reference_free);
+    g_clear_object(&dlg->session);
+    instance = NULL;
+}
+
+static gboolean get_row(GtkTreeRowReference *rr, GtkTreeIter *iter)
+{
+    GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
+    gboolean valid;
+
+    if (!path)
+        return FALSE;
+
+    valid = gtk_tree_model_get_iter(gtk_tree_row_reference_get_model(rr), iter, path);
+    gtk_tree_path_free(path);
+
+    return valid;
+}
+
+static void set_counts(GtkListStore *model, GtkTreeIter *iter, gint64 torrents, gint64 active,
+                       gint64 downSpeed, gint64 upSpeed)
+{
+    gchar torrentsBuf[32], activeBuf[32], downBuf[32], upBuf[32];
+
+    g_snprintf(torrentsBuf, sizeof(torrentsBuf), "%" G_GINT64_FORMAT, torrents);
+    g_snprintf(activeBuf, sizeof(activeBuf), "%" G_GINT64_FORMAT, active);
+    trg_strlspeed(downBuf, downSpeed / disk_K);
+    trg_strlspeed(upBuf, upSpeed / disk_K);
+
+    gtk_list_store_set(model, iter, DAEMONCOL_TORRENTS, torrentsBuf, DAEMONCOL_ACTIVE, activeBuf,
+                       DAEMONCOL_DOWNSPEED, downBuf, DAEMONCOL_UPSPEED, upBuf, -1);
+}
+
+/* Totals are over the daemons which answered their last poll. */
+static void update_totals(TrgDaemonsDialog *dlg)
+{
+    gint64 torrents = 0, active = 0, downSpeed = 0, upSpeed = 0;
+    gchar status[64];
+    guint connected = 0;
+    GtkTreeIter iter;
+    guint i;
+
+    for (i = 0; i < dlg->daemons->len; i++) {
+        trg_daemon *daemon = g_ptr_array_index(dlg->daemons, i);
+        if (daemon->connected) {
+            connected++;
+            torrents += g_hash_table_size(daemon->rows);
+            active += daemon->active;
+            downSpeed += daemon->downSpeed;
+            upSpeed += daemon->upSpeed;
+        }
+    }
+
+    if (!dlg->total_rr || !get_row(dlg->total_rr, &iter))
+        return;
+
+    g_snprintf(status, sizeof(status), _("%u of %u connected"), connected, dlg->daemons->len);
+    gtk_list_store_set(dlg->model, &iter, DAEMONCOL_STATUS, status, -1);
+    set_counts(dlg->model, &iter, torrents, active, downSpeed, upSpeed);
+}
+
+static void trg_daemon_update(trg_daemon *daemon, const gchar *status, gint64 latency)
+{
+    TrgDaemonsDialog *dlg = daemon->dlg;
+    GtkTreeIter iter;
+    gchar latencyBuf[32];
+
+    if (!get_row(daemon->rr, &iter))
+        return;
+
+    gtk_list_store_set(dlg->model, &iter, DAEMONCOL_STATUS, status, -1);
+
+    if (daemon->connected) {
+        g_snprintf(latencyBuf, sizeof(latencyBuf), _("%.0f ms"), latency / 1000.0);
+        gtk_list_store_set(dlg->model, &iter, DAEMONCOL_LATENCY, latencyBuf, -1);
+        set_counts(dlg->model, &iter, g_hash_table_size(daemon->rows), daemon->active,
+                   daemon->downSpeed, daemon->upSpeed);
+    } else {
+        gtk_list_store_set(dlg->model, &iter, DAEMONCOL_TORRENTS, NULL, DAEMONCOL_ACTIVE, NULL,
+                           DAEMONCOL_DOWNSPEED, NULL, DAEMONCOL_UPSPEED, NULL,
+                           DAEMONCOL_LATENCY, NULL, -1);
+    }
+
+    update_totals(dlg);
+}
+
+static void trg_daemon_forget_torrent(trg_daemon *daemon, trg_daemon_torrent *row)
+{
+    gtk_list_store_remove(daemon->dlg->torrents, &row->iter);
+
+    if (row->status != TR_STATUS_STOPPED)
+        daemon->active--;
+
+    daemon->downSpeed -= row->downSpeed;
+    daemon->upSpeed -= row->upSpeed;
+}
+
+/* Only what's reachable is listed; the next answer brings it all back. */
+static void trg_daemon_failed(trg_daemon *daemon, const gchar *status)
+{
+    GHashTableIter hti;
+    gpointer row;
+
+    daemon->connected = FALSE;
+    daemon->needFull = TRUE;
+
+    if (daemon->rows) {
+        g_hash_table_iter_init(&hti, daemon->rows);
+        while (g_hash_table_iter_next(&hti, NULL, &row)) {
+            trg_daemon_forget_torrent(daemon, row);
+            g_hash_table_iter_remove(&hti);
+        }
+    }
+
+    trg_daemon_update(daemon, status, 0);
+}
+
+static GValue *torrent_column(gint *columns, GValue *values, gint *n, gint column, GType type)
+{
+    columns[*n] = column;
+    return g_value_init(&values[(*n)++], type);
+}
+
+/*
+ * Only the columns which changed are set, in one call, so an unchanged
+ * torrent costs nothing and a changed one a single row-changed. Status
+ * codes are read as RPC 14 and later (Transmission 2.40), as torrent-get
+ * doesn't say which version it's speaking.
+ */
+static void trg_daemon_set_torrent(trg_daemon *daemon, trg_daemon_torrent *row, JsonObject *t,
+                                   gboolean added)
+{
+    GtkListStore *store = daemon->dlg->torrents;
+    const gchar *name = torrent_get_name(t);
+    gint64 status = torrent_get_status(t);
+    gint64 size = torrent_get_size_when_done(t);
+    gdouble done = torrent_get_percent_done(t);
+    gint64 downSpeed = torrent_get_rate_down(t);
+    gint64 upSpeed = torrent_get_rate_up(t);
+    gint64 uploaded = torrent_get_uploaded(t);
+    gint64 downloaded = torrent_get_downloaded(t);
+    gdouble ratio = uploaded > 0 && downloaded > 0 ? (gdouble)uploaded / (gdouble)downloaded : 0;
+    gint columns[TORRENTCOL_COLUMNS];
+    GValue values[TORRENTCOL_COLUMNS] = { G_VALUE_INIT };
+    gint i, n = 0;
+
+    if (added)
+        g_value_set_string(
+            torrent_column(columns, values, &n, TORRENTCOL_DAEMON, G_TYPE_STRING), daemon->name);
+
+    if (g_strcmp0(name, row->name)) {
+        g_free(row->name);
+        row->name = g_strdup(name);
+        g_value_set_string(torrent_column(columns, values, &n, TORRENTCOL_NAME, G_TYPE_STRING),
+                           name);
+    }
+
+    if (added || status != row->status) {
+        if (!added && row->status != TR_STATUS_STOPPED)
+            daemon->active--;
+        if (status != TR_STATUS_STOPPED)
+            daemon->active++;
+
+        row->status = status;
+        g_value_take_string(
+            torrent_column(columns, values, &n, TORRENTCOL_STATUS, G_TYPE_STRING),
+            torrent_get_status_string(NEW_STATUS_RPC_VERSION, status, 0));
+    }
+
+    if (added || size != row->size) {
+        row->size = size;
+        g_value_set_int64(torrent_column(columns, values, &n, TORRENTCOL_SIZE, G_TYPE_INT64),
+                          size);
+    }
+
+    if (added || done != row->done) {
+        row->done = done;
+        g_value_set_double(torrent_column(columns, values, &n, TORRENTCOL_DONE, G_TYPE_DOUBLE),
+                           done);
+    }
+
+    if (added || downSpeed != row->downSpeed) {
+        daemon->downSpeed += downSpeed - row->downSpeed;
+        row->downSpeed = downSpeed;
+        g_value_set_int64(
+            torrent_column(columns, values, &n, TORRENTCOL_DOWNSPEED, G_TYPE_INT64), downSpeed);
+    }
+
+    if (added || upSpeed != row->upSpeed) {
+        daemon->upSpeed += upSpeed - row->upSpeed;
+        row->upSpeed = upSpeed;
+        g_value_set_int64(torrent_column(columns, values, &n, TORRENTCOL_UPSPEED, G_TYPE_INT64),
+                          upSpeed);
+    }
+
+    if (added || ratio != row->ratio) {
+        row->ratio = ratio;
+        g_value_set_double(torrent_column(columns, values, &n, TORRENTCOL_RATIO, G_TYPE_DOUBLE),
+                           ratio);
+    }
+
+    if (added)
+        gtk_list_store_insert_with_valuesv(store, &row->iter, -1, columns, values, n);
+    else if (n > 0)
+        gtk_list_store_set_valuesv(store, &row->iter, columns, values, n);
+
+    for (i = 0; i < n; i++)
+        g_value_unset(&values[i]);
+}
+
+static void trg_daemon_merge_torrent(trg_daemon *daemon, JsonObject *t)
+{
+    gint64 id = torrent_get_id(t);
+    trg_daemon_torrent *row = g_hash_table_lookup(daemon->rows, &id);
+    gboolean added = !row;
+
+    if (added) {
+        row = g_new0(trg_daemon_torrent, 1);
+        row->id = id;
+        g_hash_table_insert(daemon->rows, &row->id, row);
+    }
+
+    row->serial = daemon->serial;
+    trg_daemon_set_torrent(daemon, row, t, added);
+}
+
+/* A full answer lists everything, so whatever it didn't touch has gone. */
+static void trg_daemon_remove_stale(trg_daemon *daemon)
+{
+    GHashTableIter hti;
+    gpointer value;
+
+    g_hash_table_iter_init(&hti, daemon->rows);
+    while (g_hash_table_iter_next(&hti, NULL, &value)) {
+        trg_daemon_torrent *row = value;
+        if (row->serial != daemon->serial) {
+            trg_daemon_forget_torrent(daemon, row);
+            g_hash_table_iter_remove(&hti);
+        }
+    }
+}
+
+static void trg_daemon_remove_torrents(trg_daemon *daemon, JsonArray *removed)
+{
+    guint i;
+
+    for (i = 0; i < json_array_get_length(removed); i++) {
+        gint64 id = json_array_get_int_element(removed, i);
+        trg_daemon_torrent *row = g_hash_table_lookup(daemon->rows, &id);
+        if (row) {
+            trg_daemon_forget_torrent(daemon, row);
+            g_hash_table_remove(daemon->rows, &id);
+        }
+    }
+}
+
+static gboolean trg_daemon_parse(trg_daemon *daemon, GBytes *bytes)
+{
+    g_autoptr(JsonParser) parser = json_parser_new();
+    JsonObject *obj, *args;
+    JsonArray *torrents, *removed;
+    gconstpointer data;
+    gsize len;
+    guint i;
+
+    data = g_bytes_get_data(bytes, &len);
+    if (!json_parser_load_from_data(parser, data, len, NULL))
+        return FALSE;
+
+    if (!JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser)))
+        return FALSE;
+
+    obj = json_node_get_object(json_parser_get_root(parser));
+    if (!json_object_has_member(obj, FIELD_RESULT)
+        || g_strcmp0(json_object_get_string_member(obj, FIELD_RESULT), FIELD_SUCCESS)
+        || !json_object_has_member(obj, PARAM_ARGUMENTS))
+        return FALSE;
+
+    args = json_object_get_object_member(obj, PARAM_ARGUMENTS);
+    if (!args || !json_object_has_member(args, FIELD_TORRENTS))
+        return FALSE;
+
+    torrents = json_object_get_array_member(args, FIELD_TORRENTS);
+    if (!torrents)
+        return FALSE;
+
+    daemon->serial++;
+
+    for (i = 0; i < json_array_get_length(torrents); i++) {
+        JsonNode *node = json_array_get_element(torrents, i);
+        if (JSON_NODE_HOLDS_OBJECT(node))
+            trg_daemon_merge_torrent(daemon, json_node_get_object(node));
+    }
+
+    if (daemon->full)
+        trg_daemon_remove_stale(daemon);
+    else if ((removed = get_torrents_removed(args)))
+        trg_daemon_remove_torrents(daemon, removed);
+
+    daemon->needFull = FALSE;
+
+    return TRUE;
+}
+
+static void trg_daemon_callback(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    trg_daemon *daemon = user_data;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    g_autoptr(SoupMessage) msg = g_steal_pointer(&daemon->msg);
+    const gchar *sessionId;
+    guint status;
+
+    bytes = soup_session_send_and_read_finish(SOUP_SESSION(source), result, &error);
+
+    if (!daemon->dlg) {
+        trg_daemon_free(daemon);
+        return;
+    }
+
+    if (error) {
+        trg_daemon_failed(daemon, error->message);
+        return;
+    }
+
+    status = soup_message_get_status(msg);
+
+    if (status == SOUP_STATUS_CONFLICT) {
+        sessionId = soup_message_headers_get_one(soup_message_get_response_headers(msg),
+                                                 TRANSMISSION_SESSION_ID_HEADER);
+        if (!sessionId || !g_strcmp0(sessionId, daemon->sessionId)) {
+            trg_daemon_failed(daemon, _("Not a Transmission daemon"));
+        } else {
+            /* A new id for a known daemon means it restarted, and may reuse ids. */
+            if (daemon->sessionId)
+                daemon->needFull = TRUE;
+
+            g_free(daemon->sessionId);
+            daemon->sessionId = g_strdup(sessionId);
+            trg_daemon_send(daemon);
+        }
+    } else if (status != SOUP_STATUS_OK) {
+        trg_daemon_failed(daemon, soup_message_get_reason_phrase(msg));
+    } else if (!trg_daemon_parse(daemon, bytes)) {
+        trg_daemon_failed(daemon, _("Invalid response"));
+    } else {
+        daemon->connected = TRUE;
+        trg_daemon_update(daemon, _("Connected"), g_get_monotonic_time() - daemon->sent);
+    }
+}
+
+static gboolean trg_daemon_tls_cb(SoupMessage *msg G_GNUC_UNUSED,
+                                  GTlsCertificate *cert G_GNUC_UNUSED,
+                                  GTlsCertificateFlags errors G_GNUC_UNUSED, gpointer user_data)
+{
+    trg_daemon *daemon = user_data;
+    return !daemon->sslValidate;
+}
+
+static gboolean trg_daemon_auth_cb(SoupMessage *msg G_GNUC_UNUSED, SoupAuth *auth, gboolean retry,
+                                   gpointer user_data)
+{
+    trg_daemon *daemon = user_data;
+
+    if (retry)
+        return FALSE;
+
+    soup_auth_authenticate(auth, daemon->username, daemon->password);
+
+    return TRUE;
+}
+
+static void trg_daemon_send(trg_daemon *daemon)
+{
+    g_autoptr(GBytes) body = NULL;
+    SoupMessageHeaders *headers;
+
+    daemon->full = daemon->needFull;
+    body = daemon->full ? g_bytes_new_static(full_request, sizeof(full_request) - 1)
+                        : g_bytes_new_static(update_request, sizeof(update_request) - 1);
+
+    daemon->msg = soup_message_new_from_uri(SOUP_METHOD_POST, daemon->url);
+    headers = soup_message_get_request_headers(daemon->msg);
+
+    if (!daemon->compression)
+        soup_message_disable_feature(daemon->msg, SOUP_TYPE_CONTENT_DECODER);
+
+    if (daemon->headers)
+        g_hash_table_foreach(daemon->headers, trg_client_inject_custom_header, headers);
+
+    if (daemon->sessionId)
+        soup_message_headers_replace(headers, TRANSMISSION_SESSION_ID_HEADER, daemon->sessionId);
+
+    g_signal_connect(daemon->msg, "accept-certificate", G_CALLBACK(trg_daemon_tls_cb), daemon);
+    g_signal_connect(daemon->msg, "authenticate", G_CALLBACK(trg_daemon_auth_cb), daemon);
+    soup_message_set_request_body_from_bytes(daemon->msg, "application/json", body);
+
+    g_clear_object(&daemon->cancellable);
+    daemon->cancellable = g_cancellable_new();
+    daemon->sent = g_get_monotonic_time();
+
+    soup_session_send_and_read_async(daemon->session, daemon->msg, G_PRIORITY_DEFAULT,
+                                     daemon->cancellable, trg_daemon_callback, daemon);
+}
+
+/* A daemon slower to answer than its interval just misses a tick. */
+static gboolean trg_daemon_timerfunc(gpointer data)
+{
+    trg_daemon *daemon = data;
+
+    if (!daemon->msg)
+        trg_daemon_send(daemon);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static JsonNode *profile_value(TrgDaemonsDialog *dlg, JsonObject *profile, const gchar *key)
+{
+    return trg_prefs_get_profile_value(trg_client_get_prefs(dlg->client), profile, key);
+}
+
+static gchar *profile_string(TrgDaemonsDialog *dlg, JsonObject *profile, const gchar *key)
+{
+    JsonNode *node = profile_value(dlg, profile, key);
+    return node ? g_strdup(json_node_get_string(node)) : NULL;
+}
+
+static gint64 profile_int(TrgDaemonsDialog *dlg, JsonObject *profile, const gchar *key)
+{
+    JsonNode *node = profile_value(dlg, profile, key);
+    return node ? json_node_get_int(node) : 0;
+}
+
+static gboolean profile_bool(TrgDaemonsDialog *dlg, JsonObject *profile, const gchar *key)
+{
+    JsonNode *node = profile_value(dlg, profile, key);
+    return node ? json_node_get_boolean(node) : FALSE;
+}
+
+static void trg_daemons_add(TrgDaemonsDialog *dlg, JsonObject *profile)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(dlg->model);
+    g_autofree gchar *name = profile_string(dlg, profile, TRG_PREFS_KEY_PROFILE_NAME);
+    g_autofree gchar *host = profile_string(dlg, profile, TRG_PREFS_KEY_HOSTNAME);
+    g_autofree gchar *path = profile_string(dlg, profile, TRG_PREFS_KEY_RPC_URL_PATH);
+    g_autofree gchar *uri = NULL;
+    trg_daemon *daemon = g_new0(trg_daemon, 1);
+    JsonNode *headers;
+    GtkTreePath *treePath;
+    GtkTreeIter iter;
+    gboolean ssl;
+    gint64 interval;
+
+    daemon->dlg = dlg;
+    daemon->profile = json_object_ref(profile);
+    daemon->name = g_strdup(name ? name : host);
+    daemon->needFull = TRUE;
+    daemon->rows = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                         (GDestroyNotify)trg_daemon_torrent_free);
+
+    gtk_list_store_insert_with_values(dlg->model, &iter, -1, DAEMONCOL_NAME, daemon->name, -1);
+    treePath = gtk_tree_model_get_path(model, &iter);
+    daemon->rr = gtk_tree_row_reference_new(model, treePath);
+    gtk_tree_path_free(treePath);
+
+    g_ptr_array_add(dlg->daemons, daemon);
+
+    if (!host || !*host) {
+        trg_daemon_failed(daemon, _("Bad hostname."));
+        return;
+    }
+
+    ssl = profile_bool(dlg, profile, TRG_PREFS_KEY_SSL);
+
+    if (g_str_has_prefix(host, UNIX_SOCKET_PREFIX)) {
+#ifdef G_OS_UNIX
+        if (!host[strlen(UNIX_SOCKET_PREFIX)]) {
+            trg_daemon_failed(daemon, _("Bad socket path."));
+            return;
+        }
+
+        daemon->session = trg_client_session_new(host + strlen(UNIX_SOCKET_PREFIX));
+        uri = g_strdup_printf("%s://localhost%s", HTTP_URI_PREFIX, path ? path : "");
+#else
+        trg_daemon_failed(daemon, _("Unix domain sockets aren't supported on this platform."));
+        return;
+#endif
+    } else {
+        daemon->session = g_object_ref(dlg->session);
+        uri = g_strdup_printf("%s://%s:%d%s", ssl ? HTTPS_URI_PREFIX : HTTP_URI_PREFIX, host,
+                              (gint)profile_int(dlg, profile, TRG_PREFS_KEY_PORT),
+                              path ? path : "");
+    }
+    daemon->url = g_uri_parse(uri, G_URI_FLAGS_NONE, NULL);
+    if (!daemon->url) {
+        trg_daemon_failed(daemon, _("Bad URL."));
+        return;
+    }
+
+    daemon->sslValidate = profile_bool(dlg, profile, TRG_PREFS_KEY_SSL_VALIDATE);
+    daemon->compression = profile_bool(dlg, profile, TRG_PREFS_KEY_COMPRESSION);
+    daemon->username = profile_string(dlg, profile, TRG_PREFS_KEY_USERNAME);
+    daemon->password = profile_string(dlg, profile, TRG_PREFS_KEY_PASSWORD);
+
+    headers = profile_value(dlg, profile, TRG_PREFS_KEY_CUSTOM_HEADERS);
+    if (headers && JSON_NODE_HOLDS_ARRAY(headers))
+        daemon->headers = trg_client_headers_array_to_table(json_node_get_array(headers));
+
+    interval = profile_int(dlg, profile, TRG_PREFS_KEY_UPDATE_INTERVAL);
+    if (interval < 1)
+        interval = TRG_INTERVAL_DEFAULT;
+
+    gtk_list_store_set(dlg->model, &iter, DAEMONCOL_STATUS, _("Connecting..."), -1);
+
+    trg_daemon_send(daemon);
+    daemon->timerTag = g_timeout_add_seconds(interval, trg_daemon_timerfunc, daemon);
+}
+
+static void trg_daemons_add_column(GtkTreeView *tv, gint index, gchar *title, gint width)
+{
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column
+        = gtk_tree_view_column_new_with_attributes(title, renderer, "text", index, NULL);
+
+    if (index != DAEMONCOL_NAME && index != DAEMONCOL_STATUS)
+        g_object_set(renderer, "xalign", 1.0, NULL);
+    else
+        g_object_set(renderer, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+
+    gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(column, width);
+    gtk_tree_view_column_set_resizable(column, TRUE);
+
+    gtk_tree_view_append_column(tv, column);
+}
+
+static GtkWidget *trg_daemons_torrents_view(TrgDaemonsDialog *dlg)
+{
+    GObject *obj = g_object_new(TRG_TYPE_TREE_VIEW, "config-id", "TrgDaemonsTorrentsTreeView",
+                                "prefs", trg_client_get_prefs(dlg->client), NULL);
+    TrgTreeView *ttv = TRG_TREE_VIEW(obj);
+
+    gtk_widget_set_sensitive(GTK_WIDGET(obj), TRUE);
+
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_TEXT, TORRENTCOL_DAEMON, _("Daemon"), "daemon", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_TEXT, TORRENTCOL_NAME, _("Name"), "name", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_TEXT, TORRENTCOL_STATUS, _("Status"), "status", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_SIZE, TORRENTCOL_SIZE, _("Size"), "size", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_PROG, TORRENTCOL_DONE, _("Done"), "done", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_SPEED, TORRENTCOL_DOWNSPEED, _("Down Speed"),
+                             "down-speed", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_SPEED, TORRENTCOL_UPSPEED, _("Up Speed"),
+                             "up-speed", 0);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_RATIO, TORRENTCOL_RATIO, _("Ratio"), "ratio", 0);
+
+    gtk_tree_view_set_search_column(GTK_TREE_VIEW(obj), TORRENTCOL_NAME);
+
+    gtk_tree_view_set_model(GTK_TREE_VIEW(obj), GTK_TREE_MODEL(dlg->torrents));
+    g_object_unref(dlg->torrents);
+    trg_tree_view_restore_sort(ttv, 0x00);
+    trg_tree_view_setup_columns(ttv);
+
+    return GTK_WIDGET(obj);
+}
+
+static GtkWidget *trg_daemons_scrolled(GtkWidget *tv)
+{
+    GtkWidget *sw = gtk_scrolled_window_new(NULL, NULL);
+
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(sw), GTK_POLICY_AUTOMATIC,
+                                   GTK_POLICY_AUTOMATIC);
+    gtk_container_add(GTK_CONTAINER(sw), tv);
+    gtk_container_set_border_width(GTK_CONTAINER(sw), GUI_PAD);
+
+    return sw;
+}
+
+static GObject *trg_daemons_dialog_constructor(GType type, guint n_construct_properties,
+                                               GObjectConstructParam *construct_params)
+{
+    GtkWidget *tv, *paned;
+    GObject *obj = G_OBJECT_CLASS(trg_daemons_dialog_parent_class)
+                       ->constructor(type, n_construct_properties, construct_params);
+    TrgDaemonsDialog *dlg = TRG_DAEMONS_DIALOG(obj);
+    JsonArray *profiles = trg_prefs_get_profiles(trg_client_get_prefs(dlg->client));
+    GtkTreeModel *model;
+    GtkTreePath *path;
+    GtkTreeIter iter;
+    guint i;
+
+    gtk_window_set_title(GTK_WINDOW(obj), _("Daemons"));
+    gtk_window_set_transient_for(GTK_WINDOW(obj), GTK_WINDOW(dlg->parent_win));
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(obj), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(obj), 900, 600);
+    gtk_dialog_add_button(GTK_DIALOG(obj), _("_Close"), GTK_RESPONSE_CLOSE);
+
+    gtk_container_set_border_width(GTK_CONTAINER(obj), GUI_PAD);
+
+    gtk_dialog_set_default_response(GTK_DIALOG(obj), GTK_RESPONSE_CLOSE);
+
+    g_signal_connect(G_OBJECT(obj), "response", G_CALLBACK(trg_daemons_response_cb), NULL);
+    g_signal_connect(G_OBJECT(obj), "destroy", G_CALLBACK(trg_daemons_destroy_cb), NULL);
+
+    dlg->model = gtk_list_store_new(DAEMONCOL_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                                    G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+    model = GTK_TREE_MODEL(dlg->model);
+    dlg->torrents = gtk_list_store_new(TORRENTCOL_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
+                                       G_TYPE_STRING, G_TYPE_INT64, G_TYPE_DOUBLE, G_TYPE_INT64,
+                                       G_TYPE_INT64, G_TYPE_DOUBLE);
+    dlg->torrentsTv = trg_daemons_torrents_view(dlg);
+    dlg->daemons = g_ptr_array_new_with_free_func((GDestroyNotify)trg_daemon_close);
+    dlg->session = trg_client_session_new(NULL);
+
+    tv = trg_tree_view_new();
+    gtk_widget_set_sensitive(tv, TRUE);
+
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_NAME, _("Daemon"), 160);
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_STATUS, _("Status"), 160);
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_TORRENTS, _("Torrents"), 70);
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_ACTIVE, _("Active"), 70);
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_DOWNSPEED, _("Down Speed"), 90);
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_UPSPEED, _("Up Speed"), 90);
+    trg_daemons_add_column(GTK_TREE_VIEW(tv), DAEMONCOL_LATENCY, _("Latency"), 70);
+
+    gtk_tree_view_set_model(GTK_TREE_VIEW(tv), model);
+    g_object_unref(dlg->model);
+
+    for (i = 0; profiles && i < json_array_get_length(profiles); i++)
+        trg_daemons_add(dlg, json_array_get_object_element(profiles, i));
+
+    gtk_list_store_insert_with_values(dlg->model, &iter, -1, DAEMONCOL_NAME, _("Total"), -1);
+    path = gtk_tree_model_get_path(model, &iter);
+    dlg->total_rr = gtk_tree_row_reference_new(model, path);
+    gtk_tree_path_free(path);
+
+    update_totals(dlg);
+
+    paned = gtk_paned_new(GTK_ORIENTATION_VERTICAL);
+    gtk_paned_pack1(GTK_PANED(paned), trg_daemons_scrolled(tv), FALSE, FALSE);
+    gtk_paned_pack2(GTK_PANED(paned), trg_daemons_scrolled(dlg->torrentsTv), TRUE, FALSE);
+    gtk_paned_set_position(GTK_PANED(paned), 180);
+    gtk_box_pack_start(GTK_BOX(gtk_bin_get_child(GTK_BIN(obj))), paned, TRUE, TRUE, 0);
+
+    return obj;
+}
+
+static void trg_daemons_dialog_class_init(TrgDaemonsDialogClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    object_class->get_property = trg_daemons_dialog_get_property;
+    object_class->set_property = trg_daemons_dialog_set_property;
+    object_class->constructor = trg_daemons_dialog_constructor;
+
+    g_object_class_install_property(
+        object_class, PROP_PARENT,
+        g_param_spec_object("parent-window", "Parent window", "Parent window", TRG_TYPE_MAIN_WINDOW,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_NAME
+                                | G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+
+    g_object_class_install_property(
+        object_class, PROP_CLIENT,
+        g_param_spec_pointer("trg-client", "TClient", "Client",
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_NAME
+                                 | G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+}
+
+static void trg_daemons_dialog_init(TrgDaemonsDialog *self)
+{
+}
+
+TrgDaemonsDialog *trg_daemons_dialog_get_instance(TrgMainWindow *parent, TrgClient *client)
+{
+    if (instance == NULL)
+        instance = g_object_new(TRG_TYPE_DAEMONS_DIALOG, "parent-window", parent, "trg-client",
+                                client, NULL);
+
+    return TRG_DAEMONS_DIALOG(instance);
+}
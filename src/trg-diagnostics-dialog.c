@@ -0,0 +1,413 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+
+#include "hig.h"
+#include "trg-diagnostics-dialog.h"
+#include "trg-diagnostics.h"
+#include "trg-main-window.h"
+#include "trg-memory.h"
+#include "trg-tree-view.h"
+#include "util.h"
+
+enum {
+    DIAGCOL_NAME,
+    DIAGCOL_REQUESTS,
+    DIAGCOL_P50,
+    DIAGCOL_P95,
+    DIAGCOL_P99,
+    DIAGCOL_BYTES,
+    DIAGCOL_RATIO,
+    DIAGCOL_TORRENTS,
+    DIAGCOL_ROWS_CHANGED,
+    DIAGCOL_COLUMNS
+};
+
+enum {
+    MEMCOL_NAME,
+    MEMCOL_COUNT,
+    MEMCOL_BYTES,
+    MEMCOL_COLUMNS
+};
+
+enum {
+    PROP_0,
+    PROP_PARENT
+};
+
+#define DIAGNOSTICS_UPDATE_INTERVAL 2
+
+struct _TrgDiagnosticsDialog {
+    GtkDialog parent;
+
+    TrgMainWindow *parent_win;
+    guint update_timer_tag;
+    GtkTreeStore *model;
+    /* interned method name -> GtkTreeRowReference of its row */
+    GHashTable *methods;
+    /* a row per trg_memory_subsystem, then the total */
+    GtkListStore *memory;
+    GtkWidget *notebook;
+    gint memoryPage;
+};
+
+G_DEFINE_TYPE(TrgDiagnosticsDialog, trg_diagnostics_dialog, GTK_TYPE_DIALOG)
+
+static GObject *instance = NULL;
+
+/* The phase ending at each timing point, shown under each method. */
+static const gchar *const phase_names[TRG_TIMING_COUNT] = {
+    [TRG_TIMING_SERIALIZED] = N_("Serialize"),
+    [TRG_TIMING_SENT] = N_("Queue"),
+    [TRG_TIMING_HEADERS] = N_("Wait for daemon"),
+    [TRG_TIMING_RECEIVED] = N_("Download"),
+    [TRG_TIMING_VALIDATED] = N_("Validate UTF-8"),
+    [TRG_TIMING_PARSED] = N_("Parse JSON"),
+    [TRG_TIMING_CALLBACK] = N_("Dispatch"),
+    [TRG_TIMING_UPDATED] = N_("Update model"),
+    [TRG_TIMING_REFRESHED] = N_("Refresh views"),
+};
+
+static void trg_diagnostics_dialog_get_property(GObject *object, guint property_id,
+                                                GValue *value, GParamSpec *pspec)
+{
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+}
+
+static void trg_diagnostics_dialog_set_property(GObject *object, guint property_id,
+                                                const GValue *value, GParamSpec *pspec)
+{
+    TrgDiagnosticsDialog *self = TRG_DIAGNOSTICS_DIALOG(object);
+    switch (property_id) {
+    case PROP_PARENT:
+        self->parent_win = g_value_get_object(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+static void trg_diagnostics_response_cb(GtkDialog *dlg, gint res_id, gpointer data G_GNUC_UNUSED)
+{
+    gtk_widget_destroy(GTK_WIDGET(dlg));
+}
+
+/* Also reached when the main window goes, taking this with it. */
+static void trg_diagnostics_destroy_cb(GtkWidget *w, gpointer data G_GNUC_UNUSED)
+{
+    TrgDiagnosticsDialog *dlg = TRG_DIAGNOSTICS_DIALOG(w);
+    g_clear_handle_id(&dlg->update_timer_tag, g_source_remove);
+    g_clear_pointer(&dlg->methods, g_hash_table_destroy);
+    instance = NULL;
+}
+
+static void format_usec(gchar *buf, gsize len, gint64 usec)
+{
+    if (usec < 0)
+        buf[0] = '\0';
+    else if (usec < 1000)
+        g_snprintf(buf, len, _("%d µs"), (gint)usec);
+    else if (usec < 10 * G_USEC_PER_SEC)
+        g_snprintf(buf, len, _("%.1f ms"), usec / 1000.0);
+    else
+        g_snprintf(buf, len, _("%.2f s"), (gdouble)usec / G_USEC_PER_SEC);
+}
+
+static void update_percentiles(GtkTreeStore *model, GtkTreeIter *iter,
+                               const gint64 percentiles[TRG_PERCENTILE_COUNT])
+{
+    gchar p50[32], p95[32], p99[32];
+
+    format_usec(p50, sizeof(p50), percentiles[TRG_PERCENTILE_50]);
+    format_usec(p95, sizeof(p95), percentiles[TRG_PERCENTILE_95]);
+    format_usec(p99, sizeof(p99), percentiles[TRG_PERCENTILE_99]);
+
+    gtk_tree_store_set(model, iter, DIAGCOL_P50, p50, DIAGCOL_P95, p95, DIAGCOL_P99, p99, -1);
+}
+
+static GtkTreeRowReference *add_method(TrgDiagnosticsDialog *dlg, const gchar *method)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(dlg->model);
+    GtkTreeRowReference *rr;
+    GtkTreePath *path;
+    GtkTreeIter iter, child;
+    guint i;
+
+    gtk_tree_store_append(dlg->model, &iter, NULL);
+    gtk_tree_store_set(dlg->model, &iter, DIAGCOL_NAME, method, -1);
+
+    for (i = TRG_TIMING_DISPATCHED + 1; i < TRG_TIMING_COUNT; i++) {
+        gtk_tree_store_append(dlg->model, &child, &iter);
+        gtk_tree_store_set(dlg->model, &child, DIAGCOL_NAME, _(phase_names[i]), -1);
+    }
+
+    path = gtk_tree_model_get_path(model, &iter);
+    rr = gtk_tree_row_reference_new(model, path);
+    gtk_tree_path_free(path);
+
+    g_hash_table_insert(dlg->methods, (gpointer)method, rr);
+
+    return rr;
+}
+
+static void update_method(TrgDiagnosticsDialog *dlg, const trg_diagnostics_summary *summary)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(dlg->model);
+    GtkTreeRowReference *rr = g_hash_table_lookup(dlg->methods, summary->method);
+    GtkTreePath *path;
+    GtkTreeIter iter, child;
+    gchar requests[32], bytes[32], ratio[32], torrents[32], rows[32];
+    guint i;
+
+    if (!rr)
+        rr = add_method(dlg, summary->method);
+
+    path = gtk_tree_row_reference_get_path(rr);
+    gtk_tree_model_get_iter(model, &iter, path);
+    gtk_tree_path_free(path);
+
+    g_snprintf(requests, sizeof(requests), "%" G_GUINT64_FORMAT, summary->requests);
+    trg_strlsize(bytes, summary->wireBytes);
+
+    if (summary->wireBytes > 0 && summary->wireBytes < summary->bytes)
+        g_snprintf(ratio, sizeof(ratio), "%.1f×", (gdouble)summary->bytes / summary->wireBytes);
+    else
+        ratio[0] = '\0';
+
+    if (summary->updates > 0) {
+        g_snprintf(torrents, sizeof(torrents), "%.1f",
+                   (gdouble)summary->torrents / summary->updates);
+        g_snprintf(rows, sizeof(rows), "%.1f", (gdouble)summary->rowsChanged / summary->updates);
+    } else {
+        torrents[0] = rows[0] = '\0';
+    }
+
+    gtk_tree_store_set(dlg->model, &iter, DIAGCOL_REQUESTS, requests, DIAGCOL_BYTES, bytes,
+                       DIAGCOL_RATIO, ratio, DIAGCOL_TORRENTS, torrents, DIAGCOL_ROWS_CHANGED,
+                       rows, -1);
+    update_percentiles(dlg->model, &iter, summary->percentiles[TRG_TIMING_DISPATCHED]);
+
+    for (i = TRG_TIMING_DISPATCHED + 1; i < TRG_TIMING_COUNT; i++)
+        if (gtk_tree_model_iter_nth_child(model, &child, &iter, i - 1))
+            update_percentiles(dlg->model, &child, summary->percentiles[i]);
+}
+
+static void update_memory(TrgDiagnosticsDialog *dlg)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(dlg->memory);
+    trg_memory_usage usage[TRG_MEMORY_COUNT];
+    guint64 total = 0;
+    gchar count[32], bytes[32];
+    GtkTreeIter iter;
+    guint i;
+
+    trg_memory_snapshot(usage);
+
+    for (i = 0; i < TRG_MEMORY_COUNT; i++) {
+        if (!gtk_tree_model_iter_nth_child(model, &iter, NULL, i))
+            return;
+
+        g_snprintf(count, sizeof(count), "%" G_GUINT64_FORMAT, usage[i].count);
+        trg_strlsize(bytes, usage[i].bytes);
+        gtk_list_store_set(dlg->memory, &iter, MEMCOL_COUNT, count, MEMCOL_BYTES, bytes, -1);
+
+        total += usage[i].bytes;
+    }
+
+    if (gtk_tree_model_iter_nth_child(model, &iter, NULL, TRG_MEMORY_COUNT)) {
+        trg_strlsize(bytes, total);
+        gtk_list_store_set(dlg->memory, &iter, MEMCOL_BYTES, bytes, -1);
+    }
+}
+
+static gboolean trg_diagnostics_update_timerfunc(gpointer data)
+{
+    TrgDiagnosticsDialog *dlg = TRG_DIAGNOSTICS_DIALOG(data);
+    GPtrArray *summaries = trg_diagnostics_get_summaries();
+    guint i;
+
+    for (i = 0; i < summaries->len; i++)
+        update_method(dlg, g_ptr_array_index(summaries, i));
+
+    g_ptr_array_unref(summaries);
+
+    /* A snapshot walks every torrent's JSON and every file and peer row,
+     * so only take one while it's being looked at. */
+    if (gtk_notebook_get_current_page(GTK_NOTEBOOK(dlg->notebook)) == dlg->memoryPage)
+        update_memory(dlg);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void trg_diagnostics_switch_page_cb(GtkNotebook *notebook G_GNUC_UNUSED,
+                                           GtkWidget *page G_GNUC_UNUSED, guint page_num,
+                                           gpointer data)
+{
+    TrgDiagnosticsDialog *dlg = TRG_DIAGNOSTICS_DIALOG(data);
+
+    if ((gint)page_num == dlg->memoryPage)
+        update_memory(dlg);
+}
+
+static void trg_diagnostics_add_column(GtkTreeView *tv, gint index, gchar *title, gint width)
+{
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column
+        = gtk_tree_view_column_new_with_attributes(title, renderer, "text", index, NULL);
+
+    /* The first column of both views is the name. */
+    if (index != DIAGCOL_NAME)
+        g_object_set(renderer, "xalign", 1.0, NULL);
+
+    gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(column, width);
+
+    gtk_tree_view_append_column(tv, column);
+}
+
+static GtkWidget *trg_diagnostics_scrolled(GtkWidget *tv)
+{
+    GtkWidget *sw = gtk_scrolled_window_new(NULL, NULL);
+
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(sw), GTK_POLICY_AUTOMATIC,
+                                   GTK_POLICY_AUTOMATIC);
+    gtk_container_add(GTK_CONTAINER(sw), tv);
+    gtk_container_set_border_width(GTK_CONTAINER(sw), GUI_PAD);
+
+    return sw;
+}
+
+static GtkWidget *trg_diagnostics_memory_view(TrgDiagnosticsDialog *dlg)
+{
+    GtkWidget *tv;
+    GtkTreeIter iter;
+    guint i;
+
+    dlg->memory = gtk_list_store_new(MEMCOL_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+
+    for (i = 0; i < TRG_MEMORY_COUNT; i++)
+        gtk_list_store_insert_with_values(dlg->memory, &iter, -1, MEMCOL_NAME,
+                                          trg_memory_subsystem_name(i), -1);
+
+    gtk_list_store_insert_with_values(dlg->memory, &iter, -1, MEMCOL_NAME, _("Total"), -1);
+
+    tv = trg_tree_view_new();
+    gtk_widget_set_sensitive(tv, TRUE);
+
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), MEMCOL_NAME, _("Subsystem"), 260);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), MEMCOL_COUNT, _("Count"), 90);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), MEMCOL_BYTES, _("Estimated Size"), 120);
+
+    gtk_tree_view_set_model(GTK_TREE_VIEW(tv), GTK_TREE_MODEL(dlg->memory));
+    g_object_unref(dlg->memory);
+
+    return trg_diagnostics_scrolled(tv);
+}
+
+static GObject *trg_diagnostics_dialog_constructor(GType type, guint n_construct_properties,
+                                                   GObjectConstructParam *construct_params)
+{
+    GtkWidget *tv, *notebook;
+    GObject *obj = G_OBJECT_CLASS(trg_diagnostics_dialog_parent_class)
+                       ->constructor(type, n_construct_properties, construct_params);
+    TrgDiagnosticsDialog *dlg = TRG_DIAGNOSTICS_DIALOG(obj);
+
+    gtk_window_set_title(GTK_WINDOW(obj), _("Diagnostics"));
+    gtk_window_set_transient_for(GTK_WINDOW(obj), GTK_WINDOW(dlg->parent_win));
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(obj), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(obj), 960, 420);
+    gtk_dialog_add_button(GTK_DIALOG(obj), _("_Close"), GTK_RESPONSE_CLOSE);
+
+    gtk_container_set_border_width(GTK_CONTAINER(obj), GUI_PAD);
+
+    gtk_dialog_set_default_response(GTK_DIALOG(obj), GTK_RESPONSE_CLOSE);
+
+    g_signal_connect(G_OBJECT(obj), "response", G_CALLBACK(trg_diagnostics_response_cb), NULL);
+    g_signal_connect(G_OBJECT(obj), "destroy", G_CALLBACK(trg_diagnostics_destroy_cb), NULL);
+
+    dlg->methods = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                         (GDestroyNotify)gtk_tree_row_reference_free);
+    dlg->model = gtk_tree_store_new(DIAGCOL_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                                    G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                                    G_TYPE_STRING, G_TYPE_STRING);
+
+    tv = trg_tree_view_new();
+    gtk_widget_set_sensitive(tv, TRUE);
+
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_NAME, _("Request"), 200);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_REQUESTS, _("Count"), 70);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_P50, _("Median"), 90);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_P95, _("95th %"), 90);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_P99, _("99th %"), 90);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_BYTES, _("Received"), 100);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_RATIO, _("Compression"), 100);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_TORRENTS, _("Torrents"), 80);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_ROWS_CHANGED, _("Rows Changed"), 100);
+
+    gtk_tree_view_set_model(GTK_TREE_VIEW(tv), GTK_TREE_MODEL(dlg->model));
+    g_object_unref(dlg->model);
+
+    dlg->notebook = notebook = gtk_notebook_new();
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), trg_diagnostics_scrolled(tv),
+                             gtk_label_new(_("Requests")));
+    dlg->memoryPage
+        = gtk_notebook_append_page(GTK_NOTEBOOK(notebook), trg_diagnostics_memory_view(dlg),
+                                   gtk_label_new(_("Memory")));
+    gtk_box_pack_start(GTK_BOX(gtk_bin_get_child(GTK_BIN(obj))), notebook, TRUE, TRUE, 0);
+
+    g_signal_connect(notebook, "switch-page", G_CALLBACK(trg_diagnostics_switch_page_cb), obj);
+
+    trg_diagnostics_update_timerfunc(obj);
+    dlg->update_timer_tag = g_timeout_add_seconds(DIAGNOSTICS_UPDATE_INTERVAL,
+                                                  trg_diagnostics_update_timerfunc, obj);
+
+    return obj;
+}
+
+static void trg_diagnostics_dialog_class_init(TrgDiagnosticsDialogClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    object_class->get_property = trg_diagnostics_dialog_get_property;
+    object_class->set_property = trg_diagnostics_dialog_set_property;
+    object_class->constructor = trg_diagnostics_dialog_constructor;
+
+    g_object_class_install_property(
+        object_class, PROP_PARENT,
+        g_param_spec_object("parent-window", "Parent window", "Parent window", TRG_TYPE_MAIN_WINDOW,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_NAME
+                                | G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+}
+
+static void trg_diagnostics_dialog_init(TrgDiagnosticsDialog *self)
+{
+}
+
+TrgDiagnosticsDialog *trg_diagnostics_dialog_get_instance(TrgMainWindow *parent)
+{
+    if (instance == NULL)
+        instance = g_object_new(TRG_TYPE_DIAGNOSTICS_DIALOG, "parent-window", parent, NULL);
+
+    return TRG_DIAGNOSTICS_DIALOG(instance);
+}
@@ -0,0 +1,205 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Where the time goes between asking the daemon for something and the
+ * window showing it. Each request carries a trg_request_timing, marked as it
+ * passes through TrgClient and, for torrent-get, the main window's update.
+ * Once it's done with, its phases are added to rolling samples kept for each
+ * RPC method, which the diagnostics dialog shows as percentiles.
+ *
+ * Everything here happens on the main thread, like dispatch_rpc_async().
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trg-diagnostics.h"
+
+/* How many of the most recent requests of each method the percentiles are
+ * taken over. */
+#define TRG_DIAGNOSTICS_SAMPLES 128
+
+typedef struct {
+    gint64 samples[TRG_DIAGNOSTICS_SAMPLES];
+    guint count;
+} trg_diagnostics_ring;
+
+typedef struct {
+    const gchar *method;
+    guint64 requests;
+    guint64 bytes;
+    guint64 wireBytes;
+    guint64 updates;
+    guint64 torrents;
+    guint64 rowsChanged;
+    trg_diagnostics_ring phases[TRG_TIMING_COUNT];
+} trg_diagnostics_method;
+
+/* interned method name -> trg_diagnostics_method */
+static GHashTable *trg_diagnostics_methods;
+
+trg_request_timing *trg_request_timing_new(const gchar *method)
+{
+    trg_request_timing *timing = g_new0(trg_request_timing, 1);
+
+    timing->method = g_intern_string(method ? method : "unknown");
+    timing->torrents = -1;
+    timing->at[TRG_TIMING_DISPATCHED] = g_get_monotonic_time();
+
+    return timing;
+}
+
+/* Timestamp a point, replacing any earlier time for it (a request resent
+ * after a 409 is sent and gets headers twice). */
+void trg_request_timing_mark(trg_request_timing *timing, trg_timing_point point)
+{
+    if (timing)
+        timing->at[point] = g_get_monotonic_time();
+}
+
+void trg_request_timing_free(trg_request_timing *timing)
+{
+    g_free(timing);
+}
+
+static void trg_diagnostics_ring_add(trg_diagnostics_ring *ring, gint64 value)
+{
+    ring->samples[ring->count++ % TRG_DIAGNOSTICS_SAMPLES] = value;
+}
+
+static gint trg_diagnostics_compare(gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void trg_diagnostics_ring_percentiles(trg_diagnostics_ring *ring,
+                                             gint64 percentiles[TRG_PERCENTILE_COUNT])
+{
+    static const guint ranks[TRG_PERCENTILE_COUNT] = { 50, 95, 99 };
+    gint64 sorted[TRG_DIAGNOSTICS_SAMPLES];
+    guint n = MIN(ring->count, TRG_DIAGNOSTICS_SAMPLES);
+    guint i;
+
+    if (n == 0) {
+        for (i = 0; i < TRG_PERCENTILE_COUNT; i++)
+            percentiles[i] = -1;
+        return;
+    }
+
+    memcpy(sorted, ring->samples, n * sizeof(gint64));
+    qsort(sorted, n, sizeof(gint64), trg_diagnostics_compare);
+
+    for (i = 0; i < TRG_PERCENTILE_COUNT; i++)
+        percentiles[i] = sorted[MIN((n * ranks[i] + 99) / 100, n) - 1];
+}
+
+/* Add a finished request's phases to its method's samples, and free it.
+ * Phases it never reached, like the model update of anything but a
+ * torrent-get, are left out rather than counted as zero. */
+void trg_request_timing_submit(trg_request_timing *timing)
+{
+    trg_diagnostics_method *method;
+    gint64 last;
+    guint i;
+
+    if (!timing)
+        return;
+
+    if (!trg_diagnostics_methods)
+        trg_diagnostics_methods = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                                        g_free);
+
+    method = g_hash_table_lookup(trg_diagnostics_methods, timing->method);
+    if (!method) {
+        method = g_new0(trg_diagnostics_method, 1);
+        method->method = timing->method;
+        g_hash_table_insert(trg_diagnostics_methods, (gpointer)timing->method, method);
+    }
+
+    method->requests++;
+    method->bytes += timing->bytes;
+    method->wireBytes += timing->wireBytes ? timing->wireBytes : timing->bytes;
+
+    if (timing->torrents >= 0) {
+        method->updates++;
+        method->torrents += timing->torrents;
+        method->rowsChanged += timing->rowsChanged;
+    }
+
+    last = timing->at[TRG_TIMING_DISPATCHED];
+    for (i = TRG_TIMING_DISPATCHED + 1; i < TRG_TIMING_COUNT; i++) {
+        if (timing->at[i] > 0) {
+            trg_diagnostics_ring_add(&method->phases[i], timing->at[i] - last);
+            last = timing->at[i];
+        }
+    }
+
+    trg_diagnostics_ring_add(&method->phases[TRG_TIMING_DISPATCHED],
+                             last - timing->at[TRG_TIMING_DISPATCHED]);
+
+    trg_request_timing_free(timing);
+}
+
+static gint trg_diagnostics_summary_compare(gconstpointer a, gconstpointer b)
+{
+    const trg_diagnostics_summary *x = *(trg_diagnostics_summary *const *)a;
+    const trg_diagnostics_summary *y = *(trg_diagnostics_summary *const *)b;
+
+    return g_strcmp0(x->method, y->method);
+}
+
+/* A trg_diagnostics_summary for each method seen so far, by name. */
+GPtrArray *trg_diagnostics_get_summaries(void)
+{
+    GPtrArray *summaries = g_ptr_array_new_with_free_func(g_free);
+    GHashTableIter iter;
+    gpointer value;
+    guint i;
+
+    if (!trg_diagnostics_methods)
+        return summaries;
+
+    g_hash_table_iter_init(&iter, trg_diagnostics_methods);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        trg_diagnostics_method *method = value;
+        trg_diagnostics_summary *summary = g_new0(trg_diagnostics_summary, 1);
+
+        summary->method = method->method;
+        summary->requests = method->requests;
+        summary->bytes = method->bytes;
+        summary->wireBytes = method->wireBytes;
+        summary->updates = method->updates;
+        summary->torrents = method->torrents;
+        summary->rowsChanged = method->rowsChanged;
+
+        for (i = 0; i < TRG_TIMING_COUNT; i++)
+            trg_diagnostics_ring_percentiles(&method->phases[i], summary->percentiles[i]);
+
+        g_ptr_array_add(summaries, summary);
+    }
+
+    g_ptr_array_sort(summaries, trg_diagnostics_summary_compare);
+
+    return summaries;
+}
@@ -0,0 +1,72 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <glib.h>
+
+/* The points a request passes on its way through the client. Each one ends
+ * a phase timed from the last point reached before it, except the first,
+ * whose phase is the total. */
+typedef enum {
+    TRG_TIMING_DISPATCHED,
+    TRG_TIMING_SERIALIZED,
+    TRG_TIMING_SENT,
+    TRG_TIMING_HEADERS,
+    TRG_TIMING_RECEIVED,
+    TRG_TIMING_VALIDATED,
+    TRG_TIMING_PARSED,
+    TRG_TIMING_CALLBACK,
+    TRG_TIMING_UPDATED,
+    TRG_TIMING_REFRESHED,
+    TRG_TIMING_COUNT
+} trg_timing_point;
+
+typedef enum {
+    TRG_PERCENTILE_50,
+    TRG_PERCENTILE_95,
+    TRG_PERCENTILE_99,
+    TRG_PERCENTILE_COUNT
+} trg_percentile;
+
+typedef struct {
+    const gchar *method;
+    gint64 at[TRG_TIMING_COUNT];
+    gsize bytes;
+    gsize wireBytes; /* before any Content-Encoding was undone, if known */
+    gint torrents; /* -1 unless the response updated the torrent list */
+    gint rowsChanged;
+} trg_request_timing;
+
+typedef struct {
+    const gchar *method;
+    guint64 requests;
+    guint64 bytes;
+    guint64 wireBytes;
+    guint64 updates;
+    guint64 torrents;
+    guint64 rowsChanged;
+    /* Over the most recent requests, in microseconds, or -1 without any. */
+    gint64 percentiles[TRG_TIMING_COUNT][TRG_PERCENTILE_COUNT];
+} trg_diagnostics_summary;
+
+trg_request_timing *trg_request_timing_new(const gchar *method);
+void trg_request_timing_mark(trg_request_timing *timing, trg_timing_point point);
+void trg_request_timing_submit(trg_request_timing *timing);
+void trg_request_timing_free(trg_request_timing *timing);
+GPtrArray *trg_diagnostics_get_summaries(void);
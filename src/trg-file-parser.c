@@ -27,6 +27,7 @@
 
 #include "bencode.h"
 #include "trg-file-parser.h"
+#include "trg-profile.h"
 
 static trg_files_tree_node *trg_file_parser_node_insert(trg_files_tree_node *top,
                                                         trg_files_tree_node *last,
@@ -193,7 +194,9 @@ trg_torrent_file *trg_parse_torrent_file(const gchar *filename, GError **error)
     if (*error) {
         return NULL;
     } else {
+        gint64 start = trg_span_start();
         ret = trg_parse_torrent_data(g_mapped_file_get_contents(mf), g_mapped_file_get_length(mf));
+        trg_span_stop(TRG_PROFILE_TORRENT_FILE, "torrent-file", "parse", start);
     }
 
     g_mapped_file_unref(mf);
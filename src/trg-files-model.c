@@ -30,6 +30,8 @@
 #include "trg-files-model.h"
 #include "trg-files-tree-view-common.h"
 #include "trg-files-tree.h"
+#include "trg-memory.h"
+#include "trg-profile.h"
 #include "util.h"
 
 #include "trg-files-model.h"
@@ -284,6 +286,11 @@ static void trg_files_model_class_init(TrgFilesModelClass *klass)
 {
 }
 
+static void trg_files_model_usage(GObject *object, trg_memory_usage *usage)
+{
+    trg_memory_add_rows(GTK_TREE_MODEL(object), usage);
+}
+
 static void trg_files_model_init(TrgFilesModel *self)
 {
     GType column_types[FILESCOL_COLUMNS];
@@ -299,6 +306,8 @@ static void trg_files_model_init(TrgFilesModel *self)
     column_types[FILESCOL_BYTESCOMPLETED] = G_TYPE_INT64;
 
     gtk_tree_store_set_column_types(GTK_TREE_STORE(self), FILESCOL_COLUMNS, column_types);
+
+    trg_memory_register(G_OBJECT(self), TRG_MEMORY_FILES_NODES, trg_files_model_usage);
 }
 
 struct MinorUpdateData {
@@ -342,6 +351,7 @@ static gboolean trg_files_model_applytree_idlefunc(gpointer data)
 {
     struct FirstUpdateThreadData *args = (struct FirstUpdateThreadData *)data;
     TrgFilesModel *self = TRG_FILES_MODEL(args->model);
+    gint64 start = trg_span_start();
 
     if (args->torrent_id == self->torrentId) {
         store_add_node(GTK_TREE_STORE(args->model), NULL, args->top_node);
@@ -350,6 +360,8 @@ static gboolean trg_files_model_applytree_idlefunc(gpointer data)
         self->accept = TRUE;
     }
 
+    trg_span_stop(TRG_PROFILE_NONE, "files-model", "apply-tree", start);
+
     trg_files_tree_node_free(args->top_node);
     g_free(data);
 
@@ -360,6 +372,7 @@ static gpointer trg_files_model_buildtree_threadfunc(gpointer data)
 {
     struct FirstUpdateThreadData *args = (struct FirstUpdateThreadData *)data;
     trg_files_tree_node *lastNode = NULL;
+    gint64 start = trg_span_start();
     GList *li;
 
     args->top_node = g_new0(trg_files_tree_node, 1);
@@ -374,6 +387,8 @@ static gpointer trg_files_model_buildtree_threadfunc(gpointer data)
     g_list_free(args->filesList);
     json_array_unref(args->files);
 
+    trg_span_stop(TRG_PROFILE_NONE, "files-model", "build-tree", start);
+
     if (args->idle_add)
         g_idle_add(trg_files_model_applytree_idlefunc, data);
 
@@ -388,6 +403,7 @@ void trg_files_model_update(TrgFilesModel *model, GtkTreeView *tv, gint64 update
     guint filesListLength = g_list_length(filesList);
     JsonArray *priorities = torrent_get_priorities(t);
     JsonArray *wanted = torrent_get_wanted(t);
+    gint64 start = trg_span_start();
     model->torrentId = torrent_get_id(t);
 
     /* It's quicker to build this up with simple data structures before
@@ -430,6 +446,9 @@ void trg_files_model_update(TrgFilesModel *model, GtkTreeView *tv, gint64 update
                                (GtkTreeModelForeachFunc)trg_files_model_update_foreach, &mud);
         g_list_free(filesList);
     }
+
+    /* Only the main loop's share when the tree is built in a thread. */
+    trg_span_stop(TRG_PROFILE_FILES_MODEL, "files-model", "update", start);
 }
 
 gint64 trg_files_model_get_torrent_id(TrgFilesModel *model)
@@ -47,6 +47,8 @@
 #include "util.h"
 
 #include "trg-about-window.h"
+#include "trg-daemons-dialog.h"
+#include "trg-diagnostics-dialog.h"
 #include "trg-files-model.h"
 #include "trg-files-tree-view.h"
 #include "trg-main-window.h"
@@ -55,6 +57,8 @@
 #include "trg-peers-tree-view.h"
 #include "trg-preferences-dialog.h"
 #include "trg-prefs.h"
+#include "trg-profile.h"
+#include "trg-trace.h"
 #include "trg-remote-prefs-dialog.h"
 #include "trg-sortable-filtered-model.h"
 #include "trg-state-selector.h"
@@ -63,6 +67,7 @@
 #include "trg-toolbar.h"
 #include "trg-torrent-add-dialog.h"
 #include "trg-torrent-add-url-dialog.h"
+#include "trg-torrent-filter.h"
 #include "trg-torrent-model.h"
 #include "trg-torrent-move-dialog.h"
 #include "trg-torrent-props-dialog.h"
@@ -114,6 +119,7 @@ static gboolean on_torrent_get_first(gpointer data);
 static gboolean on_torrent_get_active(gpointer data);
 static gboolean on_torrent_get_update(gpointer data);
 static gboolean on_torrent_get_interactive(gpointer data);
+static gboolean trg_backoff_probe_timerfunc(gpointer data);
 static gboolean trg_session_update_timerfunc(gpointer data);
 static gboolean trg_update_torrents_timerfunc(gpointer data);
 static void open_about_cb(GtkWidget *w, GtkWindow *parent);
@@ -154,6 +160,14 @@ static gboolean torrent_tv_popup_menu_cb(GtkWidget *treeview, gpointer userdata)
 static void trg_main_window_set_hidden_to_tray(TrgMainWindow *win, gboolean hidden);
 static gboolean is_ready_for_torrent_action(TrgMainWindow *win);
 
+enum {
+    NOTEBOOK_PAGE_GENERAL,
+    NOTEBOOK_PAGE_TRACKERS,
+    NOTEBOOK_PAGE_FILES,
+    NOTEBOOK_PAGE_PEERS,
+    NOTEBOOK_PAGE_COUNT
+};
+
 struct _TrgMainWindow {
     GtkApplicationWindow parent;
 
@@ -186,13 +200,26 @@ struct _TrgMainWindow {
     TrgPeersModel *peersModel;
     TrgPeersTreeView *peersTreeView;
 
+    /* The torrent each notebook page was last brought up to date for, so
+     * a page which wasn't showing can catch up when it's switched to. */
+    gint64 pageTorrentId[NOTEBOOK_PAGE_COUNT];
+    gint64 detailSerial;
+    trg_request_timing *updateTiming;
+
+    /* The full and recently-active torrent-get polls, serialized once and
+     * re-used until the derived columns they ask for change. */
+    GBytes *pollBodies[2];
+    guint pollDerived[2];
+
     GtkWidget *hpaned, *vpaned;
     GtkWidget *filterEntry;
+    trg_torrent_filter filter;
 
     gboolean hidden;
     gint width, height;
     guint timerId;
     guint sessionTimerId;
+    gint breaker;
     gboolean min_on_start;
     gboolean queuesEnabled;
 
@@ -201,6 +228,19 @@ struct _TrgMainWindow {
 
 G_DEFINE_TYPE(TrgMainWindow, trg_main_window, GTK_TYPE_WINDOW)
 
+/* How polling stands after failed requests. Closed while they succeed, or
+ * are being retried with backoff. Open once TRG_PREFS_KEY_RETRIES have
+ * failed in a row, when only a session-get probe is sent now and then.
+ * Half-open while a full poll checks a daemon that answered a probe. */
+enum {
+    TRG_BREAKER_CLOSED,
+    TRG_BREAKER_OPEN,
+    TRG_BREAKER_HALF_OPEN
+};
+
+/* The longest wait between attempts, however many have failed. */
+#define TRG_BACKOFF_MAX_MS (5 * 60 * 1000)
+
 enum {
     PROP_0,
     PROP_CLIENT
@@ -223,20 +263,121 @@ gint trg_mw_get_selected_torrent_id(TrgMainWindow *win)
     return win->selectedTorrentId;
 }
 
+/* A torrent-get for the base fields, plus any the showing columns need. */
+static JsonNode *trg_main_window_torrent_get(TrgMainWindow *win, gint64 id)
+{
+    JsonNode *req = torrent_get(id, trg_client_get_rpc_version(win->client));
+
+    trg_torrent_model_add_derived_fields(win->torrentModel, req);
+
+    return req;
+}
+
+/* Send a torrent-get for every torrent (TORRENT_GET_TAG_MODE_FULL) or the
+ * recently active ones (TORRENT_GET_TAG_MODE_UPDATE). */
+static void trg_main_window_dispatch_poll(TrgMainWindow *win, gint64 mode, GSourceFunc callback)
+{
+    guint derived = trg_torrent_model_get_derived(win->torrentModel);
+    guint i = mode == TORRENT_GET_TAG_MODE_UPDATE ? 1 : 0;
+
+    if (!win->pollBodies[i] || win->pollDerived[i] != derived) {
+        g_clear_pointer(&win->pollBodies[i], g_bytes_unref);
+        win->pollBodies[i] = request_to_bytes(trg_main_window_torrent_get(win, mode));
+        win->pollDerived[i] = derived;
+    }
+
+    dispatch_rpc_bytes_async(win->client, win->pollBodies[i], METHOD_TORRENT_GET, callback, win);
+}
+
+/* The notebook page being shown, or -1 if the notebook isn't showing. */
+static gint trg_main_window_notebook_page(TrgMainWindow *win)
+{
+    if (!win->notebook || !gtk_widget_get_visible(win->notebook)
+        || !gtk_widget_get_mapped(win->notebook))
+        return -1;
+
+    return gtk_notebook_get_current_page(GTK_NOTEBOOK(win->notebook));
+}
+
+static gboolean on_torrent_detail_get(gpointer data)
+{
+    trg_response *response = (trg_response *)data;
+    TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
+    gint page = trg_main_window_notebook_page(win);
+    JsonArray *torrents;
+    JsonObject *t;
+    gint64 id;
+    gint mode;
+
+    if (response->status != SOUP_STATUS_OK || !trg_client_is_connected(win->client))
+        goto out;
+
+    torrents = get_torrents(get_arguments(response->obj));
+    if (json_array_get_length(torrents) != 1)
+        goto out;
+
+    t = json_array_get_object_element(torrents, 0);
+    id = torrent_get_id(t);
+
+    /* The selection or page may have moved on while this was in flight. */
+    if (id != win->selectedTorrentId || page < 0)
+        goto out;
+
+    mode = win->pageTorrentId[page] == id ? TORRENT_GET_MODE_UPDATE : TORRENT_GET_MODE_FIRST;
+
+    if (page == NOTEBOOK_PAGE_FILES && json_object_has_member(t, FIELD_FILES)) {
+        trg_files_model_update(win->filesModel, GTK_TREE_VIEW(win->filesTreeView),
+                               ++win->detailSerial, t, mode);
+        win->pageTorrentId[page] = id;
+    } else if (page == NOTEBOOK_PAGE_PEERS && json_object_has_member(t, FIELD_PEERS)) {
+        trg_peers_model_update(win->peersModel, TRG_TREE_VIEW(win->peersTreeView),
+                               ++win->detailSerial, t, mode);
+        win->pageTorrentId[page] = id;
+    }
+
+out:
+    trg_response_free(response);
+    return FALSE;
+}
+
+/*
+ * Only the notebook page being shown is updated. The general and trackers
+ * pages work from the torrent's JSON in the list update, the files and
+ * peers pages fetch their fields for just this torrent. A page which was
+ * last updated for a different torrent is rebuilt rather than updated.
+ */
 static void update_selected_torrent_notebook(TrgMainWindow *win, gint mode, gint64 id)
 {
     TrgClient *client = win->client;
     gint64 serial = trg_client_get_serial(client);
+    gint page = trg_main_window_notebook_page(win);
     JsonObject *t;
     GtkTreeIter iter;
 
     if (id >= 0 && get_torrent_data(trg_client_get_torrent_table(client), id, &t, &iter)) {
+        gint pageMode = page >= 0 && win->pageTorrentId[page] == id ? mode : TORRENT_GET_MODE_FIRST;
+
         trg_toolbar_torrent_actions_sensitive(win->toolBar, TRUE);
         trg_menu_bar_torrent_actions_sensitive(win->menuBar, TRUE);
-        trg_general_panel_update(win->genDetails, t, &iter);
-        trg_trackers_model_update(win->trackersModel, serial, t, mode);
-        trg_files_model_update(win->filesModel, GTK_TREE_VIEW(win->filesTreeView), serial, t, mode);
-        trg_peers_model_update(win->peersModel, TRG_TREE_VIEW(win->peersTreeView), serial, t, mode);
+
+        switch (page) {
+        case NOTEBOOK_PAGE_GENERAL:
+            trg_general_panel_update(win->genDetails, t, &iter);
+            win->pageTorrentId[page] = id;
+            break;
+        case NOTEBOOK_PAGE_TRACKERS:
+            trg_trackers_model_update(win->trackersModel, serial, t, pageMode);
+            win->pageTorrentId[page] = id;
+            break;
+        case NOTEBOOK_PAGE_FILES:
+            dispatch_rpc_async(client, torrent_get_files_detail(id), on_torrent_detail_get, win);
+            break;
+        case NOTEBOOK_PAGE_PEERS:
+            dispatch_rpc_async(client, torrent_get_peers_detail(id), on_torrent_detail_get, win);
+            break;
+        default:
+            break;
+        }
     } else {
         trg_main_window_torrent_scrub(win);
     }
@@ -292,6 +433,10 @@ static void destroy_window(TrgMainWindow *win, gpointer data G_GNUC_UNUSED)
 {
     TrgPrefs *prefs = trg_client_get_prefs(win->client);
 
+    g_clear_pointer(&win->updateTiming, trg_request_timing_free);
+    g_clear_pointer(&win->pollBodies[0], g_bytes_unref);
+    g_clear_pointer(&win->pollBodies[1], g_bytes_unref);
+
     trg_prefs_set_int(prefs, TRG_PREFS_KEY_WINDOW_HEIGHT, win->height, TRG_PREFS_GLOBAL);
     trg_prefs_set_int(prefs, TRG_PREFS_KEY_WINDOW_WIDTH, win->width, TRG_PREFS_GLOBAL);
     trg_prefs_set_int(prefs, TRG_PREFS_KEY_NOTEBOOK_PANED_POS,
@@ -481,7 +626,8 @@ void connect_cb(GtkWidget *w, gpointer data)
 
     trg_status_bar_push_connection_msg(win->statusBar, _("Connecting..."));
     trg_client_inc_connid(win->client);
-    dispatch_rpc_async(win->client, session_get(), on_session_get, data);
+    dispatch_rpc_bytes_async(win->client, session_get_body(), METHOD_SESSION_GET, on_session_get,
+                             data);
 }
 
 static void open_local_prefs_cb(GtkWidget *w G_GNUC_UNUSED, TrgMainWindow *win)
@@ -721,12 +867,75 @@ static void view_stats_toggled_cb(GtkWidget *w, gpointer data)
     }
 }
 
+static void view_diagnostics_cb(GtkWidget *w G_GNUC_UNUSED, TrgMainWindow *win)
+{
+    gtk_widget_show_all(GTK_WIDGET(trg_diagnostics_dialog_get_instance(win)));
+}
+
+static void view_daemons_cb(GtkWidget *w G_GNUC_UNUSED, TrgMainWindow *win)
+{
+    gtk_widget_show_all(GTK_WIDGET(trg_daemons_dialog_get_instance(win, win->client)));
+}
+
 static void view_states_toggled_cb(GtkCheckMenuItem *w, TrgMainWindow *win)
 {
 
     trg_widget_set_visible(win->stateSelectorScroller, gtk_check_menu_item_get_active(w));
 }
 
+/* Work out which derived torrent columns anything is showing - the torrent
+ * list's columns and sort, and the general page's seeds and leechers - so
+ * the model only computes (and fetches the fields for) those. */
+static void trg_main_window_update_derived(TrgMainWindow *win)
+{
+    TrgTreeView *tv = TRG_TREE_VIEW(win->torrentTreeView);
+    guint derived = 0;
+    GtkSortType order;
+    gint column;
+
+    for (column = 0; column < TORRENT_COLUMN_COLUMNS; column++)
+        if (trg_tree_view_is_column_showing(tv, column))
+            derived |= trg_torrent_model_column_derived(column);
+
+    if (gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel), &column,
+                                             &order))
+        derived |= trg_torrent_model_column_derived(column);
+
+    if (trg_main_window_notebook_page(win) == NOTEBOOK_PAGE_GENERAL)
+        derived |= TORRENT_DERIVED_PEER_COUNTS;
+
+    if (trg_torrent_model_set_derived(win->torrentModel, derived)
+        && trg_client_is_connected(win->client))
+        trg_main_window_dispatch_poll(win, TORRENT_GET_TAG_MODE_FULL, on_torrent_get_interactive);
+}
+
+static void trg_main_window_derived_changed_cb(gpointer instance G_GNUC_UNUSED,
+                                               TrgMainWindow *win)
+{
+    trg_main_window_update_derived(win);
+}
+
+/* Bring a notebook page which has just come into view up to date. */
+static void trg_main_window_notebook_catch_up(TrgMainWindow *win)
+{
+    trg_main_window_update_derived(win);
+
+    if (win->selectedTorrentId >= 0 && trg_client_is_connected(win->client))
+        update_selected_torrent_notebook(win, TORRENT_GET_MODE_UPDATE, win->selectedTorrentId);
+}
+
+static void notebook_mapped_cb(GtkWidget *w G_GNUC_UNUSED, TrgMainWindow *win)
+{
+    trg_main_window_notebook_catch_up(win);
+}
+
+static void notebook_switch_page_cb(GtkNotebook *notebook G_GNUC_UNUSED,
+                                    GtkWidget *page G_GNUC_UNUSED, guint page_num G_GNUC_UNUSED,
+                                    TrgMainWindow *win)
+{
+    trg_main_window_notebook_catch_up(win);
+}
+
 static void view_notebook_toggled_cb(GtkCheckMenuItem *w, TrgMainWindow *win)
 {
 
@@ -744,6 +953,7 @@ static GtkWidget *trg_main_window_notebook_new(TrgMainWindow *win)
 
     GtkWidget *notebook = win->notebook = gtk_notebook_new();
     GtkWidget *genScrolledWin = gtk_scrolled_window_new(NULL, NULL);
+    gint i;
 
     win->genDetails = trg_general_panel_new(GTK_TREE_MODEL(win->torrentModel), win->client);
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(genScrolledWin), GTK_POLICY_AUTOMATIC,
@@ -769,6 +979,15 @@ static GtkWidget *trg_main_window_notebook_new(TrgMainWindow *win)
                              my_scrolledwin_new(GTK_WIDGET(win->peersTreeView)),
                              gtk_label_new(_("Peers")));
 
+    for (i = 0; i < NOTEBOOK_PAGE_COUNT; i++)
+        win->pageTorrentId[i] = -1;
+
+    /* Switching page runs the default handler first, so the current page is
+     * the new one by the time this runs. */
+    g_signal_connect_after(notebook, "switch-page", G_CALLBACK(notebook_switch_page_cb), win);
+    g_signal_connect(notebook, "map", G_CALLBACK(notebook_mapped_cb), win);
+    g_signal_connect_swapped(notebook, "unmap", G_CALLBACK(trg_main_window_update_derived), win);
+
     return notebook;
 }
 
@@ -791,17 +1010,27 @@ static gboolean hasEnabledChanged(JsonObject *a, JsonObject *b, const gchar *key
     return json_object_get_boolean_member(a, key) != json_object_get_boolean_member(b, key);
 }
 
+static void trg_main_window_start_session_timer(TrgMainWindow *win)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(win->client);
+
+    g_clear_handle_id(&win->sessionTimerId, g_source_remove);
+    win->sessionTimerId = g_timeout_add_seconds(
+        trg_prefs_get_int(prefs, TRG_PREFS_KEY_SESSION_UPDATE_INTERVAL, TRG_PREFS_CONNECTION),
+        trg_session_update_timerfunc, win);
+}
+
 static gboolean on_session_get_timer(gpointer data)
 {
     trg_response *response = (trg_response *)data;
     TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
-    TrgPrefs *prefs = trg_client_get_prefs(win->client);
 
     on_session_get(data);
 
-    win->sessionTimerId = g_timeout_add_seconds(
-        trg_prefs_get_int(prefs, TRG_PREFS_KEY_SESSION_UPDATE_INTERVAL, TRG_PREFS_CONNECTION),
-        trg_session_update_timerfunc, win);
+    /* Left stopped while the daemon is unreachable; closing the breaker
+     * starts it again. */
+    if (win->breaker == TRG_BREAKER_CLOSED && trg_client_is_connected(win->client))
+        trg_main_window_start_session_timer(win);
 
     return FALSE;
 }
@@ -868,8 +1097,7 @@ static gboolean on_session_get(gpointer data)
     if (!isConnected) {
         trg_main_window_conn_changed(win, TRUE);
         trg_trackers_tree_view_new_connection(win->trackersTreeView, client);
-        dispatch_rpc_async(client, torrent_get(TORRENT_GET_TAG_MODE_FULL), on_torrent_get_first,
-                           win);
+        trg_main_window_dispatch_poll(win, TORRENT_GET_TAG_MODE_FULL, on_torrent_get_first);
     }
 
     trg_response_free(response);
@@ -923,20 +1151,196 @@ static void update_whatever_tray(TrgMainWindow *win, trg_torrent_model_update_st
 #endif
 }
 
+/* Hand the timing of the torrent-get being applied on to
+ * on_torrent_model_updated(). One left over is from an update that was
+ * cancelled, so it's dropped. */
+static void trg_main_window_set_update_timing(TrgMainWindow *win, trg_request_timing *timing)
+{
+    g_clear_pointer(&win->updateTiming, trg_request_timing_free);
+    win->updateTiming = timing;
+}
+
+static guint trg_main_window_update_interval(TrgMainWindow *win)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(win->client);
+    gint64 interval
+        = trg_prefs_get_int(prefs, TRG_PREFS_KEY_UPDATE_INTERVAL, TRG_PREFS_CONNECTION);
+
+    return interval < 1 ? TRG_INTERVAL_DEFAULT : (guint)interval;
+}
+
+/* Milliseconds to wait after the given number of failures in a row: the
+ * update interval, doubled for each failure after the first and capped,
+ * then jittered between half and all of that so clients which lost the
+ * same daemon don't all come back at once. */
+static guint trg_backoff_delay(guint interval, guint failures)
+{
+    guint64 delay = (guint64)interval * 1000 << MIN(failures > 0 ? failures - 1 : 0, 16);
+
+    delay = MIN(delay, TRG_BACKOFF_MAX_MS);
+
+    return delay / 2 + g_random_int_range(0, delay / 2 + 1);
+}
+
+/* A poll or probe failed. Retry the poll after a backoff, or once too many
+ * have failed in a row, stop polling and probe with session-get instead. */
+static void trg_main_window_poll_failed(TrgMainWindow *win, trg_response *response)
+{
+    TrgClient *client = win->client;
+    TrgPrefs *prefs = trg_client_get_prefs(client);
+    gint64 max_retries = trg_prefs_get_int(prefs, TRG_PREFS_KEY_RETRIES, TRG_PREFS_CONNECTION);
+    guint failures = trg_client_inc_failcount(client);
+    guint delay = trg_backoff_delay(trg_main_window_update_interval(win), failures);
+    guint seconds = (delay + 999) / 1000;
+    g_autofree gchar *msg
+        = make_error_message(response->obj, response->status, response->err_msg);
+    g_autofree gchar *statusBarMsg = NULL;
+
+    g_clear_handle_id(&win->timerId, g_source_remove);
+
+    if (failures >= max_retries) {
+        win->breaker = TRG_BREAKER_OPEN;
+        g_clear_handle_id(&win->sessionTimerId, g_source_remove);
+        statusBarMsg = g_strdup_printf(_("Daemon unreachable: %s. Trying again in %us."), msg,
+                                       seconds);
+        win->timerId = g_timeout_add(delay, trg_backoff_probe_timerfunc, win);
+    } else {
+        statusBarMsg = g_strdup_printf(_("Request %u/%d failed: %s. Retrying in %us."), failures,
+                                       (gint)max_retries, msg, seconds);
+        win->timerId = g_timeout_add(delay, trg_update_torrents_timerfunc, win);
+    }
+
+    trg_status_bar_push_connection_msg(win->statusBar, statusBarMsg);
+}
+
+/* A poll was answered, ending any run of failures. */
+static void trg_main_window_poll_succeeded(TrgMainWindow *win)
+{
+    TrgClient *client = win->client;
+
+    if (trg_client_get_failcount(client) > 0) {
+        trg_client_reset_failcount(client);
+        trg_status_bar_connect(win->statusBar, trg_client_get_session(client), client);
+    }
+
+    /* timerId may still hold the probe, and an interactive response doesn't
+     * schedule the next poll, so start polling again here. */
+    if (win->breaker != TRG_BREAKER_CLOSED) {
+        win->breaker = TRG_BREAKER_CLOSED;
+        trg_main_window_start_session_timer(win);
+        g_clear_handle_id(&win->timerId, g_source_remove);
+        win->timerId = g_timeout_add_seconds(trg_main_window_update_interval(win),
+                                             trg_update_torrents_timerfunc, win);
+    }
+}
+
+/* The daemon answered a probe, so try a full poll. Its result closes the
+ * breaker again or opens it for a longer wait. */
+static gboolean on_backoff_probe(gpointer data)
+{
+    trg_response *response = (trg_response *)data;
+    TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
+
+    if (!trg_client_is_connected(win->client) || win->breaker != TRG_BREAKER_OPEN) {
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    if (response->status != SOUP_STATUS_OK) {
+        trg_main_window_poll_failed(win, response);
+    } else {
+        win->breaker = TRG_BREAKER_HALF_OPEN;
+        trg_main_window_dispatch_poll(win, TORRENT_GET_TAG_MODE_FULL, on_torrent_get_update);
+    }
+
+    trg_response_free(response);
+
+    return FALSE;
+}
+
+static gboolean trg_backoff_probe_timerfunc(gpointer data)
+{
+    TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+
+    win->timerId = 0;
+
+    if (trg_client_is_connected(win->client)) {
+        trg_status_bar_push_connection_msg(win->statusBar, _("Reconnecting..."));
+        dispatch_rpc_bytes_async(win->client, session_get_body(), METHOD_SESSION_GET,
+                                 on_backoff_probe, win);
+    }
+
+    return FALSE;
+}
+
+/* Everything that follows an update, once it's fully applied. */
+static void on_torrent_model_updated(TrgTorrentModel *model G_GNUC_UNUSED, gint mode,
+                                     trg_torrent_model_update_stats *stats, gpointer data)
+{
+    TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+    trg_request_timing *timing = g_steal_pointer(&win->updateTiming);
+
+    if (timing) {
+        if (!timing->at[TRG_TIMING_UPDATED])
+            trg_request_timing_mark(timing, TRG_TIMING_UPDATED);
+        timing->rowsChanged = stats->rowsChanged;
+    }
+
+    update_selected_torrent_notebook(win, mode, win->selectedTorrentId);
+    trg_status_bar_update(win->statusBar, stats, win->client);
+    update_whatever_tray(win, stats);
+
+    trg_request_timing_mark(timing, TRG_TIMING_REFRESHED);
+    trg_request_timing_submit(timing);
+
+    if (mode != TORRENT_GET_MODE_INTERACTION) {
+        g_clear_handle_id(&win->timerId, g_source_remove);
+        win->timerId = g_timeout_add_seconds(trg_main_window_update_interval(win),
+                                             trg_update_torrents_timerfunc, win);
+    }
+}
+
+/* Above this many rows per updated torrent, leave the sort on during an
+ * update. The sort model then moves each changed row with a binary search,
+ * which is O(k log n), rather than resorting all n rows afterwards. */
+#define TRG_INCREMENTAL_SORT_RATIO 8
+
+/* Whether to switch off sorting while applying an update, and resort
+ * everything afterwards. Regular polls are applied in chunks with the sort
+ * left on, so this only sees the first poll and interactive ones. The
+ * first fills an empty list and always resorts. An interactive refresh of
+ * every torrent, after a derived column was added, resorts too. One for a
+ * single torrent or a selection after an action keeps the sort on. */
+static gboolean trg_main_window_update_needs_resort(TrgMainWindow *win, JsonObject *response)
+{
+    gint sortId;
+    GtkSortType order;
+    guint nRows, nUpdated;
+
+    if (!gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel), &sortId,
+                                              &order))
+        return FALSE;
+
+    nRows = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(win->torrentModel), NULL);
+    nUpdated = json_array_get_length(get_torrents(get_arguments(response)));
+
+    return nUpdated * TRG_INCREMENTAL_SORT_RATIO > nRows;
+}
+
 /*
  * The callback for a torrent-get response.
  */
-
 static gboolean on_torrent_get(gpointer data, int mode)
 {
     trg_response *response = (trg_response *)data;
     TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
     TrgClient *client = win->client;
-    TrgPrefs *prefs = trg_client_get_prefs(client);
     trg_torrent_model_update_stats *stats;
-    guint interval;
-    gint old_sort_id;
-    GtkSortType old_order;
+    gint old_sort_id = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+    GtkSortType old_order = GTK_SORT_ASCENDING;
+    gboolean resort;
+    gint64 start = trg_span_start();
+    gint64 phaseStart;
 
     /* Disconnected between request and response callback */
     if (!trg_client_is_connected(client)) {
@@ -944,60 +1348,67 @@ static gboolean on_torrent_get(gpointer data, int mode)
         return FALSE;
     }
 
-    interval = trg_prefs_get_int(prefs, TRG_PREFS_KEY_UPDATE_INTERVAL, TRG_PREFS_CONNECTION);
-    if (interval < 1)
-        interval = TRG_INTERVAL_DEFAULT;
-
     if (response->status != SOUP_STATUS_OK) {
-        gint64 max_retries = trg_prefs_get_int(prefs, TRG_PREFS_KEY_RETRIES, TRG_PREFS_CONNECTION);
-
-        if (trg_client_inc_failcount(client) >= max_retries) {
-            trg_main_window_conn_changed(win, FALSE);
-            trg_dialog_error_handler(win, response);
-        } else {
-            gchar *msg = make_error_message(response->obj, response->status, response->err_msg);
-            gchar *statusBarMsg
-                = g_strdup_printf(_("Request %d/%d failed: %s"), trg_client_get_failcount(client),
-                                  (gint)max_retries, msg);
-            trg_status_bar_push_connection_msg(win->statusBar, statusBarMsg);
-            g_free(msg);
-            g_free(statusBarMsg);
-            win->timerId = g_timeout_add_seconds(interval, trg_update_torrents_timerfunc, win);
-        }
-
+        trg_main_window_poll_failed(win, response);
         trg_response_free(response);
-
         return FALSE;
     }
 
-    trg_client_reset_failcount(client);
+    trg_main_window_poll_succeeded(win);
     trg_client_inc_serial(client);
 
+    if (response->timing)
+        response->timing->torrents
+            = json_array_get_length(get_torrents(get_arguments(response->obj)));
+
+    /* Regular polls are applied in chunks, so a big list doesn't hold up
+     * drawing. The sort stays on; rows that moved are repositioned as they
+     * change. */
+    if (mode == TORRENT_GET_MODE_ACTIVE || mode == TORRENT_GET_MODE_UPDATE) {
+        trg_torrent_model_update_chunked(win->torrentModel, client, response->obj, mode,
+                                         on_torrent_model_updated, win);
+        trg_main_window_set_update_timing(win, g_steal_pointer(&response->timing));
+        trg_response_free(response);
+        trg_span_stop(TRG_PROFILE_NONE, "main-window", "on_torrent_get", start);
+        return FALSE;
+    }
+
     if (mode != TORRENT_GET_MODE_FIRST)
         gtk_widget_freeze_child_notify(GTK_WIDGET(win->torrentTreeView));
 
-    gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel), &old_sort_id,
-                                         &old_order);
-    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel),
-                                         GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
-                                         GTK_SORT_ASCENDING);
+    resort = trg_main_window_update_needs_resort(win, response->obj);
 
-    stats = trg_torrent_model_update(win->torrentModel, client, response->obj, mode);
+    if (resort) {
+        gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel),
+                                             &old_sort_id, &old_order);
+        gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel),
+                                             GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
+                                             GTK_SORT_ASCENDING);
+    }
 
-    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel), old_sort_id,
-                                         old_order);
+    /* The model profiles the update itself. */
+    phaseStart = trg_span_start();
+    stats = trg_torrent_model_update(win->torrentModel, client, response->obj, mode);
+    trg_span_stop(TRG_PROFILE_NONE, "main-window", "model-update", phaseStart);
+    trg_request_timing_mark(response->timing, TRG_TIMING_UPDATED);
+
+    if (resort) {
+        phaseStart = trg_span_start();
+        gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(win->sortedTorrentModel),
+                                             old_sort_id, old_order);
+        trg_span_stop(TRG_PROFILE_SORT, "main-window", "resort", phaseStart);
+    }
 
     if (mode != TORRENT_GET_MODE_FIRST)
         gtk_widget_thaw_child_notify(GTK_WIDGET(win->torrentTreeView));
 
-    update_selected_torrent_notebook(win, mode, win->selectedTorrentId);
-    trg_status_bar_update(win->statusBar, stats, client);
-    update_whatever_tray(win, stats);
-
-    if (mode != TORRENT_GET_MODE_INTERACTION)
-        win->timerId = g_timeout_add_seconds(interval, trg_update_torrents_timerfunc, win);
+    trg_main_window_set_update_timing(win, g_steal_pointer(&response->timing));
+    phaseStart = trg_span_start();
+    on_torrent_model_updated(win->torrentModel, mode, stats, win);
+    trg_span_stop(TRG_PROFILE_NONE, "main-window", "refresh", phaseStart);
 
     trg_response_free(response);
+    trg_span_stop(TRG_PROFILE_NONE, "main-window", "on_torrent_get", start);
     return FALSE;
 }
 
@@ -1031,10 +1442,81 @@ static gboolean on_torrent_get_update(gpointer data)
     return on_torrent_get(data, TORRENT_GET_MODE_UPDATE);
 }
 
+/* Whether polls can be cut down to what the tray shows. That's while the
+ * window is hidden in it, unless notifications need to see each torrent
+ * change. The model is left as it was until the window is restored. */
+static gboolean trg_main_window_tray_polling(TrgMainWindow *win)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(win->client);
+
+    return win->hidden
+        && !trg_prefs_get_bool(prefs, TRG_PREFS_KEY_COMPLETE_NOTIFY, TRG_PREFS_NOFLAGS)
+        && !trg_prefs_get_bool(prefs, TRG_PREFS_KEY_ADD_NOTIFY, TRG_PREFS_NOFLAGS);
+}
+
+/* Count and total up a torrent_get_tray_body() response for the tray. */
+static void trg_main_window_tally_tray(TrgMainWindow *win, JsonObject *response,
+                                       trg_torrent_model_update_stats *stats)
+{
+    JsonArray *torrents = get_torrents(get_arguments(response));
+    gint64 rpcv = trg_client_get_rpc_version(win->client);
+    guint i, n = torrents ? json_array_get_length(torrents) : 0;
+
+    for (i = 0; i < n; i++) {
+        JsonObject *t = json_array_get_object_element(torrents, i);
+        gint64 downRate = torrent_get_rate_down(t);
+        gint64 upRate = torrent_get_rate_up(t);
+        /* Without a file count nothing looks complete, so every torrent
+         * with the downloading status counts as downloading. */
+        guint32 flags = torrent_get_flags(t, rpcv, torrent_get_status(t), 0, downRate, upRate);
+
+        stats->downRateTotal += downRate;
+        stats->upRateTotal += upRate;
+
+        if (flags & TORRENT_FLAG_SEEDING)
+            stats->seeding++;
+        else if (flags & TORRENT_FLAG_DOWNLOADING)
+            stats->down++;
+    }
+}
+
+static gboolean on_torrent_get_tray(gpointer data)
+{
+    trg_response *response = (trg_response *)data;
+    TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
+    trg_torrent_model_update_stats stats = { 0 };
+
+    if (!trg_client_is_connected(win->client)) {
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    if (response->status != SOUP_STATUS_OK) {
+        trg_main_window_poll_failed(win, response);
+    } else if (!trg_main_window_tray_polling(win)) {
+        /* Restored while this was on its way, so catch up on everything. */
+        trg_main_window_poll_succeeded(win);
+        trg_main_window_dispatch_poll(win, TORRENT_GET_TAG_MODE_FULL, on_torrent_get_update);
+    } else {
+        trg_main_window_poll_succeeded(win);
+        trg_main_window_tally_tray(win, response->obj, &stats);
+        update_whatever_tray(win, &stats);
+
+        g_clear_handle_id(&win->timerId, g_source_remove);
+        win->timerId = g_timeout_add_seconds(trg_main_window_update_interval(win),
+                                             trg_update_torrents_timerfunc, win);
+    }
+
+    trg_response_free(response);
+
+    return FALSE;
+}
+
 static gboolean trg_session_update_timerfunc(gpointer data)
 {
     TrgMainWindow *win = TRG_MAIN_WINDOW(data);
 
+    win->sessionTimerId = 0;
     trg_client_update_session(win->client, on_session_get_timer, win);
 
     return FALSE;
@@ -1051,7 +1533,12 @@ static gboolean trg_update_torrents_timerfunc(gpointer data)
     TrgClient *tc = win->client;
     TrgPrefs *prefs = trg_client_get_prefs(tc);
 
-    if (trg_client_is_connected(tc)) {
+    win->timerId = 0;
+
+    if (trg_client_is_connected(tc) && trg_main_window_tray_polling(win)) {
+        dispatch_rpc_bytes_async(tc, torrent_get_tray_body(), METHOD_TORRENT_GET,
+                                 on_torrent_get_tray, win);
+    } else if (trg_client_is_connected(tc)) {
         gboolean activeOnly
             = trg_prefs_get_bool(prefs, TRG_PREFS_KEY_UPDATE_ACTIVE_ONLY, TRG_PREFS_CONNECTION)
             && (!trg_prefs_get_bool(prefs, TRG_PREFS_ACTIVEONLY_FULLSYNC_ENABLED,
@@ -1060,9 +1547,9 @@ static gboolean trg_update_torrents_timerfunc(gpointer data)
                         % trg_prefs_get_int(prefs, TRG_PREFS_ACTIVEONLY_FULLSYNC_EVERY,
                                             TRG_PREFS_CONNECTION)
                     != 0));
-        dispatch_rpc_async(
-            tc, torrent_get(activeOnly ? TORRENT_GET_TAG_MODE_UPDATE : TORRENT_GET_TAG_MODE_FULL),
-            activeOnly ? on_torrent_get_active : on_torrent_get_update, data);
+        trg_main_window_dispatch_poll(
+            win, activeOnly ? TORRENT_GET_TAG_MODE_UPDATE : TORRENT_GET_TAG_MODE_FULL,
+            activeOnly ? on_torrent_get_active : on_torrent_get_update);
     }
 
     return FALSE;
@@ -1080,62 +1567,29 @@ static gboolean trg_torrent_tree_view_visible_func(GtkTreeModel *model, GtkTreeI
                                                    gpointer data)
 {
     TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+    trg_torrent_filter_row *filterRow;
     guint flags;
-    gboolean visible;
-    const gchar *filterText;
 
-    guint32 criteria = trg_state_selector_get_flag(win->stateSelector);
-
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_FLAGS, &flags, -1);
-
-    if (criteria != 0) {
-        if (criteria & FILTER_FLAG_TRACKER) {
-            gchar *text = trg_state_selector_get_selected_text(win->stateSelector);
-            JsonObject *json = NULL;
-            gboolean matchesTracker;
-            gtk_tree_model_get(model, iter, TORRENT_COLUMN_JSON, &json, -1);
-            matchesTracker
-                = (!json
-                   || !torrent_has_tracker(
-                       json, trg_state_selector_get_url_host_regex(win->stateSelector), text));
-            g_free(text);
-            if (matchesTracker)
-                return FALSE;
-        } else if (criteria & FILTER_FLAG_DIR) {
-            gchar *text = trg_state_selector_get_selected_text(win->stateSelector);
-            gchar *dd;
-            int cmp;
-            gtk_tree_model_get(model, iter, TORRENT_COLUMN_DOWNLOADDIR_SHORT, &dd, -1);
-            cmp = g_strcmp0(text, dd);
-            g_free(dd);
-            g_free(text);
-            if (cmp)
-                return FALSE;
-        } else if (!(flags & criteria)) {
-            return FALSE;
-        }
-    }
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_FLAGS, &flags, TORRENT_COLUMN_FILTER_ROW,
+                       &filterRow, -1);
 
-    visible = TRUE;
+    return trg_torrent_filter_match(&win->filter, flags, filterRow);
+}
 
-    filterText = gtk_entry_get_text(GTK_ENTRY(win->filterEntry));
-    if (strlen(filterText) > 0) {
-        gchar *name = NULL;
-        gtk_tree_model_get(model, iter, TORRENT_COLUMN_NAME, &name, -1);
-        if (name) {
-            gchar *filterCmp = g_utf8_casefold(filterText, -1);
-            gchar *nameCmp = g_utf8_casefold(name, -1);
+/* Called whenever the filter entry or state selector changes, so the visible
+ * function doesn't have to look at either (or casefold anything) per row. */
+static void trg_main_window_compile_filter(TrgMainWindow *win)
+{
+    guint32 criteria = trg_state_selector_get_flag(win->stateSelector);
+    gchar *selected = NULL;
 
-            if (!strstr(nameCmp, filterCmp))
-                visible = FALSE;
+    if (criteria & (FILTER_FLAG_TRACKER | FILTER_FLAG_DIR | FILTER_FLAG_QUERY))
+        selected = trg_state_selector_get_selected_text(win->stateSelector);
 
-            g_free(nameCmp);
-            g_free(filterCmp);
-            g_free(name);
-        }
-    }
+    trg_torrent_filter_compile(&win->filter, criteria, selected,
+                               gtk_entry_get_text(GTK_ENTRY(win->filterEntry)));
 
-    return visible;
+    g_free(selected);
 }
 
 void trg_main_window_reload_dir_aliases(TrgMainWindow *win)
@@ -1233,7 +1687,11 @@ void on_generic_interactive_action(TrgMainWindow *win, trg_response *response)
             else
                 id = TORRENT_GET_TAG_MODE_FULL;
 
-            dispatch_rpc_async(tc, torrent_get(id), on_torrent_get_interactive, win);
+            if (id < 0)
+                trg_main_window_dispatch_poll(win, id, on_torrent_get_interactive);
+            else
+                dispatch_rpc_async(tc, trg_main_window_torrent_get(win, id),
+                                   on_torrent_get_interactive, win);
         }
     }
 
@@ -1252,6 +1710,7 @@ gboolean on_generic_interactive_action_response(gpointer data)
 
 static void trg_main_window_torrent_scrub(TrgMainWindow *win)
 {
+    gint i;
 
     gtk_tree_store_clear(GTK_TREE_STORE(win->filesModel));
     gtk_list_store_clear(GTK_LIST_STORE(win->trackersModel));
@@ -1259,23 +1718,101 @@ static void trg_main_window_torrent_scrub(TrgMainWindow *win)
     trg_general_panel_clear(win->genDetails);
     trg_trackers_model_set_no_selection(TRG_TRACKERS_MODEL(win->trackersModel));
 
+    for (i = 0; i < NOTEBOOK_PAGE_COUNT; i++)
+        win->pageTorrentId[i] = -1;
+
     trg_toolbar_torrent_actions_sensitive(win->toolBar, FALSE);
     trg_menu_bar_torrent_actions_sensitive(win->menuBar, FALSE);
 }
 
+/* Merge two sorted ID lists from the name index, dropping duplicates. */
+static GArray *trg_main_window_ids_union(GArray *a, GArray *b)
+{
+    GArray *result = g_array_sized_new(FALSE, FALSE, sizeof(guint32), a->len + b->len);
+    guint i = 0, j = 0;
+
+    while (i < a->len || j < b->len) {
+        guint32 x = i < a->len ? g_array_index(a, guint32, i) : G_MAXUINT32;
+        guint32 y = j < b->len ? g_array_index(b, guint32, j) : G_MAXUINT32;
+        guint32 next = MIN(x, y);
+
+        g_array_append_val(result, next);
+
+        if (x == next)
+            i++;
+        if (y == next)
+            j++;
+    }
+
+    return result;
+}
+
 static void entry_filter_changed_cb(GtkWidget *w, TrgMainWindow *win)
 {
     gboolean clearSensitive = gtk_entry_get_text_length(GTK_ENTRY(w)) > 0;
+    trg_trigram_index *nameIndex = trg_torrent_model_get_name_index(win->torrentModel);
+    GArray *before = trg_trigram_index_lookup(nameIndex, win->filter.needle);
+    GArray *after;
+
+    trg_main_window_compile_filter(win);
+    after = trg_trigram_index_lookup(nameIndex, win->filter.needle);
+
+    /* Only the search text changed, so a row whose name couldn't match either
+     * the old or new text keeps its visibility. When both are long enough to
+     * use the name index, only re-evaluate rows that could match one of them. */
+    if (before && after) {
+        GArray *candidates = trg_main_window_ids_union(before, after);
+        trg_torrent_model_ids_changed(win->torrentModel, candidates);
+        g_array_unref(candidates);
+    } else {
+        gint64 start = trg_span_start();
+        gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(win->filteredTorrentModel));
+        trg_span_stop(TRG_PROFILE_REFILTER, "main-window", "refilter", start);
+    }
 
-    gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(win->filteredTorrentModel));
+    if (before)
+        g_array_unref(before);
+    if (after)
+        g_array_unref(after);
 
     g_object_set(win->filterEntry, "secondary-icon-sensitive", clearSensitive, NULL);
 }
 
+static void save_filter_query_cb(GtkWidget *w G_GNUC_UNUSED, TrgMainWindow *win)
+{
+    trg_state_selector_add_query(win->stateSelector,
+                                 gtk_entry_get_text(GTK_ENTRY(win->filterEntry)));
+}
+
+static void filter_entry_populate_popup_cb(GtkEntry *entry, GtkWidget *popup, TrgMainWindow *win)
+{
+    GtkWidget *item;
+
+    if (!GTK_IS_MENU(popup))
+        return;
+
+    item = gtk_separator_menu_item_new();
+    gtk_menu_shell_append(GTK_MENU_SHELL(popup), item);
+
+    item = gtk_menu_item_new_with_label(_("Save as Query"));
+    gtk_widget_set_sensitive(item, gtk_entry_get_text_length(entry) > 0);
+    g_signal_connect(item, "activate", G_CALLBACK(save_filter_query_cb), win);
+    gtk_menu_shell_append(GTK_MENU_SHELL(popup), item);
+
+    gtk_widget_show_all(popup);
+}
+
 static void torrent_state_selection_changed(TrgStateSelector *selector G_GNUC_UNUSED,
                                             guint flag G_GNUC_UNUSED, gpointer data)
 {
-    gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(data));
+    TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+    gint64 start;
+
+    trg_main_window_compile_filter(win);
+
+    start = trg_span_start();
+    gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(win->filteredTorrentModel));
+    trg_span_stop(TRG_PROFILE_REFILTER, "main-window", "refilter", start);
 }
 
 static void trg_main_window_conn_changed(TrgMainWindow *win, gboolean connected)
@@ -1291,17 +1828,21 @@ static void trg_main_window_conn_changed(TrgMainWindow *win, gboolean connected)
     gtk_widget_set_sensitive(GTK_WIDGET(win->trackersTreeView), connected);
     gtk_widget_set_sensitive(GTK_WIDGET(win->genDetails), connected);
 
+    win->breaker = TRG_BREAKER_CLOSED;
+    trg_client_reset_failcount(tc);
+
     if (connected) {
-        TrgPrefs *prefs = trg_client_get_prefs(win->client);
-        win->sessionTimerId = g_timeout_add_seconds(
-            trg_prefs_get_int(prefs, TRG_PREFS_KEY_SESSION_UPDATE_INTERVAL, TRG_PREFS_CONNECTION),
-            trg_session_update_timerfunc, win);
+        trg_main_window_start_session_timer(win);
     } else {
         trg_main_window_torrent_scrub(win);
         trg_state_selector_disconnect(win->stateSelector);
 
         trg_torrent_model_remove_all(win->torrentModel);
         g_clear_handle_id(&win->timerId, g_source_remove);
+
+        /* The next daemon may have a different rpc-version. */
+        g_clear_pointer(&win->pollBodies[0], g_bytes_unref);
+        g_clear_pointer(&win->pollBodies[1], g_bytes_unref);
         g_clear_handle_id(&win->sessionTimerId, g_source_remove);
     }
 
@@ -1351,7 +1892,7 @@ static TrgMenuBar *trg_main_window_menu_bar_new(TrgMainWindow *win)
         *b_local_prefs, *b_remote_prefs, *b_about, *b_view_states, *b_view_notebook, *b_view_stats,
         *b_add_url, *b_quit, *b_move, *b_reannounce, *b_pause_all, *b_resume_all, *b_dir_filters,
         *b_tracker_filters, *b_directories_first, *b_up_queue, *b_down_queue, *b_top_queue,
-        *b_bottom_queue, *b_start_now, *b_copy_magnetlink;
+        *b_bottom_queue, *b_start_now, *b_copy_magnetlink, *b_view_diagnostics, *b_view_daemons;
 
     TrgMenuBar *menuBar;
     GtkAccelGroup *accel_group;
@@ -1372,7 +1913,9 @@ static TrgMenuBar *trg_main_window_menu_bar_new(TrgMainWindow *win)
         &b_about, "quit-button", &b_quit, "dir-filters", &b_dir_filters, "tracker-filters",
         &b_tracker_filters, TRG_PREFS_KEY_DIRECTORIES_FIRST, &b_directories_first, "up-queue",
         &b_up_queue, "down-queue", &b_down_queue, "top-queue", &b_top_queue, "bottom-queue",
-        &b_bottom_queue, "start-now", &b_start_now, "copymagnet-button", &b_copy_magnetlink, NULL);
+        &b_bottom_queue, "start-now", &b_start_now, "copymagnet-button", &b_copy_magnetlink,
+        "view-diagnostics-button", &b_view_diagnostics, "view-daemons-button", &b_view_daemons,
+        NULL);
 
     g_signal_connect(b_disconnect, "activate", G_CALLBACK(disconnect_cb), win);
     g_signal_connect(b_add, "activate", G_CALLBACK(add_cb), win);
@@ -1402,6 +1945,8 @@ static TrgMenuBar *trg_main_window_menu_bar_new(TrgMainWindow *win)
                      G_CALLBACK(main_window_toggle_directories_first), win);
     g_signal_connect(b_view_states, "toggled", G_CALLBACK(view_states_toggled_cb), win);
     g_signal_connect(b_view_stats, "activate", G_CALLBACK(view_stats_toggled_cb), win);
+    g_signal_connect(b_view_diagnostics, "activate", G_CALLBACK(view_diagnostics_cb), win);
+    g_signal_connect(b_view_daemons, "activate", G_CALLBACK(view_daemons_cb), win);
     g_signal_connect(b_props, "activate", G_CALLBACK(open_props_cb), win);
     g_signal_connect(b_copy_magnetlink, "activate", G_CALLBACK(copy_magnetlink_cb), win);
     g_signal_connect(b_quit, "activate", G_CALLBACK(quit_cb), win);
@@ -1801,10 +2346,12 @@ static void trg_main_window_set_hidden_to_tray(TrgMainWindow *win, gboolean hidd
         gtk_window_deiconify(GTK_WINDOW(win));
         gtk_window_present(GTK_WINDOW(win));
 
-        if (win->timerId > 0) {
+        /* A single full poll brings everything left alone while hidden up
+         * to date. Not while backing off, which would undo the wait. */
+        if (win->timerId > 0 && win->breaker == TRG_BREAKER_CLOSED
+            && trg_client_get_failcount(win->client) == 0) {
             g_clear_handle_id(&win->timerId, g_source_remove);
-            dispatch_rpc_async(win->client, torrent_get(TORRENT_GET_TAG_MODE_FULL),
-                               on_torrent_get_update, win);
+            trg_main_window_dispatch_poll(win, TORRENT_GET_TAG_MODE_FULL, on_torrent_get_update);
         }
     }
 
@@ -1942,6 +2489,7 @@ static GObject *trg_main_window_constructor(GType type, guint n_construct_proper
 
     g_signal_connect(G_OBJECT(self), "delete-event", G_CALLBACK(delete_event), NULL);
     g_signal_connect(G_OBJECT(self), "destroy", G_CALLBACK(destroy_window), NULL);
+    trg_trace_watch_frames(GTK_WIDGET(self));
     g_signal_connect(G_OBJECT(self), "configure-event", G_CALLBACK(trg_main_window_config_event),
                      NULL);
     g_signal_connect(G_OBJECT(self), "key-press-event", G_CALLBACK(window_key_press_handler), NULL);
@@ -1989,6 +2537,11 @@ static GObject *trg_main_window_constructor(GType type, guint n_construct_proper
 
     g_signal_connect(G_OBJECT(self->filterEntry), "changed", G_CALLBACK(entry_filter_changed_cb),
                      self);
+    g_signal_connect(G_OBJECT(self->filterEntry), "populate-popup",
+                     G_CALLBACK(filter_entry_populate_popup_cb), self);
+    gtk_widget_set_tooltip_text(self->filterEntry,
+                                _("Filter by name, or with terms like ratio<1 size>10G "
+                                  "status:seeding tracker:example -name:foo"));
 
     gtk_box_pack_start(GTK_BOX(outerVbox), GTK_WIDGET(toolbarHbox), FALSE, FALSE, 0);
 
@@ -2006,7 +2559,8 @@ static GObject *trg_main_window_constructor(GType type, guint n_construct_proper
                     TRUE, TRUE);
 
     g_signal_connect(G_OBJECT(self->stateSelector), "torrent-state-changed",
-                     G_CALLBACK(torrent_state_selection_changed), self->filteredTorrentModel);
+                     G_CALLBACK(torrent_state_selection_changed), self);
+    trg_main_window_compile_filter(self);
 
     self->notebook = trg_main_window_notebook_new(self);
     gtk_paned_pack2(GTK_PANED(self->vpaned), self->notebook, FALSE, FALSE);
@@ -2044,6 +2598,12 @@ static GObject *trg_main_window_constructor(GType type, guint n_construct_proper
     trg_widget_set_visible(
         self->notebook, trg_prefs_get_bool(prefs, TRG_PREFS_KEY_SHOW_NOTEBOOK, TRG_PREFS_GLOBAL));
 
+    g_signal_connect(self->torrentTreeView, "columns-changed",
+                     G_CALLBACK(trg_main_window_derived_changed_cb), self);
+    g_signal_connect(self->sortedTorrentModel, "sort-column-changed",
+                     G_CALLBACK(trg_main_window_derived_changed_cb), self);
+    trg_main_window_update_derived(self);
+
     pos = trg_prefs_get_int(prefs, TRG_PREFS_KEY_STATES_PANED_POS, TRG_PREFS_GLOBAL);
     if (pos > 0)
         gtk_paned_set_position(GTK_PANED(self->hpaned), pos);
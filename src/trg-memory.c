@@ -0,0 +1,241 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Live accounting of where the client's memory goes: the JSON kept for each
+ * torrent row, the row references in the torrent model's ID table and the
+ * state selector, file tree nodes, peer rows and the string caches.
+ *
+ * Nothing is counted as it's allocated. Models register a function that
+ * walks what they hold, which is called for a snapshot while the diagnostics
+ * dialog's Memory page is showing or on SIGUSR1, when the breakdown is
+ * dumped to stderr.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#ifdef G_OS_UNIX
+#include <glib-unix.h>
+#include <signal.h>
+#endif
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+#include "trg-memory.h"
+#include "util.h"
+
+/* Rough sizes of structures private to GLib, GTK and json-glib on a 64-bit
+ * build, allowing for allocator overhead. Good enough to compare one build
+ * with the next, not to add up to what the process is using. */
+#define JSON_NODE_SIZE   48
+#define JSON_OBJECT_SIZE 160 /* the object, its members table and ordered list */
+#define JSON_MEMBER_SIZE 48  /* a table entry and ordered list link */
+#define JSON_ARRAY_SIZE  48
+#define HASH_TABLE_SIZE  96
+#define HASH_ENTRY_SIZE  24
+#define ROW_REF_SIZE     96 /* the reference, its path and the model's list link */
+#define ROW_SIZE         64 /* a list store sequence node or tree store GNode */
+#define CELL_SIZE        16 /* each column of each row */
+
+typedef struct {
+    GObject *object;
+    trg_memory_subsystem subsystem;
+    trg_memory_func func;
+} trg_memory_provider;
+
+static GSList *providers = NULL;
+
+static const gchar *const subsystem_names[TRG_MEMORY_COUNT] = {
+    [TRG_MEMORY_TORRENT_JSON] = N_("Torrent JSON"),
+    [TRG_MEMORY_TORRENT_ROW_REFS] = N_("Torrent row references"),
+    [TRG_MEMORY_STATE_ROW_REFS] = N_("State selector row references"),
+    [TRG_MEMORY_FILES_NODES] = N_("File tree nodes"),
+    [TRG_MEMORY_PEER_ROWS] = N_("Peer rows"),
+    [TRG_MEMORY_CACHED_STRINGS] = N_("Cached strings"),
+};
+
+const gchar *trg_memory_subsystem_name(trg_memory_subsystem subsystem)
+{
+    g_return_val_if_fail(subsystem < TRG_MEMORY_COUNT, NULL);
+
+    return _(subsystem_names[subsystem]);
+}
+
+static void trg_memory_provider_gone(gpointer data, GObject *where_the_object_was G_GNUC_UNUSED)
+{
+    providers = g_slist_remove(providers, data);
+    g_free(data);
+}
+
+/* Have func called with the object to count what it holds on every
+ * snapshot, until the object is finalized. Only used from the main loop. */
+void trg_memory_register(GObject *object, trg_memory_subsystem subsystem, trg_memory_func func)
+{
+    trg_memory_provider *provider = g_new(trg_memory_provider, 1);
+
+    provider->object = object;
+    provider->subsystem = subsystem;
+    provider->func = func;
+
+    providers = g_slist_prepend(providers, provider);
+    g_object_weak_ref(object, trg_memory_provider_gone, provider);
+}
+
+void trg_memory_snapshot(trg_memory_usage usage[TRG_MEMORY_COUNT])
+{
+    GSList *li;
+
+    memset(usage, 0, sizeof(trg_memory_usage) * TRG_MEMORY_COUNT);
+
+    for (li = providers; li; li = g_slist_next(li)) {
+        trg_memory_provider *provider = (trg_memory_provider *)li->data;
+        provider->func(provider->object, &usage[provider->subsystem]);
+    }
+
+    trg_util_cache_usage(&usage[TRG_MEMORY_CACHED_STRINGS]);
+}
+
+void trg_memory_dump(void)
+{
+    trg_memory_usage usage[TRG_MEMORY_COUNT];
+    guint64 total = 0;
+    gchar size[32];
+    guint i;
+
+    trg_memory_snapshot(usage);
+
+    g_printerr("%-32s %10s %12s\n", _("Subsystem"), _("Count"), _("Estimated"));
+
+    for (i = 0; i < TRG_MEMORY_COUNT; i++) {
+        trg_strlsize(size, usage[i].bytes);
+        g_printerr("%-32s %10" G_GUINT64_FORMAT " %12s\n", trg_memory_subsystem_name(i),
+                   usage[i].count, size);
+        total += usage[i].bytes;
+    }
+
+    trg_strlsize(size, total);
+    g_printerr("%-32s %10s %12s\n", _("Total"), "", size);
+}
+
+#ifdef G_OS_UNIX
+static gboolean trg_memory_signal_cb(gpointer data G_GNUC_UNUSED)
+{
+    trg_memory_dump();
+
+    return G_SOURCE_CONTINUE;
+}
+#endif
+
+/* Dump the accounting to stderr on SIGUSR1, where there are signals. */
+void trg_memory_init(void)
+{
+#ifdef G_OS_UNIX
+    g_unix_signal_add(SIGUSR1, trg_memory_signal_cb, NULL);
+#endif
+}
+
+static gsize json_node_size(JsonNode *node);
+
+static void json_member_size(JsonObject *obj G_GNUC_UNUSED, const gchar *name, JsonNode *node,
+                             gpointer data)
+{
+    gsize *size = (gsize *)data;
+
+    *size += JSON_MEMBER_SIZE + strlen(name) + 1 + json_node_size(node);
+}
+
+static gsize json_node_size(JsonNode *node)
+{
+    gsize size = JSON_NODE_SIZE;
+    JsonArray *array;
+    guint i, len;
+
+    switch (json_node_get_node_type(node)) {
+    case JSON_NODE_OBJECT:
+        size += trg_memory_json_object_size(json_node_get_object(node));
+        break;
+    case JSON_NODE_ARRAY:
+        array = json_node_get_array(node);
+        len = json_array_get_length(array);
+        size += JSON_ARRAY_SIZE + len * sizeof(gpointer);
+        for (i = 0; i < len; i++)
+            size += json_node_size(json_array_get_element(array, i));
+        break;
+    case JSON_NODE_VALUE:
+        if (json_node_get_value_type(node) == G_TYPE_STRING)
+            size += strlen(json_node_get_string(node)) + 1;
+        break;
+    default:
+        break;
+    }
+
+    return size;
+}
+
+gsize trg_memory_json_object_size(JsonObject *obj)
+{
+    gsize size = JSON_OBJECT_SIZE;
+
+    json_object_foreach_member(obj, json_member_size, &size);
+
+    return size;
+}
+
+gsize trg_memory_row_ref_size(void)
+{
+    return ROW_REF_SIZE;
+}
+
+/* The table and its entries, not what the keys and values point to. */
+gsize trg_memory_table_size(GHashTable *table)
+{
+    return HASH_TABLE_SIZE + g_hash_table_size(table) * HASH_ENTRY_SIZE;
+}
+
+static gboolean add_row(GtkTreeModel *model, GtkTreePath *path G_GNUC_UNUSED, GtkTreeIter *iter,
+                        gpointer data)
+{
+    trg_memory_usage *usage = (trg_memory_usage *)data;
+    gint i, n = gtk_tree_model_get_n_columns(model);
+
+    usage->count++;
+    usage->bytes += ROW_SIZE + n * CELL_SIZE;
+
+    for (i = 0; i < n; i++) {
+        if (gtk_tree_model_get_column_type(model, i) == G_TYPE_STRING) {
+            gchar *text;
+            gtk_tree_model_get(model, iter, i, &text, -1);
+            if (text)
+                usage->bytes += strlen(text) + 1;
+            g_free(text);
+        }
+    }
+
+    return FALSE;
+}
+
+/* Count every row of a list or tree store, with its string columns. */
+void trg_memory_add_rows(GtkTreeModel *model, trg_memory_usage *usage)
+{
+    gtk_tree_model_foreach(model, add_row, usage);
+}
@@ -0,0 +1,54 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+/* What the memory held by the client is broken down into. */
+typedef enum {
+    TRG_MEMORY_TORRENT_JSON,
+    TRG_MEMORY_TORRENT_ROW_REFS,
+    TRG_MEMORY_STATE_ROW_REFS,
+    TRG_MEMORY_FILES_NODES,
+    TRG_MEMORY_PEER_ROWS,
+    TRG_MEMORY_CACHED_STRINGS,
+    TRG_MEMORY_COUNT
+} trg_memory_subsystem;
+
+/* The bytes are an estimate, from the sizes of the structures involved
+ * rather than from the allocator. */
+typedef struct {
+    guint64 count;
+    guint64 bytes;
+} trg_memory_usage;
+
+typedef void (*trg_memory_func)(GObject *object, trg_memory_usage *usage);
+
+void trg_memory_init(void);
+void trg_memory_register(GObject *object, trg_memory_subsystem subsystem, trg_memory_func func);
+const gchar *trg_memory_subsystem_name(trg_memory_subsystem subsystem);
+void trg_memory_snapshot(trg_memory_usage usage[TRG_MEMORY_COUNT]);
+void trg_memory_dump(void);
+
+gsize trg_memory_json_object_size(JsonObject *obj);
+gsize trg_memory_row_ref_size(void);
+gsize trg_memory_table_size(GHashTable *table);
+void trg_memory_add_rows(GtkTreeModel *model, trg_memory_usage *usage);
@@ -51,6 +51,8 @@ enum {
     PROP_LOCAL_PREFS_BUTTON,
     PROP_ABOUT_BUTTON,
     PROP_VIEW_STATS_BUTTON,
+    PROP_VIEW_DIAGNOSTICS_BUTTON,
+    PROP_VIEW_DAEMONS_BUTTON,
     PROP_VIEW_STATES_BUTTON,
     PROP_VIEW_NOTEBOOK_BUTTON,
     PROP_QUIT,
@@ -94,6 +96,8 @@ struct _TrgMenuBar {
     GtkWidget *mb_view_states;
     GtkWidget *mb_view_notebook;
     GtkWidget *mb_view_stats;
+    GtkWidget *mb_view_diagnostics;
+    GtkWidget *mb_view_daemons;
     GtkWidget *mb_about;
     GtkWidget *mb_quit;
     GtkWidget *mb_directory_filters;
@@ -258,6 +262,12 @@ static void trg_menu_bar_get_property(GObject *object, guint property_id, GValue
     case PROP_VIEW_STATS_BUTTON:
         g_value_set_object(value, self->mb_view_stats);
         break;
+    case PROP_VIEW_DIAGNOSTICS_BUTTON:
+        g_value_set_object(value, self->mb_view_diagnostics);
+        break;
+    case PROP_VIEW_DAEMONS_BUTTON:
+        g_value_set_object(value, self->mb_view_daemons);
+        break;
     case PROP_QUIT:
         g_value_set_object(value, self->mb_quit);
         break;
@@ -436,6 +446,12 @@ static GtkWidget *trg_menu_bar_view_menu_new(TrgMenuBar *mb)
     gtk_widget_set_sensitive(mb->mb_view_stats, FALSE);
     gtk_menu_shell_append(GTK_MENU_SHELL(viewMenu), mb->mb_view_stats);
 
+    mb->mb_view_daemons = gtk_menu_item_new_with_mnemonic(_("D_aemons"));
+    gtk_menu_shell_append(GTK_MENU_SHELL(viewMenu), mb->mb_view_daemons);
+
+    mb->mb_view_diagnostics = gtk_menu_item_new_with_mnemonic(_("_Diagnostics"));
+    gtk_menu_shell_append(GTK_MENU_SHELL(viewMenu), mb->mb_view_diagnostics);
+
     return view;
 }
 
@@ -671,6 +687,10 @@ static void trg_menu_bar_class_init(TrgMenuBarClass *klass)
                                      "About Button");
     trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_STATS_BUTTON, "view-stats-button",
                                      "View stats button");
+    trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_DIAGNOSTICS_BUTTON,
+                                     "view-diagnostics-button", "View diagnostics button");
+    trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_DAEMONS_BUTTON, "view-daemons-button",
+                                     "View daemons button");
     trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_STATES_BUTTON, "view-states-button",
                                      "View states Button");
     trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_NOTEBOOK_BUTTON,
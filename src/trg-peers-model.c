@@ -27,6 +27,7 @@
 
 #include "torrent.h"
 #include "trg-client.h"
+#include "trg-memory.h"
 #include "trg-model.h"
 #include "trg-peers-model.h"
 #include "trg-tree-view.h"
@@ -177,9 +178,13 @@ void trg_peers_model_update(TrgPeersModel *model, TrgTreeView *tv, gint64 update
         trg_model_remove_removed(GTK_LIST_STORE(model), PEERSCOL_UPDATESERIAL, updateSerial);
 }
 
-static void trg_peers_model_init(TrgPeersModel *self)
+static void trg_peers_model_usage(GObject *object, trg_memory_usage *usage)
 {
+    trg_memory_add_rows(GTK_TREE_MODEL(object), usage);
+}
 
+static void trg_peers_model_init(TrgPeersModel *self)
+{
     GType column_types[PEERSCOL_COLUMNS];
 
     column_types[PEERSCOL_ICON] = G_TYPE_STRING;
@@ -193,6 +198,8 @@ static void trg_peers_model_init(TrgPeersModel *self)
     column_types[PEERSCOL_UPDATESERIAL] = G_TYPE_INT64;
 
     gtk_list_store_set_column_types(GTK_LIST_STORE(self), PEERSCOL_COLUMNS, column_types);
+
+    trg_memory_register(G_OBJECT(self), TRG_MEMORY_PEER_ROWS, trg_peers_model_usage);
 }
 
 TrgPeersModel *trg_peers_model_new(void)
@@ -618,6 +618,8 @@ static GtkWidget *trg_prefs_serverPage(TrgPreferencesDialog *dlg)
     hig_workarea_add_section_title(t, &row, _("Connection"));
 
     w = trgp_entry_new(dlg, TRG_PREFS_KEY_HOSTNAME, TRG_PREFS_PROFILE);
+    gtk_widget_set_tooltip_text(w, _("A host name or address, or unix:/path/to/socket for a "
+                                     "daemon listening on a Unix domain socket."));
     hig_workarea_add_row(t, &row, _("Host:"), w, NULL);
 
     w = trgp_spin_new(dlg, TRG_PREFS_KEY_PORT, 1, 65535, 1, TRG_PREFS_PROFILE, NULL);
@@ -642,10 +644,16 @@ static GtkWidget *trg_prefs_serverPage(TrgPreferencesDialog *dlg)
                        TRG_PREFS_PROFILE, GTK_TOGGLE_BUTTON(w));
     hig_workarea_add_wide_control(t, &row, w);
 
+    w = trgp_check_new(dlg, _("Accept compressed responses"), TRG_PREFS_KEY_COMPRESSION,
+                       TRG_PREFS_PROFILE, NULL);
+    hig_workarea_add_wide_control(t, &row, w);
+
     w = trgp_spin_new(dlg, TRG_PREFS_KEY_TIMEOUT, 1, 3600, 1, TRG_PREFS_PROFILE, NULL);
     hig_workarea_add_row(t, &row, _("Timeout:"), w, NULL);
 
     w = trgp_spin_new(dlg, TRG_PREFS_KEY_RETRIES, 0, 3600, 1, TRG_PREFS_PROFILE, NULL);
+    gtk_widget_set_tooltip_text(w, _("Failed updates retried, each after a longer wait, before "
+                                     "polling stops until the daemon answers again."));
     hig_workarea_add_row(t, &row, _("Retries:"), w, NULL);
 
     hig_workarea_add_section_title(t, &row, _("Headers"));
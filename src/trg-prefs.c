@@ -107,6 +107,7 @@ static void trg_prefs_create_defaults(TrgPrefs *p)
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_DIRECTORIES_FIRST);
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_ADD_OPTIONS_DIALOG);
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_SHOW_STATE_SELECTOR);
+    trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_COMPRESSION);
     // trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_SHOW_NOTEBOOK);
 }
 
@@ -224,6 +225,18 @@ JsonNode *trg_prefs_get_value(TrgPrefs *p, const gchar *key, int type, int flags
     return NULL;
 }
 
+/* A value from a profile other than the current one, or its default. */
+JsonNode *trg_prefs_get_profile_value(TrgPrefs *p, JsonObject *profile, const gchar *key)
+{
+    if (json_object_has_member(profile, key))
+        return json_object_get_member(profile, key);
+
+    if (p->defaultsObj && json_object_has_member(p->defaultsObj, key))
+        return json_object_get_member(p->defaultsObj, key);
+
+    return NULL;
+}
+
 void trg_prefs_set_connection(TrgPrefs *p, JsonObject *profile)
 {
     g_clear_pointer(&p->connectionObj, json_object_unref);
@@ -42,6 +42,7 @@
 #define TRG_PREFS_KEY_AUTO_CONNECT            "auto-connect"
 #define TRG_PREFS_KEY_SSL                     "ssl"
 #define TRG_PREFS_KEY_SSL_VALIDATE            "ssl-validate"
+#define TRG_PREFS_KEY_COMPRESSION             "compression"
 #define TRG_PREFS_KEY_TIMEOUT                 "timeout"
 #define TRG_PREFS_KEY_RETRIES                 "retries"
 #define TRG_PREFS_KEY_UPDATE_INTERVAL         "update-interval"
@@ -54,6 +55,7 @@
 #define TRG_PREFS_KEY_FILTER_TRACKERS         "filter-trackers"
 #define TRG_PREFS_KEY_DIRECTORIES_FIRST       "directories-first"
 #define TRG_PREFS_KEY_FILTER_DIRS             "filter-dirs"
+#define TRG_PREFS_KEY_SAVED_QUERIES           "saved-queries"
 #define TRG_PREFS_KEY_SHOW_STATE_SELECTOR     "show-state-selector"
 #define TRG_PREFS_KEY_SHOW_NOTEBOOK           "show-notebook"
 #define TRG_PREFS_KEY_LAST_TORRENT_DIR        "last-torrent-dir"
@@ -62,6 +64,7 @@
 #define TRG_PREFS_KEY_UPDATE_ACTIVE_ONLY      "update-active-only"
 #define TRG_PREFS_KEY_DELETE_LOCAL_TORRENT    "delete-local-torrent"
 #define TRG_PREFS_STATE_SELECTOR_LAST         "state-selector-last"
+#define TRG_PREFS_STATE_SELECTOR_LAST_QUERY   "state-selector-last-query"
 #define TRG_PREFS_ACTIVEONLY_FULLSYNC_ENABLED "activeonly-fullsync-enabled"
 #define TRG_PREFS_ACTIVEONLY_FULLSYNC_EVERY   "activeonly-fullsync-every"
 #define TRG_PREFS_KEY_STYLE                   "style"
@@ -102,6 +105,7 @@ void trg_prefs_add_default_double(TrgPrefs *p, const gchar *key, double value);
 void trg_prefs_add_default_bool_true(TrgPrefs *p, const gchar *key);
 
 JsonNode *trg_prefs_get_value(TrgPrefs *p, const gchar *key, int type, int flags);
+JsonNode *trg_prefs_get_profile_value(TrgPrefs *p, JsonObject *profile, const gchar *key);
 gchar *trg_prefs_get_string(TrgPrefs *p, const gchar *key, int flags);
 gint64 trg_prefs_get_int(TrgPrefs *p, const gchar *key, int flags);
 gdouble trg_prefs_get_double(TrgPrefs *p, const gchar *key, int flags);
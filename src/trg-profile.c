@@ -0,0 +1,186 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Opt-in timing of the client's hot paths: response parsing, the torrent
+ * model update in each mode, refiltering, resorting, the state selector,
+ * the files model and .torrent parsing.
+ *
+ * Run with TRG_PROFILE=/path/to/file.json and, on exit, each stage's call
+ * count and total, min, max and mean durations (in microseconds) are
+ * written there, so the same session replayed against two builds can be
+ * compared.
+ *
+ * Call sites time themselves with one trg_span_start()/trg_span_stop()
+ * pair, which feeds both these totals and, under TRG_TRACE, a trace event
+ * (see trg-trace.c). With neither set, trg_span_start() returns 0 and
+ * nothing else is done.
+ *
+ * Stages can nest: a model update includes the state selector refresh its
+ * signals trigger.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "json.h"
+#include "trg-profile.h"
+#include "trg-trace.h"
+
+typedef struct {
+    guint64 count;
+    gint64 total;
+    gint64 min;
+    gint64 max;
+} trg_profile_times;
+
+static const gchar *const trg_profile_names[TRG_PROFILE_COUNT] = {
+    "rpc-parse",
+    "model-update-first",
+    "model-update-active",
+    "model-update-interaction",
+    "model-update",
+    "refilter",
+    "sort",
+    "state-selector",
+    "files-model",
+    "torrent-file",
+};
+
+static trg_profile_times trg_profile_stages[TRG_PROFILE_COUNT];
+static gint trg_profile_state = -1;
+
+/* .torrent files are parsed off the main loop when adding. */
+G_LOCK_DEFINE_STATIC(trg_profile);
+
+static gboolean trg_profile_enabled(void)
+{
+    if (G_UNLIKELY(trg_profile_state < 0))
+        trg_profile_state = g_getenv("TRG_PROFILE") != NULL;
+
+    return trg_profile_state;
+}
+
+/* Returns a start time to pass to trg_span_stop(), or 0 if neither
+ * profiling nor tracing is on. */
+gint64 trg_span_start(void)
+{
+    return trg_trace_enabled || trg_profile_enabled() ? g_get_monotonic_time() : 0;
+}
+
+/* End a span: add it to stage (unless TRG_PROFILE_NONE) and trace it as
+ * name in category. Returns its duration, so work done in several chunks
+ * can be totalled with trg_profile_add(). */
+gint64 trg_span_stop(trg_profile_stage stage, const gchar *category, const gchar *name,
+                     gint64 start)
+{
+    gint64 usec;
+
+    if (start <= 0)
+        return 0;
+
+    usec = g_get_monotonic_time() - start;
+
+    if (stage != TRG_PROFILE_NONE)
+        trg_profile_add(stage, usec);
+
+    trg_trace_span(category, name, start);
+
+    return usec;
+}
+
+/* Record a duration measured some other way, such as the sum of the chunks
+ * of an update spread over idle callbacks. */
+void trg_profile_add(trg_profile_stage stage, gint64 usec)
+{
+    trg_profile_times *times;
+
+    if (stage == TRG_PROFILE_NONE || !trg_profile_enabled())
+        return;
+
+    G_LOCK(trg_profile);
+
+    times = &trg_profile_stages[stage];
+    if (times->count == 0 || usec < times->min)
+        times->min = usec;
+    if (usec > times->max)
+        times->max = usec;
+    times->total += usec;
+    times->count++;
+
+    G_UNLOCK(trg_profile);
+}
+
+void trg_profile_write(void)
+{
+    g_autoptr(JsonBuilder) builder = NULL;
+    g_autoptr(JsonGenerator) generator = NULL;
+    g_autoptr(JsonNode) root = NULL;
+    g_autoptr(GError) error = NULL;
+    const gchar *filename;
+    guint i;
+
+    if (!trg_profile_enabled())
+        return;
+
+    filename = g_getenv("TRG_PROFILE");
+    builder = json_builder_new();
+
+    json_builder_begin_object(builder);
+    json_builder_set_member_name(builder, "version");
+    json_builder_add_string_value(builder, PACKAGE_VERSION);
+    json_builder_set_member_name(builder, "stages");
+    json_builder_begin_object(builder);
+
+    G_LOCK(trg_profile);
+
+    for (i = 0; i < TRG_PROFILE_COUNT; i++) {
+        trg_profile_times *times = &trg_profile_stages[i];
+
+        if (times->count == 0)
+            continue;
+
+        json_builder_set_member_name(builder, trg_profile_names[i]);
+        json_builder_begin_object(builder);
+        json_builder_set_member_name(builder, "count");
+        json_builder_add_int_value(builder, times->count);
+        json_builder_set_member_name(builder, "total-us");
+        json_builder_add_int_value(builder, times->total);
+        json_builder_set_member_name(builder, "min-us");
+        json_builder_add_int_value(builder, times->min);
+        json_builder_set_member_name(builder, "max-us");
+        json_builder_add_int_value(builder, times->max);
+        json_builder_set_member_name(builder, "mean-us");
+        json_builder_add_int_value(builder, times->total / times->count);
+        json_builder_end_object(builder);
+    }
+
+    G_UNLOCK(trg_profile);
+
+    json_builder_end_object(builder);
+    json_builder_end_object(builder);
+
+    root = json_builder_get_root(builder);
+    generator = trg_json_serializer(root, TRUE);
+
+    if (!json_generator_to_file(generator, filename, &error))
+        g_warning("unable to write profile to %s: %s", filename, error->message);
+}
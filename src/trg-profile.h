@@ -0,0 +1,47 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <glib.h>
+
+/* The hot paths timed when TRG_PROFILE is set. TRG_PROFILE_NONE is for
+ * spans that are only traced. */
+typedef enum {
+    TRG_PROFILE_NONE = -1,
+    TRG_PROFILE_RPC_PARSE,
+    TRG_PROFILE_MODEL_FIRST,
+    TRG_PROFILE_MODEL_ACTIVE,
+    TRG_PROFILE_MODEL_INTERACTION,
+    TRG_PROFILE_MODEL_UPDATE,
+    TRG_PROFILE_REFILTER,
+    TRG_PROFILE_SORT,
+    TRG_PROFILE_STATE_SELECTOR,
+    TRG_PROFILE_FILES_MODEL,
+    TRG_PROFILE_TORRENT_FILE,
+    TRG_PROFILE_COUNT
+} trg_profile_stage;
+
+/* The model update stage for a TORRENT_GET_MODE_*. */
+#define TRG_PROFILE_MODEL_MODE(mode) ((trg_profile_stage)(TRG_PROFILE_MODEL_FIRST + (mode)))
+
+gint64 trg_span_start(void);
+gint64 trg_span_stop(trg_profile_stage stage, const gchar *category, const gchar *name,
+                     gint64 start);
+void trg_profile_add(trg_profile_stage stage, gint64 usec);
+void trg_profile_write(void);
@@ -23,11 +23,14 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 #include <json-glib/json-glib.h>
+#include <string.h>
 
 #include "torrent.h"
 #include "trg-cell-renderer-counter.h"
 #include "trg-client.h"
+#include "trg-memory.h"
 #include "trg-prefs.h"
+#include "trg-profile.h"
 #include "trg-state-selector.h"
 #include "trg-torrent-model.h"
 #include "util.h"
@@ -54,7 +57,7 @@ struct _TrgStateSelector {
     TrgPrefs *prefs;
     GHashTable *trackers;
     GHashTable *directories;
-    GRegex *urlHostRegex;
+    GHashTable *torrents;
     gint n_categories;
     GtkListStore *store;
     GtkTreeRowReference *error_rr;
@@ -73,11 +76,6 @@ struct _TrgStateSelector {
 G_DEFINE_TYPE(TrgStateSelector, trg_state_selector, GTK_TYPE_TREE_VIEW)
 #define TRG_STATE_SELECTOR_GET_PRIVATE(o)
 
-GRegex *trg_state_selector_get_url_host_regex(TrgStateSelector *s)
-{
-    return s->urlHostRegex;
-}
-
 guint32 trg_state_selector_get_flag(TrgStateSelector *s)
 {
     return s->flag;
@@ -88,16 +86,24 @@ static void state_selection_changed(GtkTreeSelection *selection, gpointer data)
     GtkTreeIter iter;
     GtkTreeModel *stateModel;
     guint index = 0;
+    g_autofree gchar *name = NULL;
 
     TrgStateSelector *self = TRG_STATE_SELECTOR(data);
 
     if (gtk_tree_selection_get_selected(selection, &stateModel, &iter))
         gtk_tree_model_get(stateModel, &iter, STATE_SELECTOR_BIT, &self->flag, STATE_SELECTOR_INDEX,
-                           &index, -1);
+                           &index, STATE_SELECTOR_NAME, &name, -1);
     else
         self->flag = 0;
 
+    /* Saved queries move as others are added and removed, so they're
+     * remembered by their text rather than their position. */
+    if (self->flag & FILTER_FLAG_QUERY)
+        index = 0;
+
     trg_prefs_set_int(self->prefs, TRG_PREFS_STATE_SELECTOR_LAST, index, TRG_PREFS_GLOBAL);
+    trg_prefs_set_string(self->prefs, TRG_PREFS_STATE_SELECTOR_LAST_QUERY,
+                         self->flag & FILTER_FLAG_QUERY ? name : "", TRG_PREFS_GLOBAL);
 
     g_signal_emit(TRG_STATE_SELECTOR(data), signals[SELECTOR_STATE_CHANGED], 0, self->flag);
 }
@@ -110,32 +116,6 @@ static GtkTreeRowReference *quick_tree_ref_new(GtkTreeModel *model, GtkTreeIter
     return rr;
 }
 
-struct cruft_remove_args {
-    GHashTable *table;
-    gint64 serial;
-};
-
-static gboolean trg_state_selector_remove_cruft(gpointer key, gpointer value, gpointer data)
-{
-    struct cruft_remove_args *args = (struct cruft_remove_args *)data;
-    GtkTreeRowReference *rr = (GtkTreeRowReference *)value;
-    GtkTreeModel *model = gtk_tree_row_reference_get_model(rr);
-    GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
-    gboolean remove;
-
-    GtkTreeIter iter;
-    gint64 currentSerial;
-
-    gtk_tree_model_get_iter(model, &iter, path);
-    gtk_tree_model_get(model, &iter, STATE_SELECTOR_SERIAL, &currentSerial, -1);
-
-    remove = (args->serial != currentSerial);
-
-    gtk_tree_path_free(path);
-
-    return remove;
-}
-
 gchar *trg_state_selector_get_selected_text(TrgStateSelector *s)
 {
     GtkTreeSelection *sel = gtk_tree_view_get_selection(GTK_TREE_VIEW(s));
@@ -149,42 +129,51 @@ gchar *trg_state_selector_get_selected_text(TrgStateSelector *s)
     return name;
 }
 
-static void trg_state_selector_update_dynamic_filter(GtkTreeModel *model, GtkTreeRowReference *rr,
-                                                     gint64 serial)
+static void refresh_statelist_cb(GtkWidget *w, gpointer data)
+{
+    trg_state_selector_rebuild(TRG_STATE_SELECTOR(data));
+}
+
+/* Saved filter queries, kept as an array of strings in the global prefs. */
+static JsonArray *trg_state_selector_get_queries(TrgStateSelector *s, gboolean create)
 {
+    JsonNode *node = trg_prefs_get_value(s->prefs, TRG_PREFS_KEY_SAVED_QUERIES, JSON_NODE_ARRAY,
+                                         TRG_PREFS_GLOBAL | (create ? TRG_PREFS_NEWNODE : 0));
+
+    if (node && create && !json_node_get_array(node))
+        json_node_take_array(node, json_array_new());
+
+    return node ? json_node_get_array(node) : NULL;
+}
+
+static void remove_query_cb(GtkWidget *w G_GNUC_UNUSED, gpointer data)
+{
+    TrgStateSelector *s = TRG_STATE_SELECTOR(data);
+    GtkTreeSelection *sel = gtk_tree_view_get_selection(GTK_TREE_VIEW(s));
+    JsonArray *queries = trg_state_selector_get_queries(s, FALSE);
+    GtkTreeModel *model;
     GtkTreeIter iter;
-    GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
-    gint64 oldSerial;
-    GValue gvalue = G_VALUE_INIT;
-    gint oldCount;
+    gchar *query;
+    guint i;
 
-    gtk_tree_model_get_iter(model, &iter, path);
-    gtk_tree_model_get(model, &iter, STATE_SELECTOR_SERIAL, &oldSerial, STATE_SELECTOR_COUNT,
-                       &oldCount, -1);
+    if (!(s->flag & FILTER_FLAG_QUERY) || !gtk_tree_selection_get_selected(sel, &model, &iter))
+        return;
 
-    if (oldSerial != serial) {
-        g_value_init(&gvalue, G_TYPE_INT);
-        g_value_set_int(&gvalue, 1);
-        gtk_list_store_set_value(GTK_LIST_STORE(model), &iter, STATE_SELECTOR_COUNT, &gvalue);
+    gtk_tree_model_get(model, &iter, STATE_SELECTOR_NAME, &query, -1);
 
-        memset(&gvalue, 0, sizeof(GValue));
-        g_value_init(&gvalue, G_TYPE_INT64);
-        g_value_set_int64(&gvalue, serial);
-        gtk_list_store_set_value(GTK_LIST_STORE(model), &iter, STATE_SELECTOR_SERIAL, &gvalue);
-    } else {
-        g_value_init(&gvalue, G_TYPE_INT);
-        g_value_set_int(&gvalue, ++oldCount);
-        gtk_list_store_set_value(GTK_LIST_STORE(model), &iter, STATE_SELECTOR_COUNT, &gvalue);
+    for (i = 0; queries && i < json_array_get_length(queries); i++) {
+        if (!g_strcmp0(json_array_get_string_element(queries, i), query)) {
+            json_array_remove_element(queries, i);
+            break;
+        }
     }
 
-    gtk_tree_path_free(path);
-}
+    gtk_list_store_remove(s->store, &iter);
+    s->n_categories--;
 
-static void refresh_statelist_cb(GtkWidget *w, gpointer data)
-{
-    TrgStateSelector *self = TRG_STATE_SELECTOR(data);
-    trg_client_inc_serial(self->client);
-    trg_state_selector_update(data, TORRENT_UPDATE_ADDREMOVE);
+    trg_prefs_changed_emit_signal(s->prefs, TRG_PREFS_KEY_SAVED_QUERIES);
+
+    g_free(query);
 }
 
 static void view_popup_menu(GtkWidget *treeview, GdkEventButton *event, gpointer data G_GNUC_UNUSED)
@@ -207,6 +196,12 @@ static void view_popup_menu(GtkWidget *treeview, GdkEventButton *event, gpointer
     g_signal_connect(item, "activate", G_CALLBACK(refresh_statelist_cb), treeview);
     gtk_menu_shell_append(GTK_MENU_SHELL(menu), item);
 
+    if (TRG_STATE_SELECTOR(treeview)->flag & FILTER_FLAG_QUERY) {
+        item = gtk_menu_item_new_with_label(_("Remove Query"));
+        g_signal_connect(item, "activate", G_CALLBACK(remove_query_cb), treeview);
+        gtk_menu_shell_append(GTK_MENU_SHELL(menu), item);
+    }
+
     gtk_widget_show_all(menu);
 
     gtk_menu_popup_at_pointer(GTK_MENU(menu), (GdkEvent *)event);
@@ -228,206 +223,264 @@ static gboolean view_onButtonPressed(GtkWidget *treeview, GdkEventButton *event,
     return FALSE;
 }
 
-struct state_find_pos {
-    int offset;
-    int range;
-    int pos;
-    const gchar *name;
+/* What a torrent is currently counted under, so it can be taken away again
+ * when the torrent is removed or its trackers/directory change. The hosts
+ * are interned by trg_uri_get_host() and aren't owned here. */
+struct state_selector_torrent {
+    gchar *dir;
+    GPtrArray *hosts;
 };
 
-static gboolean trg_state_selector_find_pos_foreach(GtkTreeModel *model, GtkTreePath *path,
-                                                    GtkTreeIter *iter, gpointer data)
+static void state_selector_torrent_free(gpointer data)
 {
-    struct state_find_pos *args = (struct state_find_pos *)data;
-    gchar *name;
-    gboolean res;
+    struct state_selector_torrent *st = (struct state_selector_torrent *)data;
 
-    if (args->pos < args->offset) {
-        args->pos++;
-        return FALSE;
-    } else if (args->range >= 0 && args->pos > args->offset + args->range - 1) {
-        return TRUE;
-    }
+    g_free(st->dir);
+    g_ptr_array_unref(st->hosts);
+    g_free(st);
+}
 
-    gtk_tree_model_get(model, iter, STATE_SELECTOR_NAME, &name, -1);
-    res = g_strcmp0(name, args->name) >= 0;
-    g_free(name);
+/* Binary search for where name belongs within the (sorted) range of rows
+ * starting at offset. A negative range means up to the end of the list. */
+static gint trg_state_selector_find_pos(TrgStateSelector *s, gint offset, gint range,
+                                        const gchar *name)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(s->store);
+    gint lo = offset;
+    gint hi = range < 0 ? gtk_tree_model_iter_n_children(model, NULL) : offset + range;
+
+    while (lo < hi) {
+        gint mid = lo + (hi - lo) / 2;
+        gchar *rowName = NULL;
+        GtkTreeIter iter;
 
-    if (!res)
-        args->pos++;
+        if (!gtk_tree_model_iter_nth_child(model, &iter, NULL, mid))
+            break;
 
-    return res;
+        gtk_tree_model_get(model, &iter, STATE_SELECTOR_NAME, &rowName, -1);
+
+        if (g_strcmp0(rowName, name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+
+        g_free(rowName);
+    }
+
+    return lo;
 }
 
-static void trg_state_selector_insert(TrgStateSelector *s, int offset, gint range,
-                                      const gchar *name, GtkTreeIter *iter)
+static gint trg_state_selector_adjust_count(GtkTreeRowReference *rr, gint delta)
 {
-    GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(s));
+    GtkTreeModel *model = gtk_tree_row_reference_get_model(rr);
+    GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
+    GtkTreeIter iter;
+    gint count = 0;
 
-    struct state_find_pos args;
-    args.offset = offset;
-    args.pos = 0;
-    args.range = range;
-    args.name = name;
+    if (path && gtk_tree_model_get_iter(model, &iter, path)) {
+        gtk_tree_model_get(model, &iter, STATE_SELECTOR_COUNT, &count, -1);
+        count += delta;
+        gtk_list_store_set(GTK_LIST_STORE(model), &iter, STATE_SELECTOR_COUNT, count, -1);
+    }
+
+    gtk_tree_path_free(path);
 
-    gtk_tree_model_foreach(model, trg_state_selector_find_pos_foreach, &args);
-    gtk_list_store_insert(GTK_LIST_STORE(model), iter, args.pos);
+    return count;
 }
 
-void trg_state_selector_update(TrgStateSelector *s, guint whatsChanged)
+static void trg_state_selector_index_inc(TrgStateSelector *s, gboolean isTracker,
+                                         const gchar *name)
 {
-    GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(s));
-    TrgClient *client = s->client;
-    gint64 updateSerial = trg_client_get_serial(client);
-    GList *torrentItemRefs;
-    GtkTreeIter torrentIter, iter;
-    GList *trackersList, *trackerItem, *li;
-    GtkTreeRowReference *rr;
-    GtkTreePath *path;
-    GtkTreeModel *torrentModel;
-    gpointer result;
-    struct cruft_remove_args cruft;
-
-    if (!trg_client_is_connected(client))
+    GHashTable *table = isTracker ? s->trackers : s->directories;
+    GtkTreeRowReference *rr = g_hash_table_lookup(table, name);
+    guint nDirs = g_hash_table_size(s->directories);
+    guint nTrackers = g_hash_table_size(s->trackers);
+    GtkTreeIter iter;
+    gint pos;
+
+    if (rr) {
+        trg_state_selector_adjust_count(rr, 1);
         return;
+    }
 
-    torrentItemRefs = g_hash_table_get_values(trg_client_get_torrent_table(client));
+    if (isTracker)
+        pos = s->dirsFirst
+            ? trg_state_selector_find_pos(s, s->n_categories + nDirs, -1, name)
+            : trg_state_selector_find_pos(s, s->n_categories, nTrackers, name);
+    else
+        pos = s->dirsFirst ? trg_state_selector_find_pos(s, s->n_categories, nDirs, name)
+                           : trg_state_selector_find_pos(s, s->n_categories + nTrackers, -1, name);
 
-    for (li = torrentItemRefs; li; li = g_list_next(li)) {
-        JsonObject *t = NULL;
-        rr = (GtkTreeRowReference *)li->data;
-        path = gtk_tree_row_reference_get_path(rr);
-        torrentModel = gtk_tree_row_reference_get_model(rr);
+    gtk_list_store_insert_with_values(
+        s->store, &iter, pos, STATE_SELECTOR_ICON, isTracker ? "network-workgroup" : "folder",
+        STATE_SELECTOR_NAME, name, STATE_SELECTOR_COUNT, 1, STATE_SELECTOR_BIT,
+        isTracker ? FILTER_FLAG_TRACKER : FILTER_FLAG_DIR, STATE_SELECTOR_INDEX, 0, -1);
 
-        if (path) {
-            if (gtk_tree_model_get_iter(torrentModel, &torrentIter, path)) {
-                gtk_tree_model_get(torrentModel, &torrentIter, TORRENT_COLUMN_JSON, &t, -1);
-            }
-            gtk_tree_path_free(path);
-        }
+    g_hash_table_insert(table, g_strdup(name), quick_tree_ref_new(GTK_TREE_MODEL(s->store), &iter));
+}
 
-        if (!t)
-            continue;
-
-        if (s->showTrackers && (whatsChanged & TORRENT_UPDATE_ADDREMOVE)) {
-            trackersList = json_array_get_elements(torrent_get_tracker_stats(t));
-            for (trackerItem = trackersList; trackerItem; trackerItem = g_list_next(trackerItem)) {
-                JsonObject *tracker = json_node_get_object((JsonNode *)trackerItem->data);
-                const gchar *announceUrl = tracker_stats_get_announce(tracker);
-                gchar *announceHost = trg_gregex_get_first(s->urlHostRegex, announceUrl);
-
-                if (!announceHost)
-                    continue;
-
-                result = g_hash_table_lookup(s->trackers, announceHost);
-
-                if (result) {
-                    trg_state_selector_update_dynamic_filter(model, (GtkTreeRowReference *)result,
-                                                             updateSerial);
-                    g_free(announceHost);
-                } else {
-                    if (s->dirsFirst) {
-                        trg_state_selector_insert(
-                            s, s->n_categories + g_hash_table_size(s->directories), -1,
-                            announceHost, &iter);
-                    } else {
-                        trg_state_selector_insert(s, s->n_categories,
-                                                  g_hash_table_size(s->trackers), announceHost,
-                                                  &iter);
-                    }
-                    gtk_list_store_set(GTK_LIST_STORE(model), &iter, STATE_SELECTOR_ICON,
-                                       "network-workgroup", STATE_SELECTOR_NAME, announceHost,
-                                       STATE_SELECTOR_SERIAL, updateSerial, STATE_SELECTOR_COUNT, 1,
-                                       STATE_SELECTOR_BIT, FILTER_FLAG_TRACKER,
-                                       STATE_SELECTOR_INDEX, 0, -1);
-                    g_hash_table_insert(s->trackers, announceHost,
-                                        quick_tree_ref_new(model, &iter));
-                }
-            }
-            g_list_free(trackersList);
-        }
+static void trg_state_selector_index_dec(TrgStateSelector *s, gboolean isTracker,
+                                         const gchar *name)
+{
+    GHashTable *table = isTracker ? s->trackers : s->directories;
+    GtkTreeRowReference *rr = g_hash_table_lookup(table, name);
 
-        if (s->showDirs
-            && ((whatsChanged & TORRENT_UPDATE_ADDREMOVE)
-                || (whatsChanged & TORRENT_UPDATE_PATH_CHANGE))) {
-            gchar *dir;
-            gtk_tree_model_get(torrentModel, &torrentIter, TORRENT_COLUMN_DOWNLOADDIR_SHORT, &dir,
-                               -1);
+    if (rr && trg_state_selector_adjust_count(rr, -1) < 1)
+        g_hash_table_remove(table, name);
+}
 
-            result = g_hash_table_lookup(s->directories, dir);
-            if (result) {
-                trg_state_selector_update_dynamic_filter(model, (GtkTreeRowReference *)result,
-                                                         updateSerial);
-            } else {
-                if (s->dirsFirst) {
-                    trg_state_selector_insert(s, s->n_categories, g_hash_table_size(s->directories),
-                                              dir, &iter);
-                } else {
-                    trg_state_selector_insert(s, s->n_categories + g_hash_table_size(s->trackers),
-                                              -1, dir, &iter);
-                }
-                gtk_list_store_set(GTK_LIST_STORE(model), &iter, STATE_SELECTOR_ICON, "folder",
-                                   STATE_SELECTOR_NAME, dir, STATE_SELECTOR_SERIAL, updateSerial,
-                                   STATE_SELECTOR_BIT, FILTER_FLAG_DIR, STATE_SELECTOR_COUNT, 1,
-                                   STATE_SELECTOR_INDEX, 0, -1);
-                g_hash_table_insert(s->directories, g_strdup(dir),
-                                    quick_tree_ref_new(model, &iter));
-            }
+static void trg_state_selector_release_torrent(TrgStateSelector *s,
+                                               struct state_selector_torrent *st)
+{
+    guint i;
+
+    for (i = 0; i < st->hosts->len; i++)
+        trg_state_selector_index_dec(s, TRUE, g_ptr_array_index(st->hosts, i));
+
+    if (st->dir)
+        trg_state_selector_index_dec(s, FALSE, st->dir);
+}
+
+/* Count a new or changed torrent under its tracker hosts and directory. The
+ * new entries are added before the old ones are taken away, so anything
+ * unchanged never drops to zero and keeps its row. */
+static void trg_state_selector_index_torrent(TrgStateSelector *s, GtkTreeModel *torrentModel,
+                                             GtkTreeIter *torrentIter)
+{
+    struct state_selector_torrent *st, *old;
+    JsonObject *t = NULL;
+    gchar *dir = NULL;
+    gint64 id, *idCopy;
+    guint i;
+
+    gtk_tree_model_get(torrentModel, torrentIter, TORRENT_COLUMN_JSON, &t, TORRENT_COLUMN_ID, &id,
+                       TORRENT_COLUMN_DOWNLOADDIR_SHORT, &dir, -1);
+
+    if (!t) {
+        g_free(dir);
+        return;
+    }
+
+    st = g_new0(struct state_selector_torrent, 1);
+    st->hosts = g_ptr_array_new();
 
-            g_free(dir);
+    if (s->showTrackers) {
+        JsonArray *trackers = torrent_get_tracker_stats(t);
+        guint n = json_array_get_length(trackers);
+
+        for (i = 0; i < n; i++) {
+            JsonObject *tracker = json_array_get_object_element(trackers, i);
+            const gchar *host = trg_uri_get_host(tracker_stats_get_announce(tracker));
+
+            if (host && !g_ptr_array_find(st->hosts, host, NULL))
+                g_ptr_array_add(st->hosts, (gpointer)host);
         }
     }
 
-    g_list_free(torrentItemRefs);
+    if (s->showDirs && dir)
+        st->dir = dir;
+    else
+        g_free(dir);
+
+    for (i = 0; i < st->hosts->len; i++)
+        trg_state_selector_index_inc(s, TRUE, g_ptr_array_index(st->hosts, i));
+
+    if (st->dir)
+        trg_state_selector_index_inc(s, FALSE, st->dir);
 
-    cruft.serial = trg_client_get_serial(client);
+    old = g_hash_table_lookup(s->torrents, &id);
+    if (old)
+        trg_state_selector_release_torrent(s, old);
 
-    if (s->showTrackers && ((whatsChanged & TORRENT_UPDATE_ADDREMOVE))) {
-        cruft.table = s->trackers;
-        g_hash_table_foreach_remove(s->trackers, trg_state_selector_remove_cruft, &cruft);
+    idCopy = g_new(gint64, 1);
+    *idCopy = id;
+    g_hash_table_replace(s->torrents, idCopy, st);
+}
+
+static void trg_state_selector_unindex_torrent(TrgStateSelector *s, gint64 id)
+{
+    struct state_selector_torrent *st = g_hash_table_lookup(s->torrents, &id);
+
+    if (st) {
+        trg_state_selector_release_torrent(s, st);
+        g_hash_table_remove(s->torrents, &id);
     }
+}
+
+static void trg_state_selector_clear_index(TrgStateSelector *s)
+{
+    g_hash_table_remove_all(s->torrents);
+    g_hash_table_remove_all(s->trackers);
+    g_hash_table_remove_all(s->directories);
+}
 
-    if (s->showDirs
-        && ((whatsChanged & TORRENT_UPDATE_ADDREMOVE)
-            || (whatsChanged & TORRENT_UPDATE_PATH_CHANGE))) {
-        cruft.table = s->directories;
-        g_hash_table_foreach_remove(s->directories, trg_state_selector_remove_cruft, &cruft);
+/* Throw away the tracker and directory entries and count every torrent again.
+ * Only needed when what's shown changes, normal updates are per torrent. */
+void trg_state_selector_rebuild(TrgStateSelector *s)
+{
+    TrgClient *client = s->client;
+    GHashTableIter hti;
+    gpointer value;
+
+    trg_state_selector_clear_index(s);
+
+    if (!trg_client_is_connected(client) || (!s->showTrackers && !s->showDirs))
+        return;
+
+    g_hash_table_iter_init(&hti, trg_client_get_torrent_table(client));
+    while (g_hash_table_iter_next(&hti, NULL, &value)) {
+        GtkTreeRowReference *rr = (GtkTreeRowReference *)value;
+        GtkTreeModel *torrentModel = gtk_tree_row_reference_get_model(rr);
+        GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
+        GtkTreeIter torrentIter;
+
+        if (path && gtk_tree_model_get_iter(torrentModel, &torrentIter, path))
+            trg_state_selector_index_torrent(s, torrentModel, &torrentIter);
+
+        gtk_tree_path_free(path);
     }
 }
 
 void trg_state_selector_set_show_dirs(TrgStateSelector *s, gboolean show)
 {
     s->showDirs = show;
-    if (!show)
-        g_hash_table_remove_all(s->directories);
-    else
-        trg_state_selector_update(s, TORRENT_UPDATE_PATH_CHANGE);
+    trg_state_selector_rebuild(s);
 }
 
 static void on_torrents_state_change(TrgTorrentModel *model, guint whatsChanged, gpointer data)
 {
     TrgStateSelector *selector = TRG_STATE_SELECTOR(data);
-    trg_state_selector_update(selector, whatsChanged);
 
-    if ((whatsChanged & TORRENT_UPDATE_ADDREMOVE) || (whatsChanged & TORRENT_UPDATE_STATE_CHANGE))
+    if ((whatsChanged & TORRENT_UPDATE_ADDREMOVE) || (whatsChanged & TORRENT_UPDATE_STATE_CHANGE)) {
+        gint64 start = trg_span_start();
         trg_state_selector_stats_update(selector, trg_torrent_model_get_stats(model));
+        trg_span_stop(TRG_PROFILE_STATE_SELECTOR, "state-selector", "stats-update", start);
+    }
+}
+
+static void on_torrent_index_changed(TrgTorrentModel *model, GtkTreeIter *iter, gpointer data)
+{
+    TrgStateSelector *selector = TRG_STATE_SELECTOR(data);
+
+    if (selector->showTrackers || selector->showDirs)
+        trg_state_selector_index_torrent(selector, GTK_TREE_MODEL(model), iter);
+}
+
+static void on_torrent_removed(TrgTorrentModel *model, gint64 *id, gpointer data)
+{
+    trg_state_selector_unindex_torrent(TRG_STATE_SELECTOR(data), *id);
 }
 
 void trg_state_selector_set_show_trackers(TrgStateSelector *s, gboolean show)
 {
     s->showTrackers = show;
-    if (!show)
-        g_hash_table_remove_all(s->trackers);
-    else
-        trg_state_selector_update(s, TORRENT_UPDATE_ADDREMOVE);
+    trg_state_selector_rebuild(s);
 }
 
 void trg_state_selector_set_directories_first(TrgStateSelector *s, gboolean _dirsFirst)
 {
     s->dirsFirst = _dirsFirst;
-    g_hash_table_remove_all(s->directories);
-    g_hash_table_remove_all(s->trackers);
-    trg_state_selector_update(s, TORRENT_UPDATE_ADDREMOVE);
+    trg_state_selector_rebuild(s);
 }
 
 static void trg_state_selector_add_state(TrgStateSelector *selector, GtkTreeIter *iter, gint pos,
@@ -481,12 +534,44 @@ static void trg_state_selector_update_stat(GtkTreeRowReference *rr, gint count)
     }
 }
 
+static gint trg_state_selector_row_index(GtkTreeRowReference *rr)
+{
+    GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
+    gint index = gtk_tree_path_get_indices(path)[0];
+
+    gtk_tree_path_free(path);
+
+    return index;
+}
+
+/* Saved queries go at the end of the categories, before the separator. */
+void trg_state_selector_add_query(TrgStateSelector *s, const gchar *query)
+{
+    JsonArray *queries = trg_state_selector_get_queries(s, TRUE);
+    GtkTreeIter iter;
+    guint i;
+
+    if (!query || !*query)
+        return;
+
+    for (i = 0; i < json_array_get_length(queries); i++)
+        if (!g_strcmp0(json_array_get_string_element(queries, i), query))
+            return;
+
+    json_array_add_string_element(queries, query);
+    trg_state_selector_add_state(s, &iter, s->n_categories - 1, "edit-find", (gchar *)query,
+                                 FILTER_FLAG_QUERY, NULL);
+
+    trg_prefs_changed_emit_signal(s->prefs, TRG_PREFS_KEY_SAVED_QUERIES);
+}
+
 void trg_state_selector_stats_update(TrgStateSelector *s, trg_torrent_model_update_stats *stats)
 {
     GtkTreeIter iter;
     if (stats->error > 0 && !s->error_rr) {
-        trg_state_selector_add_state(s, &iter, s->n_categories - 1, "dialog-warning", _("Error"),
-                                     TORRENT_FLAG_ERROR, &s->error_rr);
+        trg_state_selector_add_state(s, &iter, trg_state_selector_row_index(s->checking_rr) + 1,
+                                     "dialog-warning", _("Error"), TORRENT_FLAG_ERROR,
+                                     &s->error_rr);
 
     } else if (stats->error < 1 && s->error_rr) {
         remove_row_ref_and_free(s->error_rr);
@@ -516,8 +601,7 @@ void trg_state_selector_disconnect(TrgStateSelector *s)
         s->n_categories--;
     }
 
-    g_hash_table_remove_all(s->trackers);
-    g_hash_table_remove_all(s->directories);
+    trg_state_selector_clear_index(s);
 
     trg_state_selector_update_stat(s->all_rr, -1);
     trg_state_selector_update_stat(s->down_rr, -1);
@@ -537,11 +621,52 @@ static void trg_state_selector_init(TrgStateSelector *self)
 TrgStateSelector *trg_state_selector_new(TrgClient *client, TrgTorrentModel *tmodel)
 {
     TrgStateSelector *selector = g_object_new(TRG_TYPE_STATE_SELECTOR, "client", client, NULL);
-    g_signal_connect(tmodel, "torrents-state-change", G_CALLBACK(on_torrents_state_change),
-                     selector);
+    g_signal_connect_object(tmodel, "torrents-state-change", G_CALLBACK(on_torrents_state_change),
+                            selector, 0);
+    g_signal_connect_object(tmodel, "torrent-index-changed", G_CALLBACK(on_torrent_index_changed),
+                            selector, 0);
+    g_signal_connect_object(tmodel, "torrent-removed", G_CALLBACK(on_torrent_removed), selector,
+                            0);
     return selector;
 }
 
+static void add_refs_table_usage(GHashTable *table, trg_memory_usage *usage)
+{
+    GHashTableIter iter;
+    gpointer key;
+
+    if (!table)
+        return;
+
+    usage->bytes += trg_memory_table_size(table);
+
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        usage->count++;
+        usage->bytes += trg_memory_row_ref_size() + strlen(key) + 1;
+    }
+}
+
+static void trg_state_selector_refs_usage(GObject *object, trg_memory_usage *usage)
+{
+    TrgStateSelector *s = TRG_STATE_SELECTOR(object);
+    GtkTreeRowReference *states[] = { s->error_rr,      s->all_rr,        s->paused_rr,
+                                      s->down_rr,       s->seeding_rr,    s->complete_rr,
+                                      s->incomplete_rr, s->checking_rr,   s->active_rr,
+                                      s->seed_wait_rr,  s->down_wait_rr };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(states); i++) {
+        if (states[i]) {
+            usage->count++;
+            usage->bytes += trg_memory_row_ref_size();
+        }
+    }
+
+    add_refs_table_usage(s->trackers, usage);
+    add_refs_table_usage(s->directories, usage);
+}
+
 static GObject *trg_state_selector_constructor(GType type, guint n_construct_properties,
                                                GObjectConstructParam *construct_params)
 {
@@ -552,18 +677,24 @@ static GObject *trg_state_selector_constructor(GType type, guint n_construct_pro
     GtkCellRenderer *renderer;
     GtkTreeIter iter;
     gint index;
+    g_autofree gchar *lastQuery = NULL;
     GtkTreeSelection *selection;
+    JsonArray *queries;
+    guint i;
 
     object = G_OBJECT_CLASS(trg_state_selector_parent_class)
                  ->constructor(type, n_construct_properties, construct_params);
 
     selector = TRG_STATE_SELECTOR(object);
 
-    selector->urlHostRegex = trg_uri_host_regex_new();
     selector->trackers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
                                                (GDestroyNotify)remove_row_ref_and_free);
     selector->directories = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
                                                   (GDestroyNotify)remove_row_ref_and_free);
+    selector->torrents = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free,
+                                               state_selector_torrent_free);
+
+    trg_memory_register(object, TRG_MEMORY_STATE_ROW_REFS, trg_state_selector_refs_usage);
 
     gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(object), FALSE);
 
@@ -583,7 +714,7 @@ static GObject *trg_state_selector_constructor(GType type, guint n_construct_pro
 
     store = selector->store
         = gtk_list_store_new(STATE_SELECTOR_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT,
-                             G_TYPE_UINT, G_TYPE_INT64, G_TYPE_UINT);
+                             G_TYPE_UINT, G_TYPE_UINT);
     gtk_tree_view_set_model(GTK_TREE_VIEW(object), GTK_TREE_MODEL(store));
 
     trg_state_selector_add_state(selector, &iter, -1, "help-about", _("All"), 0, &selector->all_rr);
@@ -605,6 +736,13 @@ static GObject *trg_state_selector_constructor(GType type, guint n_construct_pro
                                  TORRENT_FLAG_ACTIVE, &selector->active_rr);
     trg_state_selector_add_state(selector, &iter, -1, "view-refresh", _("Checking"),
                                  TORRENT_FLAG_CHECKING_ANY, &selector->checking_rr);
+
+    queries = trg_state_selector_get_queries(selector, FALSE);
+    for (i = 0; queries && i < json_array_get_length(queries); i++)
+        trg_state_selector_add_state(selector, &iter, -1, "edit-find",
+                                     (gchar *)json_array_get_string_element(queries, i),
+                                     FILTER_FLAG_QUERY, NULL);
+
     trg_state_selector_add_state(selector, &iter, -1, NULL, NULL, 0, NULL);
 
     gtk_tree_view_set_rubber_banding(GTK_TREE_VIEW(object), TRUE);
@@ -618,7 +756,27 @@ static GObject *trg_state_selector_constructor(GType type, guint n_construct_pro
     gtk_tree_view_set_search_column(GTK_TREE_VIEW(object), STATE_SELECTOR_NAME);
 
     index = trg_prefs_get_int(selector->prefs, TRG_PREFS_STATE_SELECTOR_LAST, TRG_PREFS_GLOBAL);
-    if (index > 0 && gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(store), &iter, NULL, index)) {
+    lastQuery = trg_prefs_get_string(selector->prefs, TRG_PREFS_STATE_SELECTOR_LAST_QUERY,
+                                     TRG_PREFS_GLOBAL);
+    if (lastQuery && *lastQuery) {
+        GtkTreeModel *model = GTK_TREE_MODEL(store);
+        gboolean valid;
+
+        for (valid = gtk_tree_model_get_iter_first(model, &iter); valid;
+             valid = gtk_tree_model_iter_next(model, &iter)) {
+            g_autofree gchar *name = NULL;
+            guint32 flag;
+
+            gtk_tree_model_get(model, &iter, STATE_SELECTOR_BIT, &flag, STATE_SELECTOR_NAME, &name,
+                               -1);
+
+            if ((flag & FILTER_FLAG_QUERY) && !g_strcmp0(name, lastQuery)) {
+                gtk_tree_selection_select_iter(selection, &iter);
+                break;
+            }
+        }
+    } else if (index > 0
+               && gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(store), &iter, NULL, index)) {
         GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(object));
         gtk_tree_selection_select_iter(selection, &iter);
     }
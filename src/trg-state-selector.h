@@ -30,7 +30,6 @@ enum {
     STATE_SELECTOR_NAME,
     STATE_SELECTOR_COUNT,
     STATE_SELECTOR_BIT,
-    STATE_SELECTOR_SERIAL,
     STATE_SELECTOR_INDEX,
     STATE_SELECTOR_COLUMNS
 };
@@ -41,12 +40,12 @@ G_DECLARE_FINAL_TYPE(TrgStateSelector, trg_state_selector, TRG, STATE_SELECTOR,
 TrgStateSelector *trg_state_selector_new(TrgClient *client, TrgTorrentModel *tmodel);
 
 guint32 trg_state_selector_get_flag(TrgStateSelector *s);
-void trg_state_selector_update(TrgStateSelector *s, guint whatsChanged);
+void trg_state_selector_rebuild(TrgStateSelector *s);
 gchar *trg_state_selector_get_selected_text(TrgStateSelector *s);
-GRegex *trg_state_selector_get_url_host_regex(TrgStateSelector *s);
 void trg_state_selector_disconnect(TrgStateSelector *s);
 void trg_state_selector_set_show_trackers(TrgStateSelector *s, gboolean show);
 void trg_state_selector_set_directories_first(TrgStateSelector *s, gboolean _dirsFirst);
 void trg_state_selector_set_show_dirs(TrgStateSelector *s, gboolean show);
 void trg_state_selector_set_queues_enabled(TrgStateSelector *s, gboolean enabled);
 void trg_state_selector_stats_update(TrgStateSelector *s, trg_torrent_model_update_stats *stats);
+void trg_state_selector_add_query(TrgStateSelector *s, const gchar *query);
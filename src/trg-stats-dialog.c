@@ -26,6 +26,7 @@
 
 #include "hig.h"
 #include "json.h"
+#include "protocol-constants.h"
 #include "requests.h"
 #include "trg-client.h"
 #include "trg-main-window.h"
@@ -241,7 +242,8 @@ static gboolean trg_update_stats_timerfunc(gpointer data)
     if (TRG_IS_STATS_DIALOG(data)) {
         TrgStatsDialog *dlg = TRG_STATS_DIALOG(data);
         if (trg_client_is_connected(dlg->client))
-            dispatch_rpc_async(dlg->client, session_stats(), on_stats_reply, data);
+            dispatch_rpc_bytes_async(dlg->client, session_stats_body(), METHOD_SESSION_STATS,
+                                     on_stats_reply, data);
     }
 
     return FALSE;
@@ -299,7 +301,8 @@ static GObject *trg_stats_dialog_constructor(GType type, guint n_construct_prope
     gtk_container_set_border_width(GTK_CONTAINER(tv), GUI_PAD);
     gtk_box_pack_start(GTK_BOX(gtk_bin_get_child(GTK_BIN(obj))), tv, TRUE, TRUE, 0);
 
-    dispatch_rpc_async(dlg->client, session_stats(), on_stats_reply, obj);
+    dispatch_rpc_bytes_async(dlg->client, session_stats_body(), METHOD_SESSION_STATS,
+                             on_stats_reply, obj);
 
     return obj;
 }
@@ -0,0 +1,585 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "json.h"
+#include "torrent.h"
+#include "trg-torrent-filter.h"
+#include "util.h"
+
+struct _trg_trigram_index {
+    GHashTable *postings; /* trigram -> sorted GArray of guint32 IDs */
+};
+
+#define TRIGRAM_AT(s) \
+    GUINT_TO_POINTER(((guint)(guchar)(s)[0] << 16) | ((guint)(guchar)(s)[1] << 8) \
+                     | (guint)(guchar)(s)[2])
+
+trg_trigram_index *trg_trigram_index_new(void)
+{
+    trg_trigram_index *index = g_new0(trg_trigram_index, 1);
+
+    index->postings
+        = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_array_unref);
+
+    return index;
+}
+
+void trg_trigram_index_free(trg_trigram_index *index)
+{
+    g_hash_table_destroy(index->postings);
+    g_free(index);
+}
+
+/* Binary search, giving the position id is at or should be inserted at. */
+static gboolean trg_trigram_posting_find(GArray *posting, guint32 id, guint *pos)
+{
+    guint lo = 0, hi = posting->len;
+
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        guint32 midId = g_array_index(posting, guint32, mid);
+
+        if (midId == id) {
+            *pos = mid;
+            return TRUE;
+        } else if (midId < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *pos = lo;
+    return FALSE;
+}
+
+void trg_trigram_index_add(trg_trigram_index *index, gint64 id, const gchar *text)
+{
+    gsize i, len = text ? strlen(text) : 0;
+    guint32 id32 = (guint32)id;
+
+    for (i = 0; i + 3 <= len; i++) {
+        gpointer key = TRIGRAM_AT(text + i);
+        GArray *posting = g_hash_table_lookup(index->postings, key);
+        guint pos;
+
+        if (!posting) {
+            posting = g_array_new(FALSE, FALSE, sizeof(guint32));
+            g_hash_table_insert(index->postings, key, posting);
+        }
+
+        if (!trg_trigram_posting_find(posting, id32, &pos))
+            g_array_insert_val(posting, pos, id32);
+    }
+}
+
+void trg_trigram_index_remove(trg_trigram_index *index, gint64 id, const gchar *text)
+{
+    gsize i, len = text ? strlen(text) : 0;
+
+    for (i = 0; i + 3 <= len; i++) {
+        gpointer key = TRIGRAM_AT(text + i);
+        GArray *posting = g_hash_table_lookup(index->postings, key);
+        guint pos;
+
+        if (!posting || !trg_trigram_posting_find(posting, (guint32)id, &pos))
+            continue;
+
+        g_array_remove_index(posting, pos);
+
+        if (posting->len == 0)
+            g_hash_table_remove(index->postings, key);
+    }
+}
+
+/* Returns NULL if the needle is too short for the index to help, otherwise
+ * the intersection of its trigrams' posting lists (which the caller frees).
+ * This is a superset of the real matches. */
+GArray *trg_trigram_index_lookup(trg_trigram_index *index, const gchar *needle)
+{
+    gsize i, n, len = needle ? strlen(needle) : 0;
+    GArray *result, *smallest = NULL;
+    GPtrArray *postings;
+
+    if (len < 3)
+        return NULL;
+
+    result = g_array_new(FALSE, FALSE, sizeof(guint32));
+    postings = g_ptr_array_new();
+
+    for (i = 0; i + 3 <= len; i++) {
+        GArray *posting = g_hash_table_lookup(index->postings, TRIGRAM_AT(needle + i));
+
+        if (!posting) {
+            g_ptr_array_free(postings, TRUE);
+            return result;
+        }
+
+        if (!smallest || posting->len < smallest->len)
+            smallest = posting;
+
+        g_ptr_array_add(postings, posting);
+    }
+
+    for (n = 0; n < smallest->len; n++) {
+        guint32 id = g_array_index(smallest, guint32, n);
+        gboolean inAll = TRUE;
+        guint pos;
+
+        for (i = 0; i < postings->len && inAll; i++) {
+            GArray *posting = g_ptr_array_index(postings, i);
+            inAll = posting == smallest || trg_trigram_posting_find(posting, id, &pos);
+        }
+
+        if (inAll)
+            g_array_append_val(result, id);
+    }
+
+    g_ptr_array_free(postings, TRUE);
+
+    return result;
+}
+
+trg_torrent_filter_row *trg_torrent_filter_row_new(JsonObject *t, const gchar *dir)
+{
+    trg_torrent_filter_row *row = g_new0(trg_torrent_filter_row, 1);
+    JsonArray *trackers = torrent_get_tracker_stats(t);
+    guint n = json_array_get_length(trackers);
+    const gchar *name = torrent_get_name(t);
+    guint i;
+
+    row->nameFold = name ? g_utf8_casefold(name, -1) : NULL;
+    row->dir = dir ? g_intern_string(dir) : NULL;
+    row->hosts = g_ptr_array_sized_new(n);
+
+    for (i = 0; i < n; i++) {
+        JsonObject *tracker = json_array_get_object_element(trackers, i);
+        const gchar *host = trg_uri_get_host(tracker_stats_get_announce(tracker));
+
+        /* tracker: terms are lowercased, so the hosts are too. */
+        if (host) {
+            g_autofree gchar *hostDown = g_ascii_strdown(host, -1);
+            host = g_intern_string(hostDown);
+        }
+
+        if (host && !g_ptr_array_find(row->hosts, host, NULL))
+            g_ptr_array_add(row->hosts, (gpointer)host);
+    }
+
+    trg_torrent_filter_row_set_values(row, t);
+
+    return row;
+}
+
+void trg_torrent_filter_row_set_values(trg_torrent_filter_row *row, JsonObject *t)
+{
+    gint64 uploaded = torrent_get_uploaded(t);
+    gint64 haveValid = torrent_get_have_valid(t);
+
+    row->values[TRG_QUERY_FIELD_SIZE] = torrent_get_size_when_done(t);
+    row->values[TRG_QUERY_FIELD_RATIO]
+        = uploaded > 0 && haveValid > 0 ? (gdouble)uploaded / (gdouble)haveValid : 0;
+    row->values[TRG_QUERY_FIELD_PROGRESS] = torrent_get_percent_done(t);
+    row->values[TRG_QUERY_FIELD_DOWNSPEED] = torrent_get_rate_down(t);
+    row->values[TRG_QUERY_FIELD_UPSPEED] = torrent_get_rate_up(t);
+    row->values[TRG_QUERY_FIELD_ETA] = torrent_get_eta(t);
+    row->values[TRG_QUERY_FIELD_PEERS] = torrent_get_peers_connected(t);
+    row->values[TRG_QUERY_FIELD_QUEUE] = torrent_get_queue_position(t);
+}
+
+void trg_torrent_filter_row_free(trg_torrent_filter_row *row)
+{
+    if (!row)
+        return;
+
+    g_free(row->nameFold);
+    g_ptr_array_unref(row->hosts);
+    g_free(row);
+}
+
+/*
+ * Filter queries.
+ *
+ * A query is whitespace separated terms, all of which must match. A term
+ * starting with '-' is negated, and double quotes group a value with spaces.
+ *
+ *   name:foo, tracker:foo, dir:foo   substring of the name/tracker host/dir
+ *   status:seeding (or is:seeding)   downloading, seeding, paused, active,
+ *                                    error, complete, incomplete, checking,
+ *                                    queued
+ *   ratio<1, size>10G, progress>=50  compare with <, <=, >, >= or =. Sizes and
+ *   down>100K, up=0, eta<1h          speeds take K/M/G/T suffixes, ETAs s/m/h/d.
+ *   peers>0, queue<5
+ *
+ * Any other word is a name substring. If the text has no query terms at all,
+ * it's taken as one substring (spaces included), as it always was.
+ */
+
+enum {
+    TRG_QUERY_OP_NAME,
+    TRG_QUERY_OP_TRACKER,
+    TRG_QUERY_OP_DIR,
+    TRG_QUERY_OP_FLAGS,
+    TRG_QUERY_OP_LT,
+    TRG_QUERY_OP_LE,
+    TRG_QUERY_OP_GT,
+    TRG_QUERY_OP_GE,
+    TRG_QUERY_OP_EQ
+};
+
+enum {
+    TRG_QUERY_UNIT_NONE,
+    TRG_QUERY_UNIT_SIZE,
+    TRG_QUERY_UNIT_SPEED,
+    TRG_QUERY_UNIT_TIME
+};
+
+static const struct {
+    const gchar *name;
+    guint8 field;
+    guint8 unit;
+} trg_query_fields[] = {
+    { "size", TRG_QUERY_FIELD_SIZE, TRG_QUERY_UNIT_SIZE },
+    { "ratio", TRG_QUERY_FIELD_RATIO, TRG_QUERY_UNIT_NONE },
+    { "progress", TRG_QUERY_FIELD_PROGRESS, TRG_QUERY_UNIT_NONE },
+    { "down", TRG_QUERY_FIELD_DOWNSPEED, TRG_QUERY_UNIT_SPEED },
+    { "up", TRG_QUERY_FIELD_UPSPEED, TRG_QUERY_UNIT_SPEED },
+    { "eta", TRG_QUERY_FIELD_ETA, TRG_QUERY_UNIT_TIME },
+    { "peers", TRG_QUERY_FIELD_PEERS, TRG_QUERY_UNIT_NONE },
+    { "queue", TRG_QUERY_FIELD_QUEUE, TRG_QUERY_UNIT_NONE },
+};
+
+static const struct {
+    const gchar *name;
+    guint flags;
+} trg_query_states[] = {
+    { "downloading", TORRENT_FLAG_DOWNLOADING },
+    { "seeding", TORRENT_FLAG_SEEDING },
+    { "paused", TORRENT_FLAG_PAUSED },
+    { "active", TORRENT_FLAG_ACTIVE },
+    { "error", TORRENT_FLAG_ERROR },
+    { "complete", TORRENT_FLAG_COMPLETE },
+    { "incomplete", TORRENT_FLAG_INCOMPLETE },
+    { "checking", TORRENT_FLAG_CHECKING_ANY },
+    { "queued", TORRENT_FLAG_DOWNLOADING_WAIT | TORRENT_FLAG_SEEDING_WAIT },
+};
+
+static gboolean trg_query_parse_number(const gchar *str, guint8 unit, gdouble *out)
+{
+    gchar *end;
+    gdouble value = g_ascii_strtod(str, &end);
+    gdouble multiplier = 1;
+
+    if (end == str)
+        return FALSE;
+
+    if (unit == TRG_QUERY_UNIT_SIZE || unit == TRG_QUERY_UNIT_SPEED) {
+        const gchar *suffixes = "KMGT";
+        const gchar *suffix = *end ? strchr(suffixes, g_ascii_toupper(*end)) : NULL;
+
+        if (suffix) {
+            gint i, kilo = unit == TRG_QUERY_UNIT_SIZE ? disk_K : speed_K;
+            for (i = 0; i <= suffix - suffixes; i++)
+                multiplier *= kilo;
+            end++;
+            if (*end == 'i')
+                end++;
+            if (*end == 'B' || *end == 'b')
+                end++;
+        }
+    } else if (unit == TRG_QUERY_UNIT_TIME) {
+        switch (*end) {
+        case 's':
+            end++;
+            break;
+        case 'm':
+            multiplier = 60;
+            end++;
+            break;
+        case 'h':
+            multiplier = 60 * 60;
+            end++;
+            break;
+        case 'd':
+            multiplier = 60 * 60 * 24;
+            end++;
+            break;
+        }
+    } else if (*end == '%') {
+        end++;
+    }
+
+    if (*end)
+        return FALSE;
+
+    *out = value * multiplier;
+    return TRUE;
+}
+
+/* Parse one term into op. Returns FALSE if it isn't a query term, in which
+ * case it's just a word to look for in the name. */
+static gboolean trg_query_parse_term(const gchar *term, trg_query_op *op)
+{
+    gsize keyLen = 0;
+    const gchar *rest;
+    guint i;
+
+    while (g_ascii_isalpha(term[keyLen]))
+        keyLen++;
+
+    if (keyLen < 1)
+        return FALSE;
+
+    rest = term + keyLen;
+
+    if (*rest == ':') {
+        rest++;
+
+        if (!*rest)
+            return FALSE;
+
+        if (!strncmp(term, "name", keyLen) && keyLen == 4) {
+            op->code = TRG_QUERY_OP_NAME;
+            op->arg.str = g_utf8_casefold(rest, -1);
+        } else if (!strncmp(term, "tracker", keyLen) && keyLen == 7) {
+            op->code = TRG_QUERY_OP_TRACKER;
+            op->arg.str = g_ascii_strdown(rest, -1);
+        } else if (!strncmp(term, "dir", keyLen) && keyLen == 3) {
+            op->code = TRG_QUERY_OP_DIR;
+            op->arg.str = g_strdup(rest);
+        } else if ((!strncmp(term, "status", keyLen) && keyLen == 6)
+                   || (!strncmp(term, "is", keyLen) && keyLen == 2)) {
+            for (i = 0; i < G_N_ELEMENTS(trg_query_states); i++) {
+                if (!g_ascii_strcasecmp(rest, trg_query_states[i].name)) {
+                    op->code = TRG_QUERY_OP_FLAGS;
+                    op->arg.flags = trg_query_states[i].flags;
+                    return TRUE;
+                }
+            }
+            return FALSE;
+        } else {
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(trg_query_fields); i++) {
+        if (strlen(trg_query_fields[i].name) == keyLen
+            && !strncmp(term, trg_query_fields[i].name, keyLen))
+            break;
+    }
+
+    if (i == G_N_ELEMENTS(trg_query_fields))
+        return FALSE;
+
+    op->field = trg_query_fields[i].field;
+
+    if (g_str_has_prefix(rest, "<=")) {
+        op->code = TRG_QUERY_OP_LE;
+        rest += 2;
+    } else if (g_str_has_prefix(rest, ">=")) {
+        op->code = TRG_QUERY_OP_GE;
+        rest += 2;
+    } else if (*rest == '<') {
+        op->code = TRG_QUERY_OP_LT;
+        rest++;
+    } else if (*rest == '>') {
+        op->code = TRG_QUERY_OP_GT;
+        rest++;
+    } else if (*rest == '=') {
+        op->code = TRG_QUERY_OP_EQ;
+        rest++;
+    } else {
+        return FALSE;
+    }
+
+    return trg_query_parse_number(rest, trg_query_fields[i].unit, &op->arg.num);
+}
+
+static void trg_query_op_clear(gpointer data)
+{
+    trg_query_op *op = (trg_query_op *)data;
+
+    if (op->code == TRG_QUERY_OP_NAME || op->code == TRG_QUERY_OP_TRACKER
+        || op->code == TRG_QUERY_OP_DIR)
+        g_clear_pointer(&op->arg.str, g_free);
+}
+
+/* Append the terms of text to program. Returns whether any of them was a
+ * query term; if not, nothing is appended. */
+static gboolean trg_query_compile(GArray *program, const gchar *text)
+{
+    gchar **argv = NULL;
+    gboolean isQuery = FALSE;
+    guint start = program->len;
+    gint argc, i;
+
+    if (!g_shell_parse_argv(text, &argc, &argv, NULL))
+        return FALSE;
+
+    for (i = 0; i < argc; i++) {
+        trg_query_op op = { 0 };
+        const gchar *term = argv[i];
+
+        if (term[0] == '-' && term[1]) {
+            op.negate = TRUE;
+            term++;
+        }
+
+        if (trg_query_parse_term(term, &op)) {
+            isQuery = TRUE;
+        } else {
+            op.code = TRG_QUERY_OP_NAME;
+            op.arg.str = g_utf8_casefold(term, -1);
+        }
+
+        g_array_append_val(program, op);
+    }
+
+    if (!isQuery)
+        g_array_set_size(program, start);
+
+    g_strfreev(argv);
+
+    return isQuery;
+}
+
+static gboolean trg_query_run(const trg_query_op *op, guint n, guint flags,
+                              const trg_torrent_filter_row *row)
+{
+    for (; n > 0; n--, op++) {
+        gboolean result;
+        guint i;
+
+        switch (op->code) {
+        case TRG_QUERY_OP_NAME:
+            result = row->nameFold && strstr(row->nameFold, op->arg.str);
+            break;
+        case TRG_QUERY_OP_TRACKER:
+            result = FALSE;
+            for (i = 0; i < row->hosts->len && !result; i++)
+                result = strstr(g_ptr_array_index(row->hosts, i), op->arg.str) != NULL;
+            break;
+        case TRG_QUERY_OP_DIR:
+            result = row->dir && strstr(row->dir, op->arg.str);
+            break;
+        case TRG_QUERY_OP_FLAGS:
+            result = (flags & op->arg.flags) != 0;
+            break;
+        case TRG_QUERY_OP_LT:
+            result = row->values[op->field] < op->arg.num;
+            break;
+        case TRG_QUERY_OP_LE:
+            result = row->values[op->field] <= op->arg.num;
+            break;
+        case TRG_QUERY_OP_GT:
+            result = row->values[op->field] > op->arg.num;
+            break;
+        case TRG_QUERY_OP_GE:
+            result = row->values[op->field] >= op->arg.num;
+            break;
+        case TRG_QUERY_OP_EQ:
+            result = row->values[op->field] == op->arg.num;
+            break;
+        default:
+            result = TRUE;
+        }
+
+        if (result == op->negate)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+void trg_torrent_filter_clear(trg_torrent_filter *filter)
+{
+    g_clear_pointer(&filter->needle, g_free);
+    g_clear_pointer(&filter->program, g_array_unref);
+    filter->key = NULL;
+    filter->criteria = 0;
+}
+
+void trg_torrent_filter_compile(trg_torrent_filter *filter, guint32 criteria,
+                                const gchar *selected, const gchar *text)
+{
+    GArray *program = g_array_new(FALSE, TRUE, sizeof(trg_query_op));
+
+    g_array_set_clear_func(program, trg_query_op_clear);
+
+    trg_torrent_filter_clear(filter);
+
+    filter->criteria = criteria;
+
+    if ((criteria & FILTER_FLAG_TRACKER) && selected) {
+        /* Rows hold lowercased hosts; the selector shows them as announced. */
+        g_autofree gchar *hostDown = g_ascii_strdown(selected, -1);
+        filter->key = g_intern_string(hostDown);
+    } else if (criteria & (FILTER_FLAG_TRACKER | FILTER_FLAG_DIR)) {
+        filter->key = selected ? g_intern_string(selected) : NULL;
+    } else if ((criteria & FILTER_FLAG_QUERY) && selected && !trg_query_compile(program, selected)) {
+        trg_query_op op = { 0 };
+        op.code = TRG_QUERY_OP_NAME;
+        op.arg.str = g_utf8_casefold(selected, -1);
+        g_array_append_val(program, op);
+    }
+
+    if (text && *text && !trg_query_compile(program, text))
+        filter->needle = g_utf8_casefold(text, -1);
+
+    if (program->len > 0)
+        filter->program = program;
+    else
+        g_array_unref(program);
+}
+
+gboolean trg_torrent_filter_match(const trg_torrent_filter *filter, guint flags,
+                                  const trg_torrent_filter_row *row)
+{
+    if (filter->criteria & FILTER_FLAG_TRACKER) {
+        if (!row || !g_ptr_array_find(row->hosts, filter->key, NULL))
+            return FALSE;
+    } else if (filter->criteria & FILTER_FLAG_DIR) {
+        if (!row || row->dir != filter->key)
+            return FALSE;
+    } else if (filter->criteria & FILTER_FLAG_QUERY) {
+        /* Handled by the program. */
+    } else if (filter->criteria != 0 && !(flags & filter->criteria)) {
+        return FALSE;
+    }
+
+    if (filter->program
+        && (!row
+            || !trg_query_run((trg_query_op *)filter->program->data, filter->program->len, flags,
+                              row)))
+        return FALSE;
+
+    /* Rows without a name yet (just added) stay visible, as before. */
+    if (filter->needle && row && row->nameFold && !strstr(row->nameFold, filter->needle))
+        return FALSE;
+
+    return TRUE;
+}
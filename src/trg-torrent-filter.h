@@ -0,0 +1,93 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+/* Numeric fields a filter query can compare against, packed into each
+ * filter row so a query never has to go back to the JSON. */
+enum {
+    TRG_QUERY_FIELD_SIZE,
+    TRG_QUERY_FIELD_RATIO,
+    TRG_QUERY_FIELD_PROGRESS,
+    TRG_QUERY_FIELD_DOWNSPEED,
+    TRG_QUERY_FIELD_UPSPEED,
+    TRG_QUERY_FIELD_ETA,
+    TRG_QUERY_FIELD_PEERS,
+    TRG_QUERY_FIELD_QUEUE,
+    TRG_QUERY_FIELD_COUNT
+};
+
+/* What the torrent list filter looks at for each row. The torrent model
+ * keeps one of these per row (TORRENT_COLUMN_FILTER_ROW) and rebuilds it
+ * only when the name, trackers or directory change. dir and hosts are
+ * interned strings, so they can be compared by pointer; hosts are also
+ * lowercased. The values are refreshed in place on every update. */
+typedef struct {
+    gchar *nameFold;
+    const gchar *dir;
+    GPtrArray *hosts;
+    gdouble values[TRG_QUERY_FIELD_COUNT];
+} trg_torrent_filter_row;
+
+/* One step of a compiled query. A program is a flat array of these, all of
+ * which must pass (or fail, if negated) for a row to be visible. */
+typedef struct {
+    guint8 code;
+    guint8 field;
+    gboolean negate;
+    union {
+        gdouble num;
+        guint flags;
+        gchar *str;
+    } arg;
+} trg_query_op;
+
+/* The filter entry and state selector, compiled once whenever either of
+ * them changes. Plain text in the entry is a casefolded substring needle,
+ * as before; text containing query terms (see trg_torrent_filter_compile)
+ * becomes a program instead. */
+typedef struct {
+    guint32 criteria;
+    const gchar *key;
+    gchar *needle;
+    GArray *program;
+} trg_torrent_filter;
+
+/* Trigram inverted index over casefolded torrent names, kept by the torrent
+ * model. A lookup gives the (sorted) IDs of every torrent whose name could
+ * contain the needle, so a new filter only needs to look at those rows. */
+typedef struct _trg_trigram_index trg_trigram_index;
+
+trg_trigram_index *trg_trigram_index_new(void);
+void trg_trigram_index_free(trg_trigram_index *index);
+void trg_trigram_index_add(trg_trigram_index *index, gint64 id, const gchar *text);
+void trg_trigram_index_remove(trg_trigram_index *index, gint64 id, const gchar *text);
+GArray *trg_trigram_index_lookup(trg_trigram_index *index, const gchar *needle);
+
+trg_torrent_filter_row *trg_torrent_filter_row_new(JsonObject *t, const gchar *dir);
+void trg_torrent_filter_row_set_values(trg_torrent_filter_row *row, JsonObject *t);
+void trg_torrent_filter_row_free(trg_torrent_filter_row *row);
+
+void trg_torrent_filter_compile(trg_torrent_filter *filter, guint32 criteria,
+                                const gchar *selected, const gchar *text);
+void trg_torrent_filter_clear(trg_torrent_filter *filter);
+gboolean trg_torrent_filter_match(const trg_torrent_filter *filter, guint flags,
+                                  const trg_torrent_filter_row *row);
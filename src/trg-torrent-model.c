@@ -27,7 +27,10 @@
 #include "json.h"
 #include "protocol-constants.h"
 #include "torrent.h"
+#include "trg-memory.h"
 #include "trg-model.h"
+#include "trg-profile.h"
+#include "trg-torrent-filter.h"
 #include "trg-torrent-model.h"
 #include "util.h"
 
@@ -43,7 +46,9 @@
  *   1) Populates a stats struct with speeds/state counts as it works through the
  *      response.
  *   2) Emits signals if something is added or removed. This is used by the state
- *      selector so it doesn't have to refresh itself on every update.
+ *      selector so it doesn't have to refresh itself on every update. Per torrent
+ *      signals are emitted when a row is removed, or when a row is added or its
+ *      trackers/directory change, so the selector's indexes only touch those.
  *   3) Added or completed signals, for libnotify notifications.
  *   4) Maintains the torrent hash table (by ID).
  *      (and provide a lookup function which outputs an iter and/or JSON object.)
@@ -57,26 +62,50 @@ enum {
     TMODEL_UPDATE,
     TMODEL_TORRENT_ADDED,
     TMODEL_STATE_CHANGED,
+    TMODEL_TORRENT_INDEX_CHANGED,
+    TMODEL_TORRENT_REMOVED,
     TMODEL_SIGNAL_COUNT
 };
 
 #define PROP_REMOVE_IN_PROGRESS "remove-in-progress"
 
+/* Time each chunk of a chunked update may take, about half a 60Hz frame. */
+#define TRG_UPDATE_CHUNK_BUDGET_US 8000
+
 static guint signals[TMODEL_SIGNAL_COUNT] = { 0 };
 
 struct _TrgTorrentModel {
     GtkListStore parent;
 
     GHashTable *ht;
-    GRegex *urlHostRegex;
     trg_torrent_model_update_stats stats;
+
+    /* Indexed by torrent ID, holds the (truncated) update serial each ID was
+     * last seen in. A full update compares against this instead of scanning
+     * every row for a stale TORRENT_COLUMN_UPDATESERIAL. */
+    guint32 *idEpochs;
+    gsize idEpochsLen;
+
+    trg_trigram_index *nameIndex;
+
+    struct trg_torrent_model_update_job *job;
+
+    /* TORRENT_DERIVED_* columns currently kept up to date. */
+    guint derived;
 };
 
 G_DEFINE_TYPE(TrgTorrentModel, trg_torrent_model, GTK_TYPE_LIST_STORE)
 
 static void trg_torrent_model_dispose(GObject *object)
 {
-    g_hash_table_destroy(TRG_TORRENT_MODEL(object)->ht);
+    TrgTorrentModel *self = TRG_TORRENT_MODEL(object);
+
+    trg_torrent_model_update_cancel(self);
+
+    g_clear_pointer(&self->ht, g_hash_table_destroy);
+    g_clear_pointer(&self->idEpochs, g_free);
+    self->idEpochsLen = 0;
+    g_clear_pointer(&self->nameIndex, trg_trigram_index_free);
     G_OBJECT_CLASS(trg_torrent_model_parent_class)->dispose(object);
 }
 
@@ -106,6 +135,15 @@ static void trg_torrent_model_class_init(TrgTorrentModelClass *klass)
         = g_signal_new("torrents-state-change", G_TYPE_FROM_CLASS(object_class),
                        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION, 0, NULL, NULL,
                        g_cclosure_marshal_VOID__UINT, G_TYPE_NONE, 1, G_TYPE_UINT);
+
+    signals[TMODEL_TORRENT_INDEX_CHANGED] = g_signal_new(
+        "torrent-index-changed", G_TYPE_FROM_CLASS(object_class),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION, 0, NULL, NULL, g_cclosure_marshal_VOID__POINTER,
+        G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+    signals[TMODEL_TORRENT_REMOVED] = g_signal_new(
+        "torrent-removed", G_TYPE_FROM_CLASS(object_class), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION, 0,
+        NULL, NULL, g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
 }
 
 trg_torrent_model_update_stats *trg_torrent_model_get_stats(TrgTorrentModel *model)
@@ -113,42 +151,328 @@ trg_torrent_model_update_stats *trg_torrent_model_get_stats(TrgTorrentModel *mod
     return &(model->stats);
 }
 
-static void trg_torrent_model_count_peers(TrgTorrentModel *model, GtkTreeIter *iter, JsonObject *t)
+/*
+ * Columns which are computed from the torrent rather than copied out of it,
+ * and the torrent-get field each is computed from. The field is NULL where
+ * it's in the base field tier anyway (trackerStats is also needed by the
+ * trackers tab and the filter). None of this is done, or fetched, unless
+ * something is showing one of the columns.
+ */
+#define TRG_DERIVED_MAX_COLUMNS 7
+
+static const struct {
+    guint derived;
+    const gchar *field;
+    gint columns[TRG_DERIVED_MAX_COLUMNS];
+    gint nColumns;
+} trg_torrent_derived[] = {
+    /* a seven value printf per active torrent */
+    { TORRENT_DERIVED_PEER_SOURCES,
+      FIELD_PEERSFROM,
+      { TORRENT_COLUMN_FROMPEX, TORRENT_COLUMN_FROMDHT, TORRENT_COLUMN_FROMTRACKERS,
+        TORRENT_COLUMN_FROMLTEP, TORRENT_COLUMN_FROMRESUME, TORRENT_COLUMN_FROMINCOMING,
+        TORRENT_COLUMN_PEER_SOURCES },
+      7 },
+    /* a walk over every tracker's stats */
+    { TORRENT_DERIVED_PEER_COUNTS,
+      NULL,
+      { TORRENT_COLUMN_SEEDS, TORRENT_COLUMN_LEECHERS, TORRENT_COLUMN_DOWNLOADS },
+      3 },
+    /* a (memoized) announce URL parse */
+    { TORRENT_DERIVED_TRACKER_HOST, NULL, { TORRENT_COLUMN_TRACKERHOST }, 1 },
+};
+
+/* Which TORRENT_DERIVED_* a model column belongs to, or 0 if none. */
+guint trg_torrent_model_column_derived(gint column)
+{
+    guint i;
+    gint j;
+
+    for (i = 0; i < G_N_ELEMENTS(trg_torrent_derived); i++)
+        for (j = 0; j < trg_torrent_derived[i].nColumns; j++)
+            if (trg_torrent_derived[i].columns[j] == column)
+                return trg_torrent_derived[i].derived;
+
+    return 0;
+}
+
+/* Add the fields the enabled derived columns need to a torrent-get. */
+void trg_torrent_model_add_derived_fields(TrgTorrentModel *model, JsonNode *req)
+{
+    JsonObject *args = node_get_arguments(req);
+    JsonArray *fields = json_object_get_array_member(args, PARAM_FIELDS);
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(trg_torrent_derived); i++)
+        if ((model->derived & trg_torrent_derived[i].derived) && trg_torrent_derived[i].field)
+            json_array_add_string_element(fields, trg_torrent_derived[i].field);
+}
+
+/* Row values are gathered into columns/values and set with one
+ * gtk_list_store_set_valuesv(), so each row changes (and is refiltered and
+ * repositioned) once per update. */
+static void trg_torrent_model_value_int64(gint *columns, GValue *values, gint *n, gint column,
+                                          gint64 value)
+{
+    columns[*n] = column;
+    g_value_init(&values[*n], G_TYPE_INT64);
+    g_value_set_int64(&values[(*n)++], value);
+}
+
+static void trg_torrent_model_value_string(gint *columns, GValue *values, gint *n, gint column,
+                                           const gchar *value)
+{
+    columns[*n] = column;
+    g_value_init(&values[*n], G_TYPE_STRING);
+    g_value_set_string(&values[(*n)++], value);
+}
+
+#ifndef TRG_DEBUG
+static void trg_torrent_model_value_double(gint *columns, GValue *values, gint *n, gint column,
+                                           gdouble value)
+{
+    columns[*n] = column;
+    g_value_init(&values[*n], G_TYPE_DOUBLE);
+    g_value_set_double(&values[(*n)++], value);
+}
+
+static void trg_torrent_model_value_int(gint *columns, GValue *values, gint *n, gint column,
+                                        gint value)
+{
+    columns[*n] = column;
+    g_value_init(&values[*n], G_TYPE_INT);
+    g_value_set_int(&values[(*n)++], value);
+}
+
+static void trg_torrent_model_value_uint(gint *columns, GValue *values, gint *n, gint column,
+                                         guint value)
+{
+    columns[*n] = column;
+    g_value_init(&values[*n], G_TYPE_UINT);
+    g_value_set_uint(&values[(*n)++], value);
+}
+
+static void trg_torrent_model_value_pointer(gint *columns, GValue *values, gint *n, gint column,
+                                            gpointer value)
+{
+    columns[*n] = column;
+    g_value_init(&values[*n], G_TYPE_POINTER);
+    g_value_set_pointer(&values[(*n)++], value);
+}
+#endif
+
+static void trg_torrent_model_set_values(TrgTorrentModel *model, GtkTreeIter *iter,
+                                         gint *columns, GValue *values, gint n)
 {
-    GList *trackersList = json_array_get_elements(torrent_get_tracker_stats(t));
-    gint64 seeders = 0;
-    gint64 leechers = 0;
-    gint64 downloads = 0;
-    GList *li;
+    gint i;
 
-    for (li = trackersList; li; li = g_list_next(li)) {
-        JsonObject *tracker = json_node_get_object((JsonNode *)li->data);
+    if (n > 0)
+        gtk_list_store_set_valuesv(GTK_LIST_STORE(model), iter, columns, values, n);
 
-        seeders = MAX(seeders, tracker_stats_get_seeder_count(tracker));
-        leechers = MAX(leechers, tracker_stats_get_leecher_count(tracker));
-        downloads += tracker_stats_get_download_count(tracker);
+    for (i = 0; i < n; i++)
+        g_value_unset(&values[i]);
+}
+
+/* Add the given TORRENT_DERIVED_* columns for a row to columns/values. */
+static void trg_torrent_model_collect_derived(JsonObject *t, guint flags, guint derived,
+                                              gint *columns, GValue *values, gint *n)
+{
+
+    if ((derived & TORRENT_DERIVED_PEER_SOURCES) && json_object_has_member(t, FIELD_PEERSFROM)) {
+        JsonObject *pf = torrent_get_peersfrom(t);
+        gint64 lpd = peerfrom_get_lpd(pf);
+        gchar *peerSources = NULL;
+
+        if (flags & TORRENT_FLAG_ACTIVE) {
+            if (lpd >= 0) {
+                peerSources = g_strdup_printf(
+                    "%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
+                    " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
+                    " / %" G_GINT64_FORMAT,
+                    peerfrom_get_trackers(pf), peerfrom_get_incoming(pf), peerfrom_get_ltep(pf),
+                    peerfrom_get_dht(pf), peerfrom_get_pex(pf), lpd, peerfrom_get_resume(pf));
+            } else {
+                peerSources = g_strdup_printf(
+                    "%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
+                    " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / N/A / %" G_GINT64_FORMAT,
+                    peerfrom_get_trackers(pf), peerfrom_get_incoming(pf), peerfrom_get_ltep(pf),
+                    peerfrom_get_dht(pf), peerfrom_get_pex(pf), peerfrom_get_resume(pf));
+            }
+        }
+
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_FROMPEX,
+                                      peerfrom_get_pex(pf));
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_FROMDHT,
+                                      peerfrom_get_dht(pf));
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_FROMTRACKERS,
+                                      peerfrom_get_trackers(pf));
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_FROMLTEP,
+                                      peerfrom_get_ltep(pf));
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_FROMRESUME,
+                                      peerfrom_get_resume(pf));
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_FROMINCOMING,
+                                      peerfrom_get_incoming(pf));
+        trg_torrent_model_value_string(columns, values, n, TORRENT_COLUMN_PEER_SOURCES,
+                                       peerSources);
+        g_free(peerSources);
     }
 
-    g_list_free(trackersList);
+    if (derived & TORRENT_DERIVED_PEER_COUNTS) {
+        JsonArray *trackerStats = torrent_get_tracker_stats(t);
+        guint nTrackers = json_array_get_length(trackerStats);
+        gint64 seeders = 0;
+        gint64 leechers = 0;
+        gint64 downloads = 0;
+        guint j;
+
+        for (j = 0; j < nTrackers; j++) {
+            JsonObject *tracker = json_array_get_object_element(trackerStats, j);
+
+            seeders = MAX(seeders, tracker_stats_get_seeder_count(tracker));
+            leechers = MAX(leechers, tracker_stats_get_leecher_count(tracker));
+            downloads += tracker_stats_get_download_count(tracker);
+        }
 
-    gtk_list_store_set(GTK_LIST_STORE(model), iter, TORRENT_COLUMN_SEEDS, seeders,
-                       TORRENT_COLUMN_LEECHERS, leechers, TORRENT_COLUMN_DOWNLOADS, downloads, -1);
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_SEEDS, seeders);
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_LEECHERS, leechers);
+        trg_torrent_model_value_int64(columns, values, n, TORRENT_COLUMN_DOWNLOADS, downloads);
+    }
+
+    if (derived & TORRENT_DERIVED_TRACKER_HOST) {
+        JsonArray *trackerStats = torrent_get_tracker_stats(t);
+        const gchar *host = NULL;
+
+        if (json_array_get_length(trackerStats) > 0) {
+            JsonObject *firstTracker = json_array_get_object_element(trackerStats, 0);
+            host = trg_uri_get_host(tracker_stats_get_host(firstTracker));
+        }
+
+        trg_torrent_model_value_string(columns, values, n, TORRENT_COLUMN_TRACKERHOST,
+                                       host ? host : "");
+    }
 }
 
-static void trg_torrent_model_ref_free(gpointer data)
+/* Compute the given TORRENT_DERIVED_* columns for a row, setting them all at
+ * once so the row only changes once. */
+static void trg_torrent_model_update_derived(TrgTorrentModel *model, GtkTreeIter *iter,
+                                             JsonObject *t, guint flags, guint derived)
+{
+    gint columns[TORRENT_COLUMN_COLUMNS];
+    GValue values[TORRENT_COLUMN_COLUMNS] = { G_VALUE_INIT };
+    gint n = 0;
+
+    trg_torrent_model_collect_derived(t, flags, derived, columns, values, &n);
+    trg_torrent_model_set_values(model, iter, columns, values, n);
+}
+
+guint trg_torrent_model_get_derived(TrgTorrentModel *model)
+{
+    return model->derived;
+}
+
+/* Set which TORRENT_DERIVED_* columns are wanted, bringing any newly wanted
+ * ones up to date from the torrents already held. Returns TRUE if they need
+ * a field which wasn't being fetched, so a full torrent-get is due. */
+gboolean trg_torrent_model_set_derived(TrgTorrentModel *model, guint derived)
+{
+    guint added = derived & ~model->derived;
+    gboolean refetch = FALSE;
+    GtkTreeIter iter;
+    guint i;
+
+    model->derived = derived;
+
+    if (!added)
+        return FALSE;
+
+    if (gtk_tree_model_get_iter_first(GTK_TREE_MODEL(model), &iter)) {
+        do {
+            JsonObject *t;
+            guint flags;
+
+            gtk_tree_model_get(GTK_TREE_MODEL(model), &iter, TORRENT_COLUMN_JSON, &t,
+                               TORRENT_COLUMN_FLAGS, &flags, -1);
+            if (t)
+                trg_torrent_model_update_derived(model, &iter, t, flags, added);
+        } while (gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &iter));
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(trg_torrent_derived); i++)
+        if ((added & trg_torrent_derived[i].derived) && trg_torrent_derived[i].field)
+            refetch = TRUE;
+
+    return refetch;
+}
+
+/* Add (delta 1) or take away (delta -1) a torrent with these flags from the
+ * state counts. Called on add, remove, and whenever a torrent's flags change,
+ * so the counts never need a rescan of the whole model. */
+static void trg_torrent_model_stats_adjust(trg_torrent_model_update_stats *stats, guint flags,
+                                           gint delta)
+{
+    if (flags & TORRENT_FLAG_SEEDING)
+        stats->seeding += delta;
+    else if (flags & TORRENT_FLAG_DOWNLOADING)
+        stats->down += delta;
+    else if (flags & TORRENT_FLAG_PAUSED)
+        stats->paused += delta;
+
+    if (flags & TORRENT_FLAG_ERROR)
+        stats->error += delta;
+
+    if (flags & TORRENT_FLAG_COMPLETE)
+        stats->complete += delta;
+    else
+        stats->incomplete += delta;
+
+    if (flags & TORRENT_FLAG_CHECKING_ANY)
+        stats->checking += delta;
+
+    if (flags & TORRENT_FLAG_ACTIVE)
+        stats->active += delta;
+
+    if (flags & TORRENT_FLAG_SEEDING_WAIT)
+        stats->seed_wait += delta;
+
+    if (flags & TORRENT_FLAG_DOWNLOADING_WAIT)
+        stats->down_wait += delta;
+
+    stats->count += delta;
+}
+
+static void trg_torrent_model_stat_counts_clear(trg_torrent_model_update_stats *stats)
+{
+    stats->count = stats->down = stats->error = stats->paused = stats->seeding = stats->complete
+        = stats->incomplete = stats->active = stats->checking = stats->seed_wait = stats->down_wait
+        = 0;
+}
+
+/* Remove the row behind a reference, dropping the JSON object it holds. The
+ * caller is responsible for setting PROP_REMOVE_IN_PROGRESS around this. */
+static void trg_torrent_model_remove_ref(GtkTreeRowReference *rr)
 {
-    GtkTreeRowReference *rr = (GtkTreeRowReference *)data;
     GtkTreeModel *model = gtk_tree_row_reference_get_model(rr);
     GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
     if (path) {
         GtkTreeIter iter;
         JsonObject *json;
+        trg_torrent_filter_row *filterRow;
+        guint flags;
+        gint64 id;
         if (gtk_tree_model_get_iter(model, &iter, path)) {
-            gtk_tree_model_get(model, &iter, TORRENT_COLUMN_JSON, &json, -1);
+            gtk_tree_model_get(model, &iter, TORRENT_COLUMN_JSON, &json, TORRENT_COLUMN_FLAGS,
+                               &flags, TORRENT_COLUMN_ID, &id, TORRENT_COLUMN_FILTER_ROW,
+                               &filterRow, -1);
+            if (filterRow && TRG_TORRENT_MODEL(model)->nameIndex)
+                trg_trigram_index_remove(TRG_TORRENT_MODEL(model)->nameIndex, id,
+                                         filterRow->nameFold);
+            if (json) {
+                trg_torrent_model_stats_adjust(&TRG_TORRENT_MODEL(model)->stats, flags, -1);
+                g_signal_emit(model, signals[TMODEL_TORRENT_REMOVED], 0, &id);
+            }
             g_clear_pointer(&json, json_object_unref);
-            g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(TRUE));
             gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
-            g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(FALSE));
+            trg_torrent_filter_row_free(filterRow);
         }
 
         gtk_tree_path_free(path);
@@ -157,6 +481,114 @@ static void trg_torrent_model_ref_free(gpointer data)
     gtk_tree_row_reference_free(rr);
 }
 
+static void trg_torrent_model_ref_free(gpointer data)
+{
+    GtkTreeRowReference *rr = (GtkTreeRowReference *)data;
+    GObject *model = G_OBJECT(gtk_tree_row_reference_get_model(rr));
+
+    g_object_set_data(model, PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(TRUE));
+    trg_torrent_model_remove_ref(rr);
+    g_object_set_data(model, PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(FALSE));
+}
+
+/* Remove a batch of rows (already stolen from the hash table) in one go, so
+ * the remove-in-progress flag is only toggled once. */
+static void trg_torrent_model_remove_refs(TrgTorrentModel *model, GPtrArray *refs)
+{
+    guint i;
+
+    if (refs->len < 1)
+        return;
+
+    g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(TRUE));
+
+    for (i = 0; i < refs->len; i++)
+        trg_torrent_model_remove_ref((GtkTreeRowReference *)g_ptr_array_index(refs, i));
+
+    g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(FALSE));
+}
+
+static void trg_torrent_model_mark_seen(TrgTorrentModel *model, gint64 id, gint64 serial)
+{
+    if (id < 0)
+        return;
+
+    if ((gsize)id >= model->idEpochsLen) {
+        gsize newLen = MAX(model->idEpochsLen * 2, 64);
+
+        while (newLen <= (gsize)id)
+            newLen *= 2;
+
+        model->idEpochs = g_renew(guint32, model->idEpochs, newLen);
+        memset(model->idEpochs + model->idEpochsLen, 0,
+               (newLen - model->idEpochsLen) * sizeof(guint32));
+        model->idEpochsLen = newLen;
+    }
+
+    model->idEpochs[id] = (guint32)serial;
+}
+
+static gboolean trg_torrent_model_was_seen(TrgTorrentModel *model, gint64 id, gint64 serial)
+{
+    return id >= 0 && (gsize)id < model->idEpochsLen && model->idEpochs[id] == (guint32)serial;
+}
+
+/* Steal every hash table entry whose ID wasn't in this update, then remove
+ * the rows together. */
+static guint trg_torrent_model_remove_unseen(TrgTorrentModel *model, gint64 serial)
+{
+    GPtrArray *hitlist = g_ptr_array_new();
+    GHashTableIter hti;
+    gpointer key, value;
+    guint removed;
+
+    g_hash_table_iter_init(&hti, model->ht);
+    while (g_hash_table_iter_next(&hti, &key, &value)) {
+        if (!trg_torrent_model_was_seen(model, *(gint64 *)key, serial)) {
+            g_hash_table_iter_steal(&hti);
+            g_ptr_array_add(hitlist, value);
+            g_free(key);
+        }
+    }
+
+    trg_torrent_model_remove_refs(model, hitlist);
+    removed = hitlist->len;
+    g_ptr_array_free(hitlist, TRUE);
+
+    return removed;
+}
+
+static void trg_torrent_model_json_usage(GObject *object, trg_memory_usage *usage)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(object);
+    GtkTreeIter iter;
+    gboolean valid;
+
+    for (valid = gtk_tree_model_get_iter_first(model, &iter); valid;
+         valid = gtk_tree_model_iter_next(model, &iter)) {
+        JsonObject *json;
+        gtk_tree_model_get(model, &iter, TORRENT_COLUMN_JSON, &json, -1);
+        if (json) {
+            usage->count++;
+            usage->bytes += trg_memory_json_object_size(json);
+        }
+    }
+}
+
+static void trg_torrent_model_refs_usage(GObject *object, trg_memory_usage *usage)
+{
+    TrgTorrentModel *self = TRG_TORRENT_MODEL(object);
+    guint n;
+
+    if (!self->ht)
+        return;
+
+    n = g_hash_table_size(self->ht);
+    usage->count += n;
+    usage->bytes
+        += trg_memory_table_size(self->ht) + n * (trg_memory_row_ref_size() + sizeof(gint64));
+}
+
 static void trg_torrent_model_init(TrgTorrentModel *self)
 {
     GType column_types[TORRENT_COLUMN_COLUMNS];
@@ -206,15 +638,20 @@ static void trg_torrent_model_init(TrgTorrentModel *self)
     column_types[TORRENT_COLUMN_QUEUE_POSITION] = G_TYPE_INT64;
     column_types[TORRENT_COLUMN_LASTACTIVE] = G_TYPE_INT64;
     column_types[TORRENT_COLUMN_FILECOUNT] = G_TYPE_UINT;
+    column_types[TORRENT_COLUMN_FILTER_ROW] = G_TYPE_POINTER;
 
     gtk_list_store_set_column_types(GTK_LIST_STORE(self), TORRENT_COLUMN_COLUMNS, column_types);
 
     self->ht = g_hash_table_new_full(g_int64_hash, g_int64_equal, (GDestroyNotify)g_free,
                                      trg_torrent_model_ref_free);
+    self->nameIndex = trg_trigram_index_new();
+    self->derived = TORRENT_DERIVED_ALL;
+
+    trg_memory_register(G_OBJECT(self), TRG_MEMORY_TORRENT_JSON, trg_torrent_model_json_usage);
+    trg_memory_register(G_OBJECT(self), TRG_MEMORY_TORRENT_ROW_REFS, trg_torrent_model_refs_usage);
 
     g_object_set_data(G_OBJECT(self), PROP_REMOVE_IN_PROGRESS, GINT_TO_POINTER(FALSE));
 
-    self->urlHostRegex = trg_uri_host_regex_new();
 }
 
 gboolean trg_torrent_model_is_remove_in_progress(TrgTorrentModel *model)
@@ -222,18 +659,51 @@ gboolean trg_torrent_model_is_remove_in_progress(TrgTorrentModel *model)
     return (gboolean)GPOINTER_TO_INT(g_object_get_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS));
 }
 
+/* Rebuild what the torrent list filter matches against, from the torrent's
+ * name, trackers and (already shortened) download directory. */
+static void trg_torrent_model_update_filter_row(GtkTreeModel *model, GtkTreeIter *iter,
+                                                JsonObject *t)
+{
+    trg_trigram_index *nameIndex = TRG_TORRENT_MODEL(model)->nameIndex;
+    trg_torrent_filter_row *filterRow, *newRow;
+    gchar *shortDownloadDir;
+    gint64 id;
+
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_FILTER_ROW, &filterRow,
+                       TORRENT_COLUMN_DOWNLOADDIR_SHORT, &shortDownloadDir, TORRENT_COLUMN_ID, &id,
+                       -1);
+
+    newRow = trg_torrent_filter_row_new(t, shortDownloadDir);
+
+    if (!filterRow || g_strcmp0(filterRow->nameFold, newRow->nameFold)) {
+        if (filterRow)
+            trg_trigram_index_remove(nameIndex, id, filterRow->nameFold);
+        trg_trigram_index_add(nameIndex, id, newRow->nameFold);
+    }
+
+    gtk_list_store_set(GTK_LIST_STORE(model), iter, TORRENT_COLUMN_FILTER_ROW, newRow, -1);
+
+    trg_torrent_filter_row_free(filterRow);
+    g_free(shortDownloadDir);
+}
+
 static gboolean trg_torrent_model_reload_dir_aliases_foreachfunc(GtkTreeModel *model,
                                                                  GtkTreePath *path G_GNUC_UNUSED,
                                                                  GtkTreeIter *iter, gpointer gdata)
 {
     gchar *downloadDir, *shortDownloadDir;
+    JsonObject *t;
 
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_DOWNLOADDIR, &downloadDir, -1);
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_DOWNLOADDIR, &downloadDir, TORRENT_COLUMN_JSON,
+                       &t, -1);
 
     shortDownloadDir = shorten_download_dir((TrgClient *)gdata, downloadDir);
 
     gtk_list_store_set(GTK_LIST_STORE(model), iter, TORRENT_COLUMN_DOWNLOADDIR_SHORT,
                        shortDownloadDir, -1);
+    if (t)
+        trg_torrent_model_update_filter_row(model, iter, t);
+    g_signal_emit(model, signals[TMODEL_TORRENT_INDEX_CHANGED], 0, iter);
 
     g_free(downloadDir);
     g_free(shortDownloadDir);
@@ -247,51 +717,12 @@ void trg_torrent_model_reload_dir_aliases(TrgClient *tc, GtkTreeModel *model)
     g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0, TORRENT_UPDATE_PATH_CHANGE);
 }
 
-static gboolean trg_torrent_model_stats_scan_foreachfunc(GtkTreeModel *model,
-                                                         GtkTreePath *path G_GNUC_UNUSED,
-                                                         GtkTreeIter *iter, gpointer gdata)
-{
-    trg_torrent_model_update_stats *stats = (trg_torrent_model_update_stats *)gdata;
-    guint flags;
-
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_FLAGS, &flags, -1);
-
-    if (flags & TORRENT_FLAG_SEEDING)
-        stats->seeding++;
-    else if (flags & TORRENT_FLAG_DOWNLOADING)
-        stats->down++;
-    else if (flags & TORRENT_FLAG_PAUSED)
-        stats->paused++;
-
-    if (flags & TORRENT_FLAG_ERROR)
-        stats->error++;
-
-    if (flags & TORRENT_FLAG_COMPLETE)
-        stats->complete++;
-    else
-        stats->incomplete++;
-
-    if (flags & TORRENT_FLAG_CHECKING_ANY)
-        stats->checking++;
-
-    if (flags & TORRENT_FLAG_ACTIVE)
-        stats->active++;
-
-    if (flags & TORRENT_FLAG_SEEDING_WAIT)
-        stats->seed_wait++;
-
-    if (flags & TORRENT_FLAG_DOWNLOADING_WAIT)
-        stats->down_wait++;
-
-    stats->count++;
-
-    return FALSE;
-}
-
 void trg_torrent_model_remove_all(TrgTorrentModel *model)
 {
+    trg_torrent_model_update_cancel(model);
     g_hash_table_remove_all(model->ht);
     gtk_list_store_clear(GTK_LIST_STORE(model));
+    trg_torrent_model_stat_counts_clear(&model->stats);
 }
 
 gchar *shorten_download_dir(TrgClient *tc, const gchar *downloadDir)
@@ -345,16 +776,21 @@ static void update_torrent_iter(TrgTorrentModel *model, TrgClient *tc, gint64 rp
                                 GtkTreeIter *iter, JsonObject *t,
                                 trg_torrent_model_update_stats *stats, guint *whatsChanged)
 {
+#ifdef TRG_DEBUG
     GtkListStore *ls = GTK_LIST_STORE(model);
+#endif
     guint lastFlags, newFlags;
-    JsonObject *lastJson, *pf;
-    JsonArray *trackerStats;
+    gboolean isNew;
+    JsonObject *lastJson;
+    trg_torrent_filter_row *filterRow;
     gchar *statusString, *statusIcon, *downloadDir;
-    gint64 downRate, upRate, haveValid, uploaded, downloaded, id, status, lpd;
+    gint64 downRate, upRate, haveValid, uploaded, downloaded, id, status;
     guint fileCount;
-    gchar *firstTrackerHost = NULL;
-    gchar *peerSources = NULL;
     gchar *lastDownloadDir = NULL;
+    gboolean indexChanged = FALSE;
+    gint columns[TORRENT_COLUMN_COLUMNS];
+    GValue values[TORRENT_COLUMN_COLUMNS] = { G_VALUE_INIT };
+    gint n = 0;
 
     downRate = torrent_get_rate_down(t);
     stats->downRateTotal += downRate;
@@ -371,42 +807,22 @@ static void update_torrent_iter(TrgTorrentModel *model, TrgClient *tc, gint64 rp
 
     id = torrent_get_id(t);
     status = torrent_get_status(t);
-    fileCount = json_array_get_length(torrent_get_files(t));
+    fileCount = torrent_get_file_count(t);
     newFlags = torrent_get_flags(t, rpcv, status, fileCount, downRate, upRate);
     statusString = torrent_get_status_string(rpcv, status, newFlags);
     statusIcon = torrent_get_status_icon(rpcv, newFlags);
-    pf = torrent_get_peersfrom(t);
-    trackerStats = torrent_get_tracker_stats(t);
 
     gtk_tree_model_get(GTK_TREE_MODEL(model), iter, TORRENT_COLUMN_FLAGS, &lastFlags,
                        TORRENT_COLUMN_JSON, &lastJson, TORRENT_COLUMN_DOWNLOADDIR, &lastDownloadDir,
-                       -1);
+                       TORRENT_COLUMN_FILTER_ROW, &filterRow, -1);
 
     json_object_ref(t);
 
-    if (json_array_get_length(trackerStats) > 0) {
-        JsonObject *firstTracker = json_array_get_object_element(trackerStats, 0);
-        firstTrackerHost
-            = trg_gregex_get_first(model->urlHostRegex, tracker_stats_get_host(firstTracker));
-    }
+    /* Before the row is set, so the filter sees the new values when it's
+     * re-evaluated for row-changed. */
+    if (filterRow)
+        trg_torrent_filter_row_set_values(filterRow, t);
 
-    lpd = peerfrom_get_lpd(pf);
-    if (newFlags & TORRENT_FLAG_ACTIVE) {
-        if (lpd >= 0) {
-            peerSources = g_strdup_printf(
-                "%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                " / %" G_GINT64_FORMAT,
-                peerfrom_get_trackers(pf), peerfrom_get_incoming(pf), peerfrom_get_ltep(pf),
-                peerfrom_get_dht(pf), peerfrom_get_pex(pf), lpd, peerfrom_get_resume(pf));
-        } else {
-            peerSources = g_strdup_printf(
-                "%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                " / %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " / N/A / %" G_GINT64_FORMAT,
-                peerfrom_get_trackers(pf), peerfrom_get_incoming(pf), peerfrom_get_ltep(pf),
-                peerfrom_get_dht(pf), peerfrom_get_pex(pf), peerfrom_get_resume(pf));
-        }
-    }
 #ifdef TRG_DEBUG
     gtk_list_store_set(ls, iter, TORRENT_COLUMN_ICON, statusIcon, -1);
     gtk_list_store_set(ls, iter, TORRENT_COLUMN_NAME, torrent_get_name(t), -1);
@@ -452,60 +868,105 @@ static void update_torrent_iter(TrgTorrentModel *model, TrgClient *tc, gint64 rp
     gtk_list_store_set(ls, iter, TORRENT_COLUMN_FILECOUNT, fileCount, -1);
     gtk_list_store_set(ls, iter, TORRENT_COLUMN_HAVE_VALID, haveValid, -1);
 #else
-    gtk_list_store_set(
-        ls, iter, TORRENT_COLUMN_ICON, statusIcon, TORRENT_COLUMN_ADDED, torrent_get_added_date(t),
-        TORRENT_COLUMN_FILECOUNT, fileCount, TORRENT_COLUMN_DONE_DATE, torrent_get_done_date(t),
-        TORRENT_COLUMN_NAME, torrent_get_name(t), TORRENT_COLUMN_ERROR, torrent_get_error(t),
-        TORRENT_COLUMN_SIZEWHENDONE, torrent_get_size_when_done(t), TORRENT_COLUMN_PERCENTDONE,
-        (newFlags & TORRENT_FLAG_CHECKING) ? torrent_get_recheck_progress(t)
-                                           : torrent_get_percent_done(t),
-        TORRENT_COLUMN_METADATAPERCENTCOMPLETE, torrent_get_metadata_percent_complete(t),
-        TORRENT_COLUMN_STATUS, statusString, TORRENT_COLUMN_DOWNSPEED, downRate,
-        TORRENT_COLUMN_FLAGS, newFlags, TORRENT_COLUMN_UPSPEED, upRate, TORRENT_COLUMN_ETA,
-        torrent_get_eta(t), TORRENT_COLUMN_UPLOADED, uploaded, TORRENT_COLUMN_DOWNLOADED,
-        downloaded, TORRENT_COLUMN_TOTALSIZE, torrent_get_total_size(t),
-        TORRENT_COLUMN_HAVE_UNCHECKED, torrent_get_have_unchecked(t), TORRENT_COLUMN_HAVE_VALID,
-        haveValid, TORRENT_COLUMN_FROMPEX, peerfrom_get_pex(pf), TORRENT_COLUMN_FROMDHT,
-        peerfrom_get_dht(pf), TORRENT_COLUMN_FROMTRACKERS, peerfrom_get_trackers(pf),
-        TORRENT_COLUMN_FROMLTEP, peerfrom_get_ltep(pf), TORRENT_COLUMN_FROMRESUME,
-        peerfrom_get_resume(pf), TORRENT_COLUMN_FROMINCOMING, peerfrom_get_incoming(pf),
-        TORRENT_COLUMN_PEER_SOURCES, peerSources, TORRENT_COLUMN_PEERS_CONNECTED,
-        torrent_get_peers_connected(t), TORRENT_COLUMN_PEERS_TO_US,
-        torrent_get_peers_sending_to_us(t), TORRENT_COLUMN_PEERS_FROM_US,
-        torrent_get_peers_getting_from_us(t), TORRENT_COLUMN_WEB_SEEDS_TO_US,
-        torrent_get_web_seeds_sending_to_us(t), TORRENT_COLUMN_QUEUE_POSITION,
-        torrent_get_queue_position(t), TORRENT_COLUMN_SEED_RATIO_LIMIT,
-        torrent_get_seed_ratio_limit(t), TORRENT_COLUMN_SEED_RATIO_MODE,
-        torrent_get_seed_ratio_mode(t), TORRENT_COLUMN_LASTACTIVE, torrent_get_activity_date(t),
-        TORRENT_COLUMN_RATIO,
-        uploaded > 0 && haveValid > 0 ? (double)uploaded / (double)haveValid : 0,
-        TORRENT_COLUMN_DOWNLOADDIR, downloadDir, TORRENT_COLUMN_BANDWIDTH_PRIORITY,
-        torrent_get_bandwidth_priority(t), TORRENT_COLUMN_ID, id, TORRENT_COLUMN_JSON, t,
-        TORRENT_COLUMN_TRACKERHOST, firstTrackerHost ? firstTrackerHost : "",
-        TORRENT_COLUMN_UPDATESERIAL, serial, -1);
+    trg_torrent_model_value_string(columns, values, &n, TORRENT_COLUMN_ICON, statusIcon);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_ADDED,
+                                  torrent_get_added_date(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_DONE_DATE,
+                                  torrent_get_done_date(t));
+    trg_torrent_model_value_string(columns, values, &n, TORRENT_COLUMN_NAME, torrent_get_name(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_ERROR, torrent_get_error(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_SIZEWHENDONE,
+                                  torrent_get_size_when_done(t));
+    trg_torrent_model_value_double(columns, values, &n, TORRENT_COLUMN_PERCENTDONE,
+                                   (newFlags & TORRENT_FLAG_CHECKING)
+                                       ? torrent_get_recheck_progress(t)
+                                       : torrent_get_percent_done(t));
+    trg_torrent_model_value_double(columns, values, &n, TORRENT_COLUMN_METADATAPERCENTCOMPLETE,
+                                   torrent_get_metadata_percent_complete(t));
+    trg_torrent_model_value_string(columns, values, &n, TORRENT_COLUMN_STATUS, statusString);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_DOWNSPEED, downRate);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_UPSPEED, upRate);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_ETA, torrent_get_eta(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_UPLOADED, uploaded);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_DOWNLOADED, downloaded);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_TOTALSIZE,
+                                  torrent_get_total_size(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_HAVE_UNCHECKED,
+                                  torrent_get_have_unchecked(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_HAVE_VALID, haveValid);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_PEERS_CONNECTED,
+                                  torrent_get_peers_connected(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_PEERS_TO_US,
+                                  torrent_get_peers_sending_to_us(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_PEERS_FROM_US,
+                                  torrent_get_peers_getting_from_us(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_WEB_SEEDS_TO_US,
+                                  torrent_get_web_seeds_sending_to_us(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_QUEUE_POSITION,
+                                  torrent_get_queue_position(t));
+    trg_torrent_model_value_double(columns, values, &n, TORRENT_COLUMN_SEED_RATIO_LIMIT,
+                                   torrent_get_seed_ratio_limit(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_SEED_RATIO_MODE,
+                                  torrent_get_seed_ratio_mode(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_LASTACTIVE,
+                                  torrent_get_activity_date(t));
+    trg_torrent_model_value_double(columns, values, &n, TORRENT_COLUMN_RATIO,
+                                   uploaded > 0 && haveValid > 0
+                                       ? (double)uploaded / (double)haveValid
+                                       : 0);
+    trg_torrent_model_value_string(columns, values, &n, TORRENT_COLUMN_DOWNLOADDIR, downloadDir);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_BANDWIDTH_PRIORITY,
+                                  torrent_get_bandwidth_priority(t));
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_ID, id);
+    trg_torrent_model_value_pointer(columns, values, &n, TORRENT_COLUMN_JSON, t);
+    trg_torrent_model_value_int64(columns, values, &n, TORRENT_COLUMN_UPDATESERIAL, serial);
+
+    trg_torrent_model_value_int(columns, values, &n, TORRENT_COLUMN_FLAGS, newFlags);
+    trg_torrent_model_value_uint(columns, values, &n, TORRENT_COLUMN_FILECOUNT, fileCount);
 #endif
 
     if (!lastDownloadDir || g_strcmp0(downloadDir, lastDownloadDir)) {
         gchar *shortDownloadDir = shorten_download_dir(tc, downloadDir);
-        gtk_list_store_set(ls, iter, TORRENT_COLUMN_DOWNLOADDIR_SHORT, shortDownloadDir, -1);
+        trg_torrent_model_value_string(columns, values, &n, TORRENT_COLUMN_DOWNLOADDIR_SHORT,
+                                       shortDownloadDir);
         g_free(shortDownloadDir);
         *whatsChanged |= TORRENT_UPDATE_PATH_CHANGE;
+        indexChanged = TRUE;
     }
 
+    trg_torrent_model_collect_derived(t, newFlags, model->derived, columns, values, &n);
+    trg_torrent_model_set_values(model, iter, columns, values, n);
+
+    isNew = lastJson == NULL;
+    if (isNew || !torrent_tracker_announces_equal(lastJson, t))
+        indexChanged = TRUE;
+
+    /* The row is set either way, but only count it for the diagnostics if
+     * the daemon sent something different. */
+    if (isNew || lastFlags != newFlags || !json_object_equal(lastJson, t))
+        stats->rowsChanged++;
+
+    if (indexChanged || g_strcmp0(torrent_get_name(lastJson), torrent_get_name(t)))
+        trg_torrent_model_update_filter_row(GTK_TREE_MODEL(model), iter, t);
+
     g_clear_pointer(&lastJson, json_object_unref);
 
     if ((lastFlags & TORRENT_FLAG_DOWNLOADING) && (!(newFlags & TORRENT_FLAG_DOWNLOADING))
         && (newFlags & TORRENT_FLAG_COMPLETE))
         g_signal_emit(model, signals[TMODEL_TORRENT_COMPLETED], 0, iter);
 
+    if (isNew) {
+        trg_torrent_model_stats_adjust(stats, newFlags, 1);
+    } else if (lastFlags != newFlags) {
+        trg_torrent_model_stats_adjust(stats, lastFlags, -1);
+        trg_torrent_model_stats_adjust(stats, newFlags, 1);
+    }
+
     if (lastFlags != newFlags)
         *whatsChanged |= TORRENT_UPDATE_STATE_CHANGE;
 
-    trg_torrent_model_count_peers(model, iter, t);
-
-    g_free(firstTrackerHost);
-
-    g_free(peerSources);
+    if (indexChanged)
+        g_signal_emit(model, signals[TMODEL_TORRENT_INDEX_CHANGED], 0, iter);
 
     g_free(lastDownloadDir);
     g_free(statusString);
@@ -517,43 +978,34 @@ TrgTorrentModel *trg_torrent_model_new(void)
     return g_object_new(TRG_TYPE_TORRENT_MODEL, NULL);
 }
 
-struct TrgModelRemoveData {
-    GList *toRemove;
-    gint64 currentSerial;
-};
-
 GHashTable *get_torrent_table(TrgTorrentModel *model)
 {
     return model->ht;
 }
 
-static gboolean trg_model_find_removed_foreachfunc(GtkTreeModel *model,
-                                                   GtkTreePath *path G_GNUC_UNUSED,
-                                                   GtkTreeIter *iter, gpointer gdata)
+trg_trigram_index *trg_torrent_model_get_name_index(TrgTorrentModel *model)
 {
-    struct TrgModelRemoveData *args = (struct TrgModelRemoveData *)gdata;
-    gint64 rowSerial;
-
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_UPDATESERIAL, &rowSerial, -1);
-
-    if (rowSerial != args->currentSerial) {
-        gint64 *id = g_new(gint64, 1);
-        gtk_tree_model_get(model, iter, TORRENT_COLUMN_ID, id, -1);
-        args->toRemove = g_list_append(args->toRemove, id);
-    }
-
-    return FALSE;
+    return model->nameIndex;
 }
 
-static GList *trg_torrent_model_find_removed(GtkTreeModel *model, gint64 currentSerial)
+/* Emit row-changed for these torrent IDs (sorted, as from the name index),
+ * so a filter on top re-evaluates just these rows rather than all of them. */
+void trg_torrent_model_ids_changed(TrgTorrentModel *model, GArray *ids)
 {
-    struct TrgModelRemoveData args;
-    args.toRemove = NULL;
-    args.currentSerial = currentSerial;
+    guint i;
 
-    gtk_tree_model_foreach(GTK_TREE_MODEL(model), trg_model_find_removed_foreachfunc, &args);
+    for (i = 0; i < ids->len; i++) {
+        gint64 id = g_array_index(ids, guint32, i);
+        GtkTreeRowReference *rr = g_hash_table_lookup(model->ht, &id);
+        GtkTreePath *path = rr ? gtk_tree_row_reference_get_path(rr) : NULL;
+        GtkTreeIter iter;
+
+        if (path && gtk_tree_model_get_iter(GTK_TREE_MODEL(model), &iter, path))
+            gtk_tree_model_row_changed(GTK_TREE_MODEL(model), path, &iter);
 
-    return args.toRemove;
+        if (path)
+            gtk_tree_path_free(path);
+    }
 }
 
 gboolean get_torrent_data(GHashTable *table, gint64 id, JsonObject **t, GtkTreeIter *out_iter)
@@ -580,106 +1032,257 @@ gboolean get_torrent_data(GHashTable *table, gint64 id, JsonObject **t, GtkTreeI
     return found;
 }
 
-static void trg_torrent_model_stat_counts_clear(trg_torrent_model_update_stats *stats)
+/* One torrent-get response being applied to the model. Kept around between
+ * chunks when the update is spread over several main loop iterations. */
+struct trg_torrent_model_update_job {
+    TrgClient *tc;
+    JsonObject *response;
+    gint mode;
+    gint64 serial;
+    gint64 rpcv;
+    GList *torrents;
+    GList *next;
+    guint nTorrents;
+    guint whatsChanged;
+    guint sourceId;
+    gint64 elapsed;
+    trg_torrent_model_update_cb callback;
+    gpointer data;
+};
+
+static struct trg_torrent_model_update_job *
+trg_torrent_model_update_job_new(TrgTorrentModel *model, TrgClient *tc, JsonObject *response,
+                                 gint mode)
 {
-    stats->count = stats->down = stats->error = stats->paused = stats->seeding = stats->complete
-        = stats->incomplete = stats->active = stats->checking = stats->seed_wait = stats->down_wait
-        = 0;
+    struct trg_torrent_model_update_job *job = g_new0(struct trg_torrent_model_update_job, 1);
+
+    job->tc = tc;
+    job->response = json_object_ref(response);
+    job->mode = mode;
+    job->serial = trg_client_get_serial(tc);
+    job->rpcv = trg_client_get_rpc_version(tc);
+    job->torrents = json_array_get_elements(get_torrents(get_arguments(response)));
+    job->next = job->torrents;
+    job->nTorrents = g_list_length(job->torrents);
+
+    model->stats.downRateTotal = 0;
+    model->stats.upRateTotal = 0;
+    model->stats.rowsChanged = 0;
+
+    return job;
 }
 
-trg_torrent_model_update_stats *trg_torrent_model_update(TrgTorrentModel *model, TrgClient *tc,
-                                                         JsonObject *response, gint mode)
+static void trg_torrent_model_update_job_free(struct trg_torrent_model_update_job *job)
 {
-    GList *torrentList;
-    JsonObject *args, *t;
-    GList *li;
-    gint64 id;
-    gint64 serial = trg_client_get_serial(tc);
-    JsonArray *removedTorrents;
+    g_clear_handle_id(&job->sourceId, g_source_remove);
+    g_list_free(job->torrents);
+    json_object_unref(job->response);
+    g_free(job);
+}
+
+static void trg_torrent_model_update_one(TrgTorrentModel *model,
+                                         struct trg_torrent_model_update_job *job, JsonObject *t)
+{
+    gint64 id = torrent_get_id(t);
     GtkTreeIter iter;
     GtkTreePath *path;
-    GtkTreeRowReference *rr;
-    gpointer *result;
-    guint whatsChanged = 0;
+    gpointer result;
 
-    gint64 rpcv = trg_client_get_rpc_version(tc);
+    if (job->mode == TORRENT_GET_MODE_UPDATE)
+        trg_torrent_model_mark_seen(model, id, job->serial);
 
-    args = get_arguments(response);
-    torrentList = json_array_get_elements(get_torrents(args));
+    result = job->mode == TORRENT_GET_MODE_FIRST ? NULL : g_hash_table_lookup(model->ht, &id);
 
-    model->stats.downRateTotal = 0;
-    model->stats.upRateTotal = 0;
+    if (!result) {
+        GtkTreeRowReference *rr;
+        gint64 *idCopy;
+        gtk_list_store_append(GTK_LIST_STORE(model), &iter);
+        job->whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
 
-    for (li = torrentList; li; li = g_list_next(li)) {
-        t = json_node_get_object((JsonNode *)li->data);
-        id = torrent_get_id(t);
+        update_torrent_iter(model, job->tc, job->rpcv, job->serial, &iter, t, &(model->stats),
+                            &job->whatsChanged);
 
-        result = mode == TORRENT_GET_MODE_FIRST ? NULL : g_hash_table_lookup(model->ht, &id);
+        path = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &iter);
+        rr = gtk_tree_row_reference_new(GTK_TREE_MODEL(model), path);
+        idCopy = g_new(gint64, 1);
+        *idCopy = id;
+        g_hash_table_insert(model->ht, idCopy, rr);
+        gtk_tree_path_free(path);
 
-        if (!result) {
-            gint64 *idCopy;
-            gtk_list_store_append(GTK_LIST_STORE(model), &iter);
-            whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
+        if (job->mode != TORRENT_GET_MODE_FIRST)
+            g_signal_emit(model, signals[TMODEL_TORRENT_ADDED], 0, &iter);
+    } else {
+        path = gtk_tree_row_reference_get_path((GtkTreeRowReference *)result);
+        if (path) {
+            if (gtk_tree_model_get_iter(GTK_TREE_MODEL(model), &iter, path)) {
+                update_torrent_iter(model, job->tc, job->rpcv, job->serial, &iter, t,
+                                    &(model->stats), &job->whatsChanged);
+            }
+            gtk_tree_path_free(path);
+        }
+    }
+}
 
-            update_torrent_iter(model, tc, rpcv, serial, &iter, t, &(model->stats), &whatsChanged);
+/* Apply torrents from the job until it's done or the deadline (monotonic
+ * time, or 0 for none) passes. Returns TRUE when every torrent is applied. */
+static gboolean trg_torrent_model_update_job_run(TrgTorrentModel *model,
+                                                 struct trg_torrent_model_update_job *job,
+                                                 gint64 deadline)
+{
+    gint64 start = trg_span_start();
 
-            path = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &iter);
-            rr = gtk_tree_row_reference_new(GTK_TREE_MODEL(model), path);
-            idCopy = g_new(gint64, 1);
-            *idCopy = id;
-            g_hash_table_insert(model->ht, idCopy, rr);
-            gtk_tree_path_free(path);
+    while (job->next) {
+        trg_torrent_model_update_one(model, job, json_node_get_object((JsonNode *)job->next->data));
+        job->next = g_list_next(job->next);
 
-            if (mode != TORRENT_GET_MODE_FIRST)
-                g_signal_emit(model, signals[TMODEL_TORRENT_ADDED], 0, &iter);
-        } else {
-            path = gtk_tree_row_reference_get_path((GtkTreeRowReference *)result);
-            if (path) {
-                if (gtk_tree_model_get_iter(GTK_TREE_MODEL(model), &iter, path)) {
-                    update_torrent_iter(model, tc, rpcv, serial, &iter, t, &(model->stats),
-                                        &whatsChanged);
-                }
-                gtk_tree_path_free(path);
-            }
-        }
+        if (deadline > 0 && g_get_monotonic_time() >= deadline)
+            break;
     }
 
-    g_list_free(torrentList);
+    job->elapsed += trg_span_stop(TRG_PROFILE_NONE, "torrent-model", "apply", start);
+
+    return job->next == NULL;
+}
+
+/* The commit point: once every torrent is applied, remove what's gone and
+ * tell the derived views (state counts, selector, status bar) once. */
+static void trg_torrent_model_update_job_commit(TrgTorrentModel *model,
+                                                struct trg_torrent_model_update_job *job)
+{
+    JsonArray *removedTorrents;
+
+    /* Every torrent in a full update is in the table by now, so anything more
+     * than that has been removed. */
+    if (job->mode == TORRENT_GET_MODE_UPDATE) {
+        if (g_hash_table_size(model->ht) > job->nTorrents) {
+            guint removed = trg_torrent_model_remove_unseen(model, job->serial);
 
-    if (mode == TORRENT_GET_MODE_UPDATE) {
-        GList *hitlist = trg_torrent_model_find_removed(GTK_TREE_MODEL(model), serial);
-        if (hitlist) {
-            for (li = hitlist; li; li = g_list_next(li)) {
-                g_hash_table_remove(model->ht, li->data);
-                g_free(li->data);
+            if (removed > 0) {
+                job->whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
+                model->stats.rowsChanged += removed;
             }
-            whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
-            g_list_free(hitlist);
         }
-    } else if (mode > TORRENT_GET_MODE_FIRST) {
-        removedTorrents = get_torrents_removed(args);
+    } else if (job->mode > TORRENT_GET_MODE_FIRST) {
+        removedTorrents = get_torrents_removed(get_arguments(job->response));
         if (removedTorrents) {
-            GList *hitlist = json_array_get_elements(removedTorrents);
-            for (li = hitlist; li; li = g_list_next(li)) {
-                id = json_node_get_int((JsonNode *)li->data);
-                g_hash_table_remove(model->ht, &id);
-                whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
+            GPtrArray *hitlist = g_ptr_array_new();
+            guint i, n = json_array_get_length(removedTorrents);
+
+            for (i = 0; i < n; i++) {
+                gint64 id = json_array_get_int_element(removedTorrents, i);
+                gpointer key, value;
+
+                if (g_hash_table_steal_extended(model->ht, &id, &key, &value)) {
+                    g_ptr_array_add(hitlist, value);
+                    g_free(key);
+                }
+            }
+
+            if (hitlist->len > 0) {
+                model->stats.rowsChanged += hitlist->len;
+                trg_torrent_model_remove_refs(model, hitlist);
+                job->whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
             }
-            g_list_free(hitlist);
-        }
-    }
 
-    if (whatsChanged != 0) {
-        if ((whatsChanged & TORRENT_UPDATE_ADDREMOVE)
-            || (whatsChanged & TORRENT_UPDATE_STATE_CHANGE)) {
-            trg_torrent_model_stat_counts_clear(&model->stats);
-            gtk_tree_model_foreach(GTK_TREE_MODEL(model), trg_torrent_model_stats_scan_foreachfunc,
-                                   &(model->stats));
+            g_ptr_array_free(hitlist, TRUE);
         }
-        g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0, whatsChanged);
     }
 
+    if (job->whatsChanged != 0)
+        g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0, job->whatsChanged);
+
     g_signal_emit(model, signals[TMODEL_UPDATE], 0);
+}
+
+/* Finish a job (chunked or not) and detach it from the model before the
+ * callback runs, so the callback is free to start another update. */
+static void trg_torrent_model_update_job_finish(TrgTorrentModel *model,
+                                                struct trg_torrent_model_update_job *job)
+{
+    gint64 start = trg_span_start();
+
+    trg_torrent_model_update_job_commit(model, job);
+    job->elapsed += trg_span_stop(TRG_PROFILE_NONE, "torrent-model", "commit", start);
+
+    /* The whole update, across however many chunks it took. */
+    if (start > 0)
+        trg_profile_add(TRG_PROFILE_MODEL_MODE(job->mode), job->elapsed);
+
+    if (model->job == job)
+        model->job = NULL;
+
+    if (job->callback)
+        job->callback(model, job->mode, &(model->stats), job->data);
+
+    trg_torrent_model_update_job_free(job);
+}
+
+static gboolean trg_torrent_model_update_chunk(gpointer data)
+{
+    TrgTorrentModel *model = TRG_TORRENT_MODEL(data);
+    struct trg_torrent_model_update_job *job = model->job;
+
+    if (!trg_torrent_model_update_job_run(model, job,
+                                          g_get_monotonic_time() + TRG_UPDATE_CHUNK_BUDGET_US))
+        return G_SOURCE_CONTINUE;
+
+    job->sourceId = 0;
+    trg_torrent_model_update_job_finish(model, job);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Apply whatever is left of an update in progress, right now. */
+void trg_torrent_model_update_flush(TrgTorrentModel *model)
+{
+    struct trg_torrent_model_update_job *job = model->job;
+
+    if (!job)
+        return;
+
+    g_clear_handle_id(&job->sourceId, g_source_remove);
+    trg_torrent_model_update_job_run(model, job, 0);
+    trg_torrent_model_update_job_finish(model, job);
+}
+
+/* Drop an update in progress without applying the rest or calling back. */
+void trg_torrent_model_update_cancel(TrgTorrentModel *model)
+{
+    g_clear_pointer(&model->job, trg_torrent_model_update_job_free);
+}
+
+/* Like trg_torrent_model_update(), but spread over idle callbacks of at most
+ * TRG_UPDATE_CHUNK_BUDGET_US each. Redraws run at a higher priority than
+ * default idle, so the frame clock gets to lay out and paint between chunks
+ * and the window keeps responding to resizes and scrolling. Every row
+ * stays consistent between chunks; only the state counts, removals and
+ * callback wait for the last one. */
+void trg_torrent_model_update_chunked(TrgTorrentModel *model, TrgClient *tc, JsonObject *response,
+                                      gint mode, trg_torrent_model_update_cb callback,
+                                      gpointer data)
+{
+    struct trg_torrent_model_update_job *job;
+
+    trg_torrent_model_update_flush(model);
+
+    job = trg_torrent_model_update_job_new(model, tc, response, mode);
+    job->callback = callback;
+    job->data = data;
+    job->sourceId = g_idle_add(trg_torrent_model_update_chunk, model);
+
+    model->job = job;
+}
+
+trg_torrent_model_update_stats *trg_torrent_model_update(TrgTorrentModel *model, TrgClient *tc,
+                                                         JsonObject *response, gint mode)
+{
+    struct trg_torrent_model_update_job *job;
+
+    trg_torrent_model_update_flush(model);
+
+    job = trg_torrent_model_update_job_new(model, tc, response, mode);
+    trg_torrent_model_update_job_run(model, job, 0);
+    trg_torrent_model_update_job_finish(model, job);
 
     return &(model->stats);
 }
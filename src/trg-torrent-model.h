@@ -23,6 +23,7 @@
 #include <json-glib/json-glib.h>
 
 #include "trg-client.h"
+#include "trg-torrent-filter.h"
 
 enum {
     TORRENT_COLUMN_ICON,
@@ -70,6 +71,7 @@ enum {
     TORRENT_COLUMN_ERROR,
     TORRENT_COLUMN_SEED_RATIO_MODE,
     TORRENT_COLUMN_SEED_RATIO_LIMIT,
+    TORRENT_COLUMN_FILTER_ROW,
     TORRENT_COLUMN_COLUMNS
 };
 
@@ -90,19 +92,44 @@ typedef struct {
     gint active;
     gint seed_wait;
     gint down_wait;
+    gint rowsChanged; /* changed, added or removed by the last update */
 } trg_torrent_model_update_stats;
 
 #define TORRENT_UPDATE_STATE_CHANGE (1 << 0)
 #define TORRENT_UPDATE_PATH_CHANGE  (1 << 1)
 #define TORRENT_UPDATE_ADDREMOVE    (1 << 2)
 
+/* Groups of columns computed from the torrent rather than copied out of it,
+ * which are only kept up to date while trg_torrent_model_set_derived() says
+ * something is showing them. */
+#define TORRENT_DERIVED_PEER_SOURCES (1 << 0)
+#define TORRENT_DERIVED_PEER_COUNTS  (1 << 1)
+#define TORRENT_DERIVED_TRACKER_HOST (1 << 2)
+#define TORRENT_DERIVED_ALL                                                                        \
+    (TORRENT_DERIVED_PEER_SOURCES | TORRENT_DERIVED_PEER_COUNTS | TORRENT_DERIVED_TRACKER_HOST)
+
 TrgTorrentModel *trg_torrent_model_new(void);
 
 gboolean find_existing_peer_item(GtkListStore *model, JsonObject *p, GtkTreeIter *iter);
 trg_torrent_model_update_stats *trg_torrent_model_update(TrgTorrentModel *model, TrgClient *tc,
                                                          JsonObject *response, gint mode);
+
+typedef void (*trg_torrent_model_update_cb)(TrgTorrentModel *model, gint mode,
+                                            trg_torrent_model_update_stats *stats, gpointer data);
+
+void trg_torrent_model_update_chunked(TrgTorrentModel *model, TrgClient *tc, JsonObject *response,
+                                      gint mode, trg_torrent_model_update_cb callback,
+                                      gpointer data);
+void trg_torrent_model_update_flush(TrgTorrentModel *model);
+void trg_torrent_model_update_cancel(TrgTorrentModel *model);
 trg_torrent_model_update_stats *trg_torrent_model_get_stats(TrgTorrentModel *model);
 GHashTable *get_torrent_table(TrgTorrentModel *model);
+trg_trigram_index *trg_torrent_model_get_name_index(TrgTorrentModel *model);
+void trg_torrent_model_ids_changed(TrgTorrentModel *model, GArray *ids);
+guint trg_torrent_model_column_derived(gint column);
+guint trg_torrent_model_get_derived(TrgTorrentModel *model);
+gboolean trg_torrent_model_set_derived(TrgTorrentModel *model, guint derived);
+void trg_torrent_model_add_derived_fields(TrgTorrentModel *model, JsonNode *req);
 void trg_torrent_model_remove_all(TrgTorrentModel *model);
 gboolean trg_torrent_model_is_remove_in_progress(TrgTorrentModel *model);
 gboolean get_torrent_data(GHashTable *table, gint64 id, JsonObject **t, GtkTreeIter *out_iter);
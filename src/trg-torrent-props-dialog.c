@@ -74,6 +74,12 @@ struct _TrgTorrentPropsDialog {
     TrgFilesModel *filesModel;
     JsonObject *lastJson;
 
+    /* The files and peers aren't in the list update, so they're fetched
+     * for this torrent whenever its row changes, one request at a time. */
+    gint64 detailSerial;
+    gboolean detailPending;
+    gboolean destroyed;
+
     GtkWidget *size_lb;
     GtkWidget *have_lb;
     GtkWidget *dl_lb;
@@ -418,6 +424,52 @@ static GtkWidget *trg_props_limits_page_new(TrgTorrentPropsDialog *win, JsonObje
     return t;
 }
 
+static gboolean on_props_detail_get(gpointer data)
+{
+    trg_response *response = (trg_response *)data;
+    TrgTorrentPropsDialog *dlg = TRG_TORRENT_PROPS_DIALOG(response->cb_data);
+    JsonArray *torrents;
+    JsonObject *t;
+    gint mode;
+
+    dlg->detailPending = FALSE;
+
+    if (dlg->destroyed || response->status != SOUP_STATUS_OK)
+        goto out;
+
+    torrents = get_torrents(get_arguments(response->obj));
+    if (json_array_get_length(torrents) != 1)
+        goto out;
+
+    t = json_array_get_object_element(torrents, 0);
+    mode = dlg->detailSerial == 0 ? TORRENT_GET_MODE_FIRST : TORRENT_GET_MODE_UPDATE;
+    dlg->detailSerial++;
+
+    if (json_object_has_member(t, FIELD_FILES))
+        trg_files_model_update(dlg->filesModel, GTK_TREE_VIEW(dlg->filesTv), dlg->detailSerial, t,
+                               mode);
+
+    if (json_object_has_member(t, FIELD_PEERS))
+        trg_peers_model_update(dlg->peersModel, TRG_TREE_VIEW(dlg->peersTv), dlg->detailSerial, t,
+                               mode);
+
+out:
+    g_object_unref(dlg);
+    trg_response_free(response);
+    return FALSE;
+}
+
+static void trg_torrent_props_dialog_fetch_detail(TrgTorrentPropsDialog *dlg)
+{
+    if (dlg->detailPending)
+        return;
+
+    dlg->detailPending = TRUE;
+    dispatch_rpc_async(dlg->client,
+                       torrent_get_detail(json_array_get_int_element(dlg->targetIds, 0)),
+                       on_props_detail_get, g_object_ref(dlg));
+}
+
 static void models_updated(TrgTorrentModel *model, gpointer data)
 {
     TrgTorrentPropsDialog *dlg = TRG_TORRENT_PROPS_DIALOG(data);
@@ -429,10 +481,7 @@ static void models_updated(TrgTorrentModel *model, gpointer data)
         = get_torrent_data(ht, json_array_get_int_element(dlg->targetIds, 0), &t, &iter);
 
     if (exists && dlg->lastJson != t) {
-        trg_files_model_update(dlg->filesModel, GTK_TREE_VIEW(dlg->filesTv), serial, t,
-                               TORRENT_GET_MODE_UPDATE);
-        trg_peers_model_update(dlg->peersModel, TRG_TREE_VIEW(dlg->peersTv), serial, t,
-                               TORRENT_GET_MODE_UPDATE);
+        trg_torrent_props_dialog_fetch_detail(dlg);
         trg_trackers_model_update(dlg->trackersModel, serial, t, TORRENT_GET_MODE_UPDATE);
         info_page_update(TRG_TORRENT_PROPS_DIALOG(data), t, model, &iter);
     }
@@ -507,8 +556,6 @@ static GObject *trg_torrent_props_dialog_constructor(GType type, guint n_constru
         propsDialog->filesTv
             = trg_files_tree_view_new(propsDialog->filesModel, propsDialog->parent_win,
                                       propsDialog->client, "TrgFilesTreeView-dialog");
-        trg_files_model_update(propsDialog->filesModel, GTK_TREE_VIEW(propsDialog->filesTv), serial,
-                               json, TORRENT_GET_MODE_FIRST);
         gtk_widget_set_sensitive(GTK_WIDGET(propsDialog->filesTv), TRUE);
         gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                                  my_scrolledwin_new(GTK_WIDGET(propsDialog->filesTv)),
@@ -519,8 +566,6 @@ static GObject *trg_torrent_props_dialog_constructor(GType type, guint n_constru
         propsDialog->peersModel = trg_peers_model_new();
         propsDialog->peersTv
             = trg_peers_tree_view_new(prefs, propsDialog->peersModel, "TrgPeersTreeView-dialog");
-        trg_peers_model_update(propsDialog->peersModel, TRG_TREE_VIEW(propsDialog->peersTv), serial,
-                               json, TORRENT_GET_MODE_FIRST);
         gtk_widget_set_sensitive(GTK_WIDGET(propsDialog->peersTv), TRUE);
         gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                                  my_scrolledwin_new(GTK_WIDGET(propsDialog->peersTv)),
@@ -547,6 +592,7 @@ static GObject *trg_torrent_props_dialog_constructor(GType type, guint n_constru
                                 object, G_CONNECT_AFTER);
 
         propsDialog->lastJson = json;
+        trg_torrent_props_dialog_fetch_detail(propsDialog);
     }
 
     gtk_notebook_append_page(GTK_NOTEBOOK(notebook), trg_props_limits_page_new(propsDialog, json),
@@ -575,6 +621,9 @@ static GObject *trg_torrent_props_dialog_constructor(GType type, guint n_constru
 
 static void trg_torrent_props_dialog_dispose(GObject *object)
 {
+    /* A files and peers fetch may still hold a reference. */
+    TRG_TORRENT_PROPS_DIALOG(object)->destroyed = TRUE;
+
     G_OBJECT_CLASS(trg_torrent_props_dialog_parent_class)->dispose(object);
 }
 
@@ -0,0 +1,204 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Run with TRG_TRACE=/path/to/file.json to write what the main loop (and
+ * the threads it starts) spends its time on as Chrome trace events, which
+ * chrome://tracing or ui.perfetto.dev can open. Spans cover RPC requests
+ * from dispatch to callback, response parsing, the phases of applying a
+ * torrent-get, the torrent model's update chunks, the files tree being built
+ * and applied, each frame's update, layout and paint, and every stage
+ * TRG_PROFILE totals.
+ *
+ * Names and categories are written as they are, so they must be plain
+ * strings that don't need escaping in JSON.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "trg-trace.h"
+
+/* Frame phases are only traced, so they don't go through trg_span_start(). */
+#define trg_trace_start() (G_UNLIKELY(trg_trace_enabled) ? g_get_monotonic_time() : 0)
+
+gboolean trg_trace_enabled = FALSE;
+
+static FILE *trg_trace_file;
+static gint64 trg_trace_epoch;
+static gboolean trg_trace_first = TRUE;
+static gint trg_trace_next_tid;
+static gint trg_trace_next_id;
+static GPrivate trg_trace_tid;
+
+/* Spans come from the files tree thread too. */
+G_LOCK_DEFINE_STATIC(trg_trace);
+
+static guint trg_trace_thread_id(void)
+{
+    guint tid = GPOINTER_TO_UINT(g_private_get(&trg_trace_tid));
+
+    if (!tid) {
+        tid = g_atomic_int_add(&trg_trace_next_tid, 1) + 1;
+        g_private_set(&trg_trace_tid, GUINT_TO_POINTER(tid));
+    }
+
+    return tid;
+}
+
+static void trg_trace_event(const gchar *format, ...) G_GNUC_PRINTF(1, 2);
+
+static void trg_trace_event(const gchar *format, ...)
+{
+    va_list args;
+
+    G_LOCK(trg_trace);
+
+    if (trg_trace_file) {
+        fputs(trg_trace_first ? "\n" : ",\n", trg_trace_file);
+        trg_trace_first = FALSE;
+
+        va_start(args, format);
+        vfprintf(trg_trace_file, format, args);
+        va_end(args);
+    }
+
+    G_UNLOCK(trg_trace);
+}
+
+void trg_trace_init(void)
+{
+    const gchar *filename = g_getenv("TRG_TRACE");
+
+    if (!filename)
+        return;
+
+    trg_trace_file = g_fopen(filename, "w");
+    if (!trg_trace_file) {
+        g_warning("unable to trace to %s: %s", filename, g_strerror(errno));
+        return;
+    }
+
+    trg_trace_epoch = g_get_monotonic_time();
+    trg_trace_enabled = TRUE;
+
+    fputc('[', trg_trace_file);
+    trg_trace_event("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"name\":\"main\"}}",
+                    trg_trace_thread_id());
+}
+
+void trg_trace_close(void)
+{
+    if (!trg_trace_enabled)
+        return;
+
+    G_LOCK(trg_trace);
+
+    trg_trace_enabled = FALSE;
+    fputs("\n]\n", trg_trace_file);
+    fclose(trg_trace_file);
+    trg_trace_file = NULL;
+
+    G_UNLOCK(trg_trace);
+}
+
+/* A span on the calling thread from start (a monotonic time) to now. Call
+ * sites use trg_span_stop(), which also feeds the TRG_PROFILE totals. */
+void trg_trace_span(const gchar *category, const gchar *name, gint64 start)
+{
+    if (start <= 0 || !trg_trace_enabled)
+        return;
+
+    trg_trace_event("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT
+                    ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":%u}",
+                    name, category, start - trg_trace_epoch, g_get_monotonic_time() - start,
+                    trg_trace_thread_id());
+}
+
+/* A span from start to now that other spans on the main loop ran during,
+ * such as a request waiting for its response. start is a monotonic time. */
+void trg_trace_async(const gchar *category, const gchar *name, gint64 start)
+{
+    gint id;
+
+    if (start <= 0 || !trg_trace_enabled)
+        return;
+
+    id = g_atomic_int_add(&trg_trace_next_id, 1);
+
+    trg_trace_event("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"b\",\"id\":%d,"
+                    "\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":%u}",
+                    name, category, id, start - trg_trace_epoch, trg_trace_thread_id());
+    trg_trace_event("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"e\",\"id\":%d,"
+                    "\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":%u}",
+                    name, category, id, g_get_monotonic_time() - trg_trace_epoch,
+                    trg_trace_thread_id());
+}
+
+/* The frame clock's phases, each timed from its signal to the next one. */
+static gint64 trg_trace_frame_start;
+static gint64 trg_trace_phase_start;
+
+static void trg_trace_before_paint(GdkFrameClock *clock, gpointer data)
+{
+    trg_trace_frame_start = trg_trace_phase_start = trg_trace_start();
+}
+
+static void trg_trace_layout(GdkFrameClock *clock, gpointer data)
+{
+    trg_trace_span("frame", "update", trg_trace_phase_start);
+    trg_trace_phase_start = trg_trace_start();
+}
+
+static void trg_trace_paint(GdkFrameClock *clock, gpointer data)
+{
+    trg_trace_span("frame", "layout", trg_trace_phase_start);
+    trg_trace_phase_start = trg_trace_start();
+}
+
+static void trg_trace_after_paint(GdkFrameClock *clock, gpointer data)
+{
+    trg_trace_span("frame", "paint", trg_trace_phase_start);
+    trg_trace_span("frame", "frame", trg_trace_frame_start);
+    trg_trace_frame_start = trg_trace_phase_start = 0;
+}
+
+static void trg_trace_realize(GtkWidget *widget, gpointer data)
+{
+    GdkFrameClock *clock = gtk_widget_get_frame_clock(widget);
+
+    g_signal_connect(clock, "before-paint", G_CALLBACK(trg_trace_before_paint), NULL);
+    g_signal_connect(clock, "layout", G_CALLBACK(trg_trace_layout), NULL);
+    g_signal_connect(clock, "paint", G_CALLBACK(trg_trace_paint), NULL);
+    g_signal_connect(clock, "after-paint", G_CALLBACK(trg_trace_after_paint), NULL);
+}
+
+/* Trace the paint phases of the frame clock of a toplevel, once it has one. */
+void trg_trace_watch_frames(GtkWidget *widget)
+{
+    if (trg_trace_enabled)
+        g_signal_connect(widget, "realize", G_CALLBACK(trg_trace_realize), NULL);
+}
@@ -212,11 +212,96 @@ gchar *trg_gregex_get_first(GRegex *rx, const gchar *src)
     return dst;
 }
 
-GRegex *trg_uri_host_regex_new(void)
+/*
+ * Hand-written equivalent of the regular expression
+ *
+ *   ^[^:/?#]+:?//(?:www\.|torrent\.|torrents\.|tracker\.|\d+\.)?([^/?#:]*)
+ *
+ * which used to be matched against every tracker URL on every update.
+ * Returns the start of the host within uri and its length through len,
+ * or NULL if uri doesn't look like a URL.
+ */
+static const gchar *trg_uri_scan_host(const gchar *uri, gsize *len)
+{
+    static const gchar *prefixes[] = { "www.", "torrent.", "torrents.", "tracker." };
+    const gchar *p = uri;
+    const gchar *host;
+    guint i;
+
+    while (*p && !strchr(":/?#", *p))
+        p++;
+
+    if (p == uri)
+        return NULL;
+
+    if (*p == ':')
+        p++;
+
+    if (p[0] != '/' || p[1] != '/')
+        return NULL;
+
+    p += 2;
+
+    for (i = 0; i < G_N_ELEMENTS(prefixes); i++) {
+        if (g_str_has_prefix(p, prefixes[i])) {
+            p += strlen(prefixes[i]);
+            break;
+        }
+    }
+
+    if (i == G_N_ELEMENTS(prefixes) && g_ascii_isdigit(*p)) {
+        const gchar *d = p;
+        while (g_ascii_isdigit(*d))
+            d++;
+        if (*d == '.')
+            p = d + 1;
+    }
+
+    host = p;
+    while (*p && !strchr("/?#:", *p))
+        p++;
+
+    *len = p - host;
+    return host;
+}
+
+#define TRG_URI_HOST_CACHE_MAX 4096
+
+/*
+ * Announce URL to host, memoized. Hosts are interned so callers can
+ * compare them by pointer, and must not free the result. Only called
+ * from the main loop, so the cache isn't locked.
+ */
+static GHashTable *uri_host_cache = NULL;
+
+const gchar *trg_uri_get_host(const gchar *uri)
 {
-    return g_regex_new(
-        "^[^:/?#]+:?//(?:www\\.|torrent\\.|torrents\\.|tracker\\.|\\d+\\.)?([^/?#:]*)",
-        G_REGEX_OPTIMIZE, 0, NULL);
+    GHashTable *cache = uri_host_cache;
+    const gchar *host;
+    gpointer cached;
+    gsize len;
+
+    if (!uri)
+        return NULL;
+
+    if (!cache)
+        cache = uri_host_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    else if (g_hash_table_lookup_extended(cache, uri, NULL, &cached))
+        return cached;
+
+    host = trg_uri_scan_host(uri, &len);
+    if (host) {
+        gchar *tmp = g_strndup(host, len);
+        host = g_intern_string(tmp);
+        g_free(tmp);
+    }
+
+    if (g_hash_table_size(cache) >= TRG_URI_HOST_CACHE_MAX)
+        g_hash_table_remove_all(cache);
+
+    g_hash_table_insert(cache, g_strdup(uri), (gpointer)host);
+
+    return host;
 }
 
 void g_str_slist_free(GSList *list)
@@ -479,6 +564,112 @@ gchar *epoch_to_string(gint64 epoch)
     return timestring;
 }
 
+/*
+ * Display strings for the numeric cell renderers, keyed by unit and the
+ * value as it is displayed (speeds are bucketed to whole KB/s). The same
+ * handful of values is formatted for many rows on every draw, so this
+ * saves reformatting them each time GTK binds a cell. The result belongs
+ * to the cache and is only valid until the next call, which is fine for
+ * handing straight to a "text" property.
+ */
+#define TRG_FORMAT_CACHE_MAX 2048
+
+static GHashTable *format_caches[TRG_FORMAT_COUNT];
+
+static const gchar *trg_format_lookup(trg_format_unit unit, gint64 key, gdouble ratio)
+{
+    GHashTable *cache = format_caches[unit];
+    gchar buf[64];
+    gchar *text;
+
+    if (!cache)
+        cache = format_caches[unit]
+            = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, g_free);
+    else if ((text = g_hash_table_lookup(cache, &key)))
+        return text;
+
+    switch (unit) {
+    case TRG_FORMAT_SPEED:
+        trg_strlspeed(buf, key);
+        text = g_strdup(buf);
+        break;
+    case TRG_FORMAT_SIZE:
+        trg_strlsize(buf, key);
+        text = g_strdup(buf);
+        break;
+    case TRG_FORMAT_ETA:
+        tr_strltime_short(buf, key, sizeof(buf));
+        text = g_strdup(buf);
+        break;
+    case TRG_FORMAT_EPOCH:
+        text = epoch_to_string(key);
+        break;
+    default:
+        trg_strlratio(buf, ratio);
+        text = g_strdup(buf);
+        break;
+    }
+
+    if (g_hash_table_size(cache) >= TRG_FORMAT_CACHE_MAX)
+        g_hash_table_remove_all(cache);
+
+    g_hash_table_insert(cache, g_memdup2(&key, sizeof(key)), text);
+
+    return text;
+}
+
+const gchar *trg_format_cached(trg_format_unit unit, gint64 value)
+{
+    g_return_val_if_fail(unit < TRG_FORMAT_RATIO, NULL);
+
+    if (unit == TRG_FORMAT_SPEED)
+        value /= disk_K;
+
+    return trg_format_lookup(unit, value, 0);
+}
+
+const gchar *trg_format_ratio_cached(gdouble ratio)
+{
+    gint64 key;
+
+    G_STATIC_ASSERT(sizeof(key) == sizeof(ratio));
+    memcpy(&key, &ratio, sizeof(key));
+
+    return trg_format_lookup(TRG_FORMAT_RATIO, key, ratio);
+}
+
+static void add_cache_usage(GHashTable *cache, gsize keySize, trg_memory_usage *usage)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    if (!cache)
+        return;
+
+    usage->bytes += trg_memory_table_size(cache);
+
+    g_hash_table_iter_init(&iter, cache);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        usage->count++;
+        if (keySize)
+            usage->bytes += keySize + (value ? strlen(value) + 1 : 0);
+        else
+            usage->bytes += strlen(key) + 1;
+    }
+}
+
+/* The announce host and display string caches above. Hosts are interned,
+ * so only the URIs they're keyed by are counted. */
+void trg_util_cache_usage(trg_memory_usage *usage)
+{
+    guint i;
+
+    add_cache_usage(uri_host_cache, 0, usage);
+
+    for (i = 0; i < TRG_FORMAT_COUNT; i++)
+        add_cache_usage(format_caches[i], sizeof(gint64), usage);
+}
+
 /* wrap a link in text with a hyperlink, for use in pango markup.
  * with or without any links - a newly allocated string is returned.
  * Note that a markup-escaped string is always returned. */
@@ -27,6 +27,7 @@
 #include <json-glib/json-glib.h>
 
 #include "trg-client.h"
+#include "trg-memory.h"
 
 #define trg_strlspeed(a, b)   tr_formatter_speed_KBps(a, b, sizeof(a))
 #define trg_strlpercent(a, b) tr_strlpercent(a, b, sizeof(a))
@@ -48,7 +49,7 @@ extern const char *speed_T_str;
 
 void add_file_id_to_array(JsonObject *args, const gchar *key, gint index);
 void g_str_slist_free(GSList *list);
-GRegex *trg_uri_host_regex_new(void);
+const gchar *trg_uri_get_host(const gchar *uri);
 gchar *trg_gregex_get_first(GRegex *rx, const gchar *uri);
 gchar *make_error_message(JsonObject *response, int status, gchar *err_msg);
 void trg_error_dialog(GtkWindow *parent, gchar *msg);
@@ -65,6 +66,19 @@ char *tr_formatter_speed_KBps(char *buf, double KBps, size_t buflen);
 
 char *tr_strltime_long(char *buf, long seconds, size_t buflen);
 gchar *epoch_to_string(gint64 epoch);
+
+typedef enum {
+    TRG_FORMAT_SPEED,
+    TRG_FORMAT_SIZE,
+    TRG_FORMAT_ETA,
+    TRG_FORMAT_EPOCH,
+    TRG_FORMAT_RATIO,
+    TRG_FORMAT_COUNT
+} trg_format_unit;
+
+const gchar *trg_format_cached(trg_format_unit unit, gint64 value);
+const gchar *trg_format_ratio_cached(gdouble ratio);
+void trg_util_cache_usage(trg_memory_usage *usage);
 char *tr_strltime_short(char *buf, long seconds, size_t buflen);
 char *tr_strlpercent(char *buf, double x, size_t buflen);
 char *tr_strratio(char *buf, size_t buflen, double ratio, const char *infinity);